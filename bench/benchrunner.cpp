@@ -0,0 +1,404 @@
+﻿#include "benchrunner.h"
+#include "transcodetaskmanager.h"
+#include "utils/cpuscheduler.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QProcess>
+#include <QSaveFile>
+#include <QSysInfo>
+#include <QThread>
+#include <cstdio>
+
+BenchRunner::BenchRunner(QObject *parent)
+    : QObject(parent)
+{
+}
+
+int BenchRunner::exec(QCoreApplication &app)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QString::fromLocal8Bit("编码基准测试：合成片段 × 编码器 × 预设 × CRF × 并发数"));
+    parser.addHelpOption();
+    QCommandLineOption outputOption(QStringList() << "o" << "output", QString::fromLocal8Bit("结果文件（默认 bench_results.json）"), "file", "bench_results.json");
+    QCommandLineOption workDirOption("work-dir", QString::fromLocal8Bit("片段和输出的工作目录（片段会被复用）"), "dir",
+                                     QDir(QDir::tempPath()).absoluteFilePath("transcoder-bench"));
+    QCommandLineOption codecsOption("codecs", QString::fromLocal8Bit("编码器列表，逗号分隔"), "list", "libx264");
+    QCommandLineOption presetsOption("presets", QString::fromLocal8Bit("预设列表，逗号分隔"), "list", "veryfast,medium");
+    QCommandLineOption crfsOption("crfs", QString::fromLocal8Bit("CRF列表，逗号分隔"), "list", "23");
+    QCommandLineOption concurrencyOption("concurrency", QString::fromLocal8Bit("并发任务数列表，逗号分隔"), "list", "1,2,4");
+    QCommandLineOption durationOption("duration", QString::fromLocal8Bit("每个片段的时长（秒）"), "sec", "10");
+    QCommandLineOption repeatOption("repeat", QString::fromLocal8Bit("每个片段在一格中重复的次数"), "n", "1");
+    QCommandLineOption settingsOption("settings", QString::fromLocal8Bit("配置文件，提供矩阵之外的转码参数（分辨率、帧率等）"), "file");
+    QCommandLineOption keepOption("keep-outputs", QString::fromLocal8Bit("保留每一格的转码输出"));
+    parser.addOption(outputOption);
+    parser.addOption(workDirOption);
+    parser.addOption(codecsOption);
+    parser.addOption(presetsOption);
+    parser.addOption(crfsOption);
+    parser.addOption(concurrencyOption);
+    parser.addOption(durationOption);
+    parser.addOption(repeatOption);
+    parser.addOption(settingsOption);
+    parser.addOption(keepOption);
+    parser.process(app);
+
+    m_workDir = QDir(parser.value(workDirOption)).absolutePath();
+    m_clipDir = QDir(m_workDir).absoluteFilePath("clips");
+    m_durationSec = parser.value(durationOption).toInt();
+    m_repeat = parser.value(repeatOption).toInt();
+    m_keepOutputs = parser.isSet(keepOption);
+
+    QStringList codecs = splitList(parser.value(codecsOption));
+    QStringList presets = splitList(parser.value(presetsOption));
+    QList<int> crfs;
+    QList<int> concurrencies;
+    for (const QString &value : splitList(parser.value(crfsOption)))
+    {
+        crfs.append(value.toInt());
+    }
+    for (const QString &value : splitList(parser.value(concurrencyOption)))
+    {
+        concurrencies.append(qMax(1, value.toInt()));
+    }
+
+    if (m_durationSec <= 0 || m_repeat <= 0 || codecs.isEmpty() || presets.isEmpty() || crfs.isEmpty() || concurrencies.isEmpty())
+    {
+        std::fprintf(stderr, "%s", qPrintable(parser.helpText()));
+        return ExitUsage;
+    }
+
+    // 默认使用内置默认值而不是用户配置，保证不同机器上的结果可比
+    ConfigManager *config = ConfigManager::instance();
+    m_baseSettings = TranscodeSettings();
+    m_baseSystem = SystemSettings();
+    if (parser.isSet(settingsOption))
+    {
+        if (!config->loadConfigFrom(parser.value(settingsOption)))
+        {
+            log(QString::fromLocal8Bit("无法加载配置文件: %1").arg(parser.value(settingsOption)));
+            return ExitUsage;
+        }
+        m_baseSettings = config->getTranscodeSettings();
+        m_baseSystem = config->getSystemSettings();
+    }
+
+    // 固定调度：关闭自适应并发、分段和流复制，每格只由矩阵参数决定
+    // 固定使用ffmpeg进程：进程内引擎不记录CPU时间；暂存、磁盘空间检查和附加输出会改变每格的工作量
+    m_baseSettings.streamCopy = false;
+    m_baseSettings.engine = "ffmpeg";
+    m_baseSettings.renditions.clear();
+    m_baseSystem.scratchStaging = false;
+    m_baseSystem.minFreeSpaceMb = 0;
+    m_baseSystem.autoSaveProgress = false;
+    m_baseSystem.adaptiveConcurrency = false;
+    m_baseSystem.chunkedEncoding = false;
+    m_baseSystem.metricsEnabled = false;
+    m_baseSystem.threadsPerJob = 0;
+    m_baseSystem.urgentLaneJobs = 0;
+    m_baseSystem.normalLaneJobs = 0;
+    m_baseSystem.backgroundLaneJobs = 0;
+    m_baseSystem.jobOrder = "name";
+
+    QString ffmpegVersion = FFmpegUtils::ffmpegVersion();
+    if (ffmpegVersion.isEmpty())
+    {
+        log(QString::fromLocal8Bit("ffmpeg不可用"));
+        return ExitError;
+    }
+
+    QStringList files;
+    if (!generateClips(files))
+    {
+        return ExitError;
+    }
+
+    QJsonArray clipArray;
+    for (const Clip &clip : clips())
+    {
+        QJsonObject entry;
+        entry["name"] = clip.name;
+        entry["width"] = clip.size.width();
+        entry["height"] = clip.size.height();
+        clipArray.append(entry);
+    }
+
+    QJsonObject root;
+    root["version"] = 1;
+    root["generated"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    root["host"] = hostInfo();
+    root["ffmpeg"] = ffmpegVersion;
+    root["durationSec"] = m_durationSec;
+    root["repeat"] = m_repeat;
+    root["resolution"] = m_baseSettings.resolution;
+    root["frameRate"] = m_baseSettings.framerate;
+    root["clips"] = clipArray;
+
+    QString outputPath = parser.value(outputOption);
+    QJsonArray results;
+    bool allSucceeded = true;
+    int index = 0;
+    int total = codecs.size() * presets.size() * crfs.size() * concurrencies.size();
+
+    for (const QString &codec : codecs)
+    {
+        for (const QString &preset : presets)
+        {
+            for (int crf : crfs)
+            {
+                for (int concurrency : concurrencies)
+                {
+                    Cell cell;
+                    cell.codec = codec;
+                    cell.preset = preset;
+                    cell.crf = crf;
+                    cell.concurrency = concurrency;
+
+                    log(QString("[%1/%2] %3 %4 crf=%5 jobs=%6").arg(index + 1).arg(total).arg(codec).arg(preset).arg(crf).arg(concurrency));
+                    QJsonObject result = runCell(cell, files, index++, allSucceeded);
+                    results.append(result);
+                    log(QString("    fps=%1 cpuSecPerOutputMin=%2 outputBytes=%3")
+                            .arg(result["fps"].toDouble(), 0, 'f', 1)
+                            .arg(result["cpuSecondsPerOutputMinute"].toDouble(), 0, 'f', 1)
+                            .arg(result["outputBytes"].toVariant().toLongLong()));
+
+                    // 每格完成后都写出，长时间运行中断时保留已有结果
+                    root["results"] = results;
+                    QSaveFile file(outputPath);
+                    if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(root).toJson()) < 0 || !file.commit())
+                    {
+                        log(QString::fromLocal8Bit("无法写入结果文件: %1").arg(outputPath));
+                        return ExitError;
+                    }
+                }
+            }
+        }
+    }
+
+    log(QString::fromLocal8Bit("结果已写入: %1").arg(QFileInfo(outputPath).absoluteFilePath()));
+    return allSucceeded ? ExitSuccess : ExitFailures;
+}
+
+QList<BenchRunner::Clip> BenchRunner::clips()
+{
+    // 两种画面 × 720p/1080p × 横屏/竖屏
+    QList<Clip> result;
+    const QList<QPair<QString, FFmpegUtils::SyntheticPattern>> patterns = {
+        {"testsrc", FFmpegUtils::PATTERN_TESTSRC},
+        {"mandelbrot", FFmpegUtils::PATTERN_MANDELBROT}};
+    const QList<QPair<QString, QSize>> sizes = {
+        {"720p_landscape", QSize(1280, 720)},
+        {"720p_portrait", QSize(720, 1280)},
+        {"1080p_landscape", QSize(1920, 1080)},
+        {"1080p_portrait", QSize(1080, 1920)}};
+
+    for (const auto &pattern : patterns)
+    {
+        for (const auto &size : sizes)
+        {
+            result.append({pattern.first + "_" + size.first, pattern.second, size.second});
+        }
+    }
+    return result;
+}
+
+bool BenchRunner::generateClips(QStringList &files)
+{
+    if (!QDir().mkpath(m_clipDir))
+    {
+        log(QString::fromLocal8Bit("无法创建目录: %1").arg(m_clipDir));
+        return false;
+    }
+
+    QDir clipDir(m_clipDir);
+    for (const Clip &clip : clips())
+    {
+        // 文件名带上时长，时长不同的片段不会被误复用
+        QString fileName = QString("%1_%2s.mp4").arg(clip.name).arg(m_durationSec);
+        QString path = clipDir.absoluteFilePath(fileName);
+
+        if (QFileInfo(path).size() <= 0)
+        {
+            log(QString::fromLocal8Bit("生成片段: %1").arg(fileName));
+            QProcess process;
+            process.start(FFmpegUtils::buildSyntheticClipCommand(path, clip.pattern, clip.size, m_durationSec));
+            if (!process.waitForStarted() || !process.waitForFinished(-1) ||
+                process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0)
+            {
+                log(QString::fromLocal8Bit("生成片段失败: %1\n%2").arg(fileName).arg(QString::fromLocal8Bit(process.readAllStandardError())));
+                QFile::remove(path);
+                return false;
+            }
+        }
+        files.append(fileName);
+
+        // 重复的片段使用副本，管理器按文件名区分任务
+        for (int r = 2; r <= m_repeat; ++r)
+        {
+            QString copyName = QString("%1_%2s_r%3.mp4").arg(clip.name).arg(m_durationSec).arg(r);
+            QString copyPath = clipDir.absoluteFilePath(copyName);
+            if (!QFile::exists(copyPath) && !QFile::copy(path, copyPath))
+            {
+                log(QString::fromLocal8Bit("复制片段失败: %1").arg(copyName));
+                return false;
+            }
+            files.append(copyName);
+        }
+    }
+    return true;
+}
+
+QJsonObject BenchRunner::runCell(const Cell &cell, const QStringList &files, int index, bool &allSucceeded)
+{
+    QString targetDir = QDir(m_workDir).absoluteFilePath(QString("out/cell_%1").arg(index, 3, 10, QChar('0')));
+    QDir(targetDir).removeRecursively();
+
+    qint64 wallMs = 0;
+    QList<JobStats> stats = runBatch(cell, files, targetDir, wallMs);
+
+    int failed = files.size() - stats.size(); // 没有统计的文件视为失败
+    qint64 frames = 0;
+    qint64 cpuMs = 0;
+    qint64 inputBytes = 0;
+    qint64 outputBytes = 0;
+    qint64 peakRssKb = 0;
+    double jobFpsSum = 0.0;
+    for (const JobStats &job : stats)
+    {
+        if (!job.success)
+        {
+            failed++;
+            continue;
+        }
+        frames += job.frames;
+        cpuMs += job.userMs + job.systemMs;
+        inputBytes += job.inputBytes;
+        outputBytes += job.outputBytes;
+        peakRssKb = qMax(peakRssKb, job.peakRssKb);
+        jobFpsSum += job.fps();
+    }
+    if (failed > 0)
+    {
+        allSucceeded = false;
+    }
+
+    int succeeded = files.size() - failed;
+    double outputMinutes = succeeded * m_durationSec / 60.0;
+
+    QJsonObject result;
+    result["codec"] = cell.codec;
+    result["preset"] = cell.preset;
+    result["crf"] = cell.crf;
+    result["concurrency"] = cell.concurrency;
+    result["jobs"] = files.size();
+    result["failed"] = failed;
+    result["wallMs"] = wallMs;
+    result["frames"] = frames;
+    result["fps"] = wallMs > 0 ? frames * 1000.0 / wallMs : 0.0; // 整格吞吐量
+    result["meanJobFps"] = succeeded > 0 ? jobFpsSum / succeeded : 0.0;
+    result["cpuSeconds"] = cpuMs / 1000.0;
+    result["cpuSecondsPerOutputMinute"] = outputMinutes > 0 ? cpuMs / 1000.0 / outputMinutes : 0.0;
+    result["inputBytes"] = inputBytes;
+    result["outputBytes"] = outputBytes;
+    result["compressionRatio"] = inputBytes > 0 ? double(outputBytes) / inputBytes : 0.0;
+    result["peakRssKb"] = peakRssKb;
+
+    if (!m_keepOutputs)
+    {
+        QDir(targetDir).removeRecursively();
+    }
+    return result;
+}
+
+QList<JobStats> BenchRunner::runBatch(const Cell &cell, const QStringList &files, const QString &targetDir, qint64 &wallMs)
+{
+    // 管理器从ConfigManager读取并发设置，只在本进程内生效
+    SystemSettings system = m_baseSystem;
+    system.threadCount = cell.concurrency;
+    ConfigManager::instance()->setSystemSettings(system, false);
+
+    TranscodeSettings settings = m_baseSettings;
+    settings.codec = cell.codec;
+    settings.preset = cell.preset;
+    settings.crf = cell.crf;
+
+    QMap<QString, QStringList> batch;
+    batch.insert(m_clipDir, files);
+
+    // 与界面和无界面模式相同的运行方式：管理器在独立线程中调度TranscodeTask
+    QThread thread;
+    TranscodeTaskManager *manager = new TranscodeTaskManager(batch);
+    manager->setTargetDirectory(targetDir);
+    manager->setTranscodeSettings(settings);
+    manager->moveToThread(&thread);
+
+    QList<JobStats> results;
+    QEventLoop loop;
+    connect(manager, &TranscodeTaskManager::fileStatsUpdated, this, [&results](const JobStats &stats)
+            { results.append(stats); }, Qt::QueuedConnection);
+    connect(manager, &TranscodeTaskManager::errorOccurred, this, [](const QString &message)
+            { log(message); }, Qt::QueuedConnection);
+    connect(manager, &TranscodeTaskManager::finished, &loop, &QEventLoop::quit, Qt::QueuedConnection);
+    connect(&thread, &QThread::started, manager, &TranscodeTaskManager::start);
+    connect(manager, &TranscodeTaskManager::finished, &thread, &QThread::quit);
+    connect(&thread, &QThread::finished, manager, &QObject::deleteLater);
+
+    QElapsedTimer timer;
+    timer.start();
+    thread.start();
+    loop.exec();
+    wallMs = timer.elapsed();
+    thread.wait();
+
+    return results;
+}
+
+QJsonObject BenchRunner::hostInfo()
+{
+    QJsonObject host;
+    host["name"] = QSysInfo::machineHostName();
+    host["os"] = QSysInfo::prettyProductName();
+    host["kernel"] = QSysInfo::kernelVersion();
+    host["arch"] = QSysInfo::currentCpuArchitecture();
+    host["cores"] = CpuScheduler::availableCores();
+    host["qt"] = QString(qVersion());
+
+    // 区分硬件代际需要CPU型号，目前只在Linux上读取
+    QFile cpuInfo("/proc/cpuinfo");
+    if (cpuInfo.open(QIODevice::ReadOnly))
+    {
+        while (!cpuInfo.atEnd())
+        {
+            QByteArray line = cpuInfo.readLine();
+            if (line.startsWith("model name"))
+            {
+                host["cpu"] = QString::fromUtf8(line.mid(line.indexOf(':') + 1)).trimmed();
+                break;
+            }
+        }
+    }
+    return host;
+}
+
+QStringList BenchRunner::splitList(const QString &value)
+{
+    QStringList result;
+    for (const QString &item : value.split(',', Qt::SkipEmptyParts))
+    {
+        result.append(item.trimmed());
+    }
+    return result;
+}
+
+void BenchRunner::log(const QString &message)
+{
+    // stdout留给结果路径以外的用途，进度写到stderr
+    std::fprintf(stderr, "%s\n", message.toLocal8Bit().constData());
+    std::fflush(stderr);
+}
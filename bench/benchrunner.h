@@ -0,0 +1,80 @@
+﻿#ifndef BENCHRUNNER_H
+#define BENCHRUNNER_H
+
+#include <QObject>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QList>
+#include <QSize>
+#include <QStringList>
+#include "configmanager.h"
+#include "transcodereport.h"
+#include "utils/ffmpegutils.h"
+
+class QCoreApplication;
+
+/**
+ * 编码基准测试
+ * 生成确定性的合成片段，按 编码器 × 预设 × CRF × 并发数 的矩阵
+ * 逐格驱动真实的TranscodeTaskManager/TranscodeTask转码，
+ * 把吞吐量（fps、每分钟输出耗费的CPU秒数）和输出大小写入JSON结果文件
+ */
+class BenchRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    // 退出码
+    enum ExitCode
+    {
+        ExitSuccess = 0,  // 矩阵全部完成
+        ExitFailures = 1, // 部分转码失败（结果仍写出）
+        ExitUsage = 2,    // 参数错误
+        ExitError = 3     // 无法执行（ffmpeg不可用、无法生成片段或写结果）
+    };
+
+    explicit BenchRunner(QObject *parent = nullptr);
+
+    // 解析参数并运行整个矩阵，返回退出码
+    int exec(QCoreApplication &app);
+
+private:
+    /**
+     * 合成片段
+     */
+    struct Clip
+    {
+        QString name;
+        FFmpegUtils::SyntheticPattern pattern;
+        QSize size;
+    };
+
+    /**
+     * 矩阵中的一格
+     */
+    struct Cell
+    {
+        QString codec;
+        QString preset;
+        int crf = 23;
+        int concurrency = 1;
+    };
+
+    QString m_workDir;
+    QString m_clipDir;
+    int m_durationSec = 10;
+    int m_repeat = 1;
+    bool m_keepOutputs = false;
+    TranscodeSettings m_baseSettings; // 矩阵之外的转码参数（默认值或--settings指定）
+    SystemSettings m_baseSystem;
+
+    static QList<Clip> clips();
+    bool generateClips(QStringList &files);
+    QJsonObject runCell(const Cell &cell, const QStringList &files, int index, bool &allSucceeded);
+    QList<JobStats> runBatch(const Cell &cell, const QStringList &files, const QString &targetDir, qint64 &wallMs);
+    static QJsonObject hostInfo();
+    static QStringList splitList(const QString &value);
+    static void log(const QString &message);
+};
+
+#endif // BENCHRUNNER_H
@@ -0,0 +1,20 @@
+﻿#include "benchrunner.h"
+#include "encoding.h"
+#include <QCoreApplication>
+#include <QTextCodec>
+
+int main(int argc, char *argv[])
+{
+    // 设置控制台代码页（Windows）
+    setConsoleCodePage();
+
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+    QTextCodec::setCodecForLocale(QTextCodec::codecForName("UTF-8"));
+#endif
+
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("transcoder-bench");
+
+    BenchRunner runner;
+    return runner.exec(app);
+}
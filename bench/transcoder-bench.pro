@@ -0,0 +1,16 @@
+QT       += core network
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = transcoder-bench
+
+include(../transcoder_core.pri)
+
+SOURCES += \
+    benchrunner.cpp \
+    main.cpp
+
+HEADERS += \
+    benchrunner.h
@@ -0,0 +1,245 @@
+﻿#include "calibration.h"
+#include "transcodetask.h"
+#include "utils/cpuscheduler.h"
+#include "utils/ffmpegutils.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QProcess>
+#include <QTemporaryDir>
+#include <memory>
+#include <vector>
+
+Calibration::Calibration(const TranscodeSettings &settings, const SystemSettings &systemSettings, QObject *parent)
+    : QObject(parent), m_settings(settings),
+      m_threadsPerJob(systemSettings.threadsPerJob), m_schedulingPolicy(systemSettings.schedulingPolicy)
+{
+    qRegisterMetaType<CalibrationProfile>("CalibrationProfile");
+    m_cancelled = 0;
+}
+
+QStringList Calibration::presets()
+{
+    // veryslow相对slower收益很小，标定耗时却成倍增加，不参与标定
+    return {"ultrafast", "superfast", "veryfast", "faster", "fast", "medium", "slow", "slower"};
+}
+
+QList<int> Calibration::concurrencyLevels(int cores)
+{
+    QList<int> levels;
+    for (int jobs = 1; jobs < cores; jobs *= 2)
+    {
+        levels.append(jobs);
+    }
+    levels.append(qMax(1, cores));
+    return levels;
+}
+
+Calibration::Choice Calibration::choose(const CalibrationProfile &profile, const TranscodeSettings &settings, int threadsPerJob,
+                                        int targetMinutesPerHour, const QString &mode)
+{
+    // 每任务线程数不同时同一并发数下的吞吐量也不同，标定结果不再适用
+    Choice choice;
+    if (!profile.isValid() || profile.codec != settings.codec || profile.threadsPerJob != threadsPerJob || targetMinutesPerHour <= 0)
+    {
+        return choice;
+    }
+    choice.valid = true;
+
+    // 编码开销近似与输出像素数成正比
+    qint64 profilePixels = pixelCount(profile.resolution);
+    qint64 currentPixels = pixelCount(settings.resolution);
+    double scale = (profilePixels > 0 && currentPixels > 0) ? double(profilePixels) / currentPixels : 1.0;
+
+    choice.requiredFactor = targetMinutesPerHour / 60.0;
+    if (mode == "ingest")
+    {
+        choice.requiredFactor *= 1.0 + IngestHeadroom;
+    }
+
+    // 从最慢的预设开始找第一个能达到目标的
+    QStringList ordered = presets();
+    for (int i = ordered.size() - 1; i >= 0; --i)
+    {
+        const CalibrationPoint *best = nullptr;
+        for (const CalibrationPoint &point : profile.points)
+        {
+            if (point.preset != ordered[i] || point.realtimeFactor * scale < choice.requiredFactor)
+            {
+                continue;
+            }
+            if (!best || point.jobs < best->jobs)
+            {
+                best = &point;
+            }
+        }
+
+        if (best)
+        {
+            choice.achievable = true;
+            choice.preset = best->preset;
+            choice.jobs = best->jobs;
+            choice.realtimeFactor = best->realtimeFactor * scale;
+            return choice;
+        }
+    }
+
+    // 都达不到：退回吞吐量最高的点
+    for (const CalibrationPoint &point : profile.points)
+    {
+        if (point.realtimeFactor * scale > choice.realtimeFactor)
+        {
+            choice.preset = point.preset;
+            choice.jobs = point.jobs;
+            choice.realtimeFactor = point.realtimeFactor * scale;
+        }
+    }
+    return choice;
+}
+
+void Calibration::run()
+{
+    QTemporaryDir workDir;
+    if (!workDir.isValid())
+    {
+        emit finished(CalibrationProfile(), QString::fromLocal8Bit("无法创建临时目录"));
+        return;
+    }
+
+    // 参考片段与常见的入库素材同方向、同为1080p
+    QStringList resParts = m_settings.resolution.split('x');
+    bool portrait = resParts.size() == 2 && resParts[1].toInt() > resParts[0].toInt();
+    QSize clipSize = portrait ? QSize(1080, 1920) : QSize(1920, 1080);
+    QString clipPath = QDir(workDir.path()).absoluteFilePath("reference.mp4");
+
+    emit progress(0, QString::fromLocal8Bit("生成参考片段..."));
+    QProcess generator;
+    generator.start(FFmpegUtils::buildSyntheticClipCommand(clipPath, FFmpegUtils::PATTERN_TESTSRC, clipSize, ReferenceClipSec));
+    if (!generator.waitForStarted() || !generator.waitForFinished(-1) || generator.exitCode() != 0)
+    {
+        emit finished(CalibrationProfile(), QString::fromLocal8Bit("生成参考片段失败，请检查ffmpeg是否可用"));
+        return;
+    }
+
+    int cores = CpuScheduler::availableCores();
+    QStringList presetList = presets();
+    QList<int> levels = concurrencyLevels(cores);
+    int total = presetList.size() * levels.size();
+    int step = 0;
+
+    CalibrationProfile profile;
+    profile.codec = m_settings.codec;
+    profile.resolution = m_settings.resolution;
+    profile.cores = cores;
+    profile.threadsPerJob = m_threadsPerJob;
+
+    for (const QString &preset : presetList)
+    {
+        double previous = 0.0;
+        for (int i = 0; i < levels.size(); ++i)
+        {
+            // 与转码时按选中的并发数调用调度器一致，并发数固定时线程数由每任务线程数设置决定
+            int jobs = levels[i];
+            int threads = CpuScheduler::plan(cores, jobs, m_threadsPerJob, CpuScheduler::policyFromString(m_schedulingPolicy)).threadsPerJob;
+            emit progress(step * 100 / total, QString::fromLocal8Bit("%1 × %2 个任务（每任务 %3 线程）").arg(preset).arg(jobs).arg(threads));
+
+            QString error;
+            double factor = measure(clipPath, workDir.path(), preset, jobs, threads, error);
+            if (m_cancelled.loadAcquire())
+            {
+                emit finished(CalibrationProfile(), QString::fromLocal8Bit("标定已取消"));
+                return;
+            }
+            if (factor < 0)
+            {
+                emit finished(CalibrationProfile(), error);
+                return;
+            }
+
+            profile.points.append({preset, jobs, threads, factor});
+            qDebug() << QString::fromLocal8Bit("标定: %1 × %2 × %3线程 = %4x").arg(preset).arg(jobs).arg(threads).arg(factor, 0, 'f', 2);
+
+            // 已经超额订阅，更高的并发只会更慢
+            if (factor < previous * OversubscribedDrop)
+            {
+                step += levels.size() - i - 1;
+                break;
+            }
+            previous = factor;
+            step++;
+        }
+    }
+
+    profile.measuredAt = QDateTime::currentDateTime().toString(Qt::ISODate);
+    emit progress(100, QString::fromLocal8Bit("标定完成"));
+    emit finished(profile, QString());
+}
+
+double Calibration::measure(const QString &clipPath, const QString &workDir, const QString &preset, int jobs, int threads, QString &error)
+{
+    TranscodeSettings settings = m_settings;
+    settings.preset = preset;
+    FFmpegUtils::TranscodeParams params = TranscodeTask::paramsFromSettings(settings);
+    params.threads = threads;
+    params.fastStart = false;
+
+    std::vector<std::unique_ptr<QProcess>> processes;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < jobs; ++i)
+    {
+        QString outputPath = QDir(workDir).absoluteFilePath(QString("out_%1.mp4").arg(i));
+        // 输出不读取，直接丢弃：等待某个进程结束时不会读其他进程的管道，管道写满后ffmpeg会阻塞
+        processes.emplace_back(new QProcess());
+        processes.back()->setStandardOutputFile(QProcess::nullDevice());
+        processes.back()->setStandardErrorFile(QProcess::nullDevice());
+        processes.back()->start(FFmpegUtils::buildTranscodeCommand(clipPath, outputPath, params));
+    }
+
+    // 在同一个循环中轮询所有进程，取消时全部立即停止
+    bool ok = true;
+    bool running = true;
+    while (running)
+    {
+        running = false;
+        for (auto &process : processes)
+        {
+            if (process->state() == QProcess::NotRunning)
+            {
+                continue;
+            }
+            if (m_cancelled.loadAcquire())
+            {
+                FFmpegUtils::stopProcess(*process, 500, 1000);
+                ok = false;
+                continue;
+            }
+            running = true;
+            process->waitForFinished(qMax(1, PollMs / jobs));
+        }
+    }
+    for (auto &process : processes)
+    {
+        ok = ok && process->error() != QProcess::FailedToStart && process->exitStatus() == QProcess::NormalExit &&
+             process->exitCode() == 0;
+    }
+    qint64 elapsedMs = timer.elapsed();
+
+    if (!ok || elapsedMs <= 0)
+    {
+        error = QString::fromLocal8Bit("编码失败: %1 × %2").arg(preset).arg(jobs);
+        return -1.0;
+    }
+    return double(jobs) * ReferenceClipSec * 1000.0 / elapsedMs;
+}
+
+qint64 Calibration::pixelCount(const QString &resolution)
+{
+    QStringList parts = resolution.split('x');
+    if (parts.size() != 2)
+    {
+        return 0;
+    }
+    return qint64(parts[0].toInt()) * parts[1].toInt();
+}
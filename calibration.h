@@ -0,0 +1,83 @@
+﻿#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QMetaType>
+#include <QStringList>
+#include <configmanager.h>
+
+/**
+ * 本机编码标定
+ * 用一段合成参考片段在每个预设和并发级别下实际编码，测得合计吞吐量，
+ * 得到的成本模型保存在配置中；设定吞吐目标后，由 choose() 选出能达到目标的最高质量预设和并发数。
+ * 每个任务的线程数与转码时一样由调度器按配置的每任务线程数和调度策略决定
+ */
+class Calibration : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * 按吞吐目标选择的结果
+     */
+    struct Choice
+    {
+        bool valid = false;          // 标定结果可用于当前编码器
+        bool achievable = false;     // 是否能达到目标（否则为吞吐量最高的点）
+        QString preset;              // 选中的预设
+        int jobs = 1;                // 选中的并发数
+        double realtimeFactor = 0.0; // 按当前分辨率换算后的合计吞吐量
+        double requiredFactor = 0.0; // 目标对应的吞吐量
+    };
+
+    Calibration(const TranscodeSettings &settings, const SystemSettings &systemSettings, QObject *parent = nullptr);
+
+    // 标定的预设，按速度从快到慢（质量从低到高）
+    static QStringList presets();
+
+    // 标定的并发级别：1、2、4 … 直到核心数
+    static QList<int> concurrencyLevels(int cores);
+
+    /**
+     * 按吞吐目标选择预设和并发数
+     * 取能达到目标的最慢（质量最高）预设，并在该预设下取达到目标的最小并发数，留出CPU给其他服务
+     * @param profile 本机标定结果
+     * @param settings 当前转码设置（编码器需与标定一致，分辨率不同时按像素数换算）
+     * @param threadsPerJob 当前的每任务线程数设置（需与标定一致）
+     * @param targetMinutesPerHour 每小时需要产出的视频分钟数
+     * @param mode output=固定产出，ingest=跟上入库（额外留出余量）
+     * @return 选择结果，都达不到时退回吞吐量最高的点且 achievable 为false
+     */
+    static Choice choose(const CalibrationProfile &profile, const TranscodeSettings &settings, int threadsPerJob,
+                         int targetMinutesPerHour, const QString &mode);
+
+    // 由其他线程调用，当前编码结束后停止
+    void cancel() { m_cancelled.store(1); }
+
+public slots:
+    void run();
+
+signals:
+    void progress(int percent, const QString &message);
+    void finished(const CalibrationProfile &profile, const QString &error); // error为空表示成功
+
+private:
+    TranscodeSettings m_settings;
+    int m_threadsPerJob;        // 每任务线程数设置（0=按策略分配）
+    QString m_schedulingPolicy; // 调度策略
+    QAtomicInt m_cancelled;
+
+    static const int ReferenceClipSec = 6;            // 参考片段时长
+    static const int PollMs = 200;                    // 轮询一遍所有编码进程的间隔
+    static constexpr double IngestHeadroom = 0.25;    // 跟上入库模式的余量
+    static constexpr double OversubscribedDrop = 0.9; // 吞吐量低于上一级的该比例时不再尝试更高并发
+
+    // 同时运行jobs个编码，每个threads个线程，返回合计吞吐量（失败或取消时返回<0）
+    double measure(const QString &clipPath, const QString &workDir, const QString &preset, int jobs, int threads, QString &error);
+    static qint64 pixelCount(const QString &resolution);
+};
+
+Q_DECLARE_METATYPE(CalibrationProfile)
+
+#endif // CALIBRATION_H
@@ -0,0 +1,305 @@
+﻿#include "chunkedtranscodejob.h"
+#include "transcodetask.h"
+#include "transcodetaskmanager.h"
+#include "utils/scratchstaging.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QTextStream>
+
+ChunkedTranscodeJob::ChunkedTranscodeJob(const QString &inputPath, const QString &outputPath,
+                                         const QString &fileName, const TranscodeSettings &settings,
+                                         const FFmpegUtils::MediaInfo &mediaInfo, int segmentCount,
+                                         TranscodeTaskManager *manager)
+    : m_inputPath(inputPath), m_outputPath(outputPath), m_fileName(fileName), m_settings(settings),
+      m_mediaInfo(mediaInfo), m_requestedSegments(qMax(2, segmentCount)), m_manager(manager)
+{
+    m_workDir = workDirFor(outputPath);
+    m_remaining = 0;
+    m_failed = 0;
+}
+
+ChunkedTranscodeJob::~ChunkedTranscodeJob()
+{
+    // 最后一个引用释放时清理分段目录（包括停止后被丢弃的分段）
+    QDir(m_workDir).removeRecursively();
+}
+
+QString ChunkedTranscodeJob::workDirFor(const QString &outputPath)
+{
+    QFileInfo fileInfo(outputPath);
+    return fileInfo.dir().absoluteFilePath("." + fileInfo.completeBaseName() + "_chunks");
+}
+
+void ChunkedTranscodeJob::setScratchDirectory(const QString &directory)
+{
+    // 切分时顺序读取一次源文件，之后各段只读写本地分段
+    m_scratchDirectory = directory;
+    m_workDir = directory.isEmpty() ? workDirFor(m_outputPath)
+                                    : workDirFor(ScratchStaging::localPathFor(directory, m_outputPath));
+}
+
+bool ChunkedTranscodeJob::split()
+{
+    m_wallTimer.start();
+
+    QDir workDir(m_workDir);
+    workDir.removeRecursively();
+    if (!QDir().mkpath(m_workDir))
+    {
+        qDebug() << QString::fromLocal8Bit("无法创建分段目录:") << m_workDir;
+        return false;
+    }
+
+    double segmentSec = m_mediaInfo.durationSec / m_requestedSegments;
+    QString pattern = workDir.absoluteFilePath("seg_%03d.mkv");
+    if (!runProcess(FFmpegUtils::buildSegmentCommand(m_inputPath, pattern, segmentSec)))
+    {
+        return false;
+    }
+
+    m_segments = workDir.entryList(QStringList() << "seg_*.mkv", QDir::Files, QDir::Name);
+    if (m_segments.isEmpty())
+    {
+        return false;
+    }
+
+    m_segmentOutTimeUs.fill(0, m_segments.size());
+    m_segmentFrames.fill(0, m_segments.size());
+    m_segmentFps.fill(0.0, m_segments.size());
+    m_segmentSpeed.fill(0.0, m_segments.size());
+    m_remaining = m_segments.size();
+    m_failed = 0;
+    m_sinceReport.start();
+
+    qDebug() << QString::fromLocal8Bit("分段完成: %1，共 %2 段").arg(m_fileName).arg(m_segments.size());
+    return true;
+}
+
+QString ChunkedTranscodeJob::segmentPath(int index) const
+{
+    return QDir(m_workDir).absoluteFilePath(m_segments.value(index));
+}
+
+QString ChunkedTranscodeJob::encodedSegmentPath(int index) const
+{
+    return QDir(m_workDir).absoluteFilePath(QString("enc_%1.mkv").arg(index, 3, 10, QChar('0')));
+}
+
+void ChunkedTranscodeJob::onSegmentProgress(int index, qint64 frames, qint64 outTimeUs, double fps, double speed)
+{
+    int percent = 0;
+    qint64 totalFrames = 0;
+    double totalFps = 0.0;
+    double totalSpeed = 0.0;
+
+    {
+        QMutexLocker locker(&m_mutex);
+        if (index < 0 || index >= m_segmentOutTimeUs.size())
+        {
+            return;
+        }
+
+        m_segmentOutTimeUs[index] = outTimeUs;
+        m_segmentFrames[index] = frames;
+        m_segmentFps[index] = fps;
+        m_segmentSpeed[index] = speed;
+
+        if (m_sinceReport.elapsed() < ProgressReportIntervalMs)
+        {
+            return;
+        }
+        m_sinceReport.restart();
+
+        // 各分段已输出时长之和相对总时长的比例
+        qint64 doneUs = 0;
+        for (int i = 0; i < m_segmentOutTimeUs.size(); ++i)
+        {
+            doneUs += m_segmentOutTimeUs[i];
+            totalFrames += m_segmentFrames[i];
+            totalFps += m_segmentFps[i];
+            totalSpeed += m_segmentSpeed[i];
+        }
+
+        if (m_mediaInfo.durationSec > 0)
+        {
+            percent = qBound(0, static_cast<int>(doneUs / (m_mediaInfo.durationSec * 10000.0)), 99);
+        }
+    }
+
+    if (m_manager)
+    {
+        m_manager->onTaskProgress(m_fileName, m_inputPath, percent, totalFps, totalSpeed, totalFrames);
+    }
+}
+
+void ChunkedTranscodeJob::onSegmentFinished(int index, bool success, const JobStats &segmentStats)
+{
+    if (!success)
+    {
+        qDebug() << QString::fromLocal8Bit("分段转码失败: %1 #%2").arg(m_fileName).arg(index);
+        m_failed.ref();
+    }
+    else
+    {
+        QMutexLocker locker(&m_mutex);
+        m_segmentFps[index] = 0.0;
+        m_segmentSpeed[index] = 0.0;
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stats.userMs += segmentStats.userMs;
+        m_stats.systemMs += segmentStats.systemMs;
+        m_stats.peakRssKb = qMax(m_stats.peakRssKb, segmentStats.peakRssKb);
+        m_stats.frames += segmentStats.frames;
+    }
+
+    // 最后一个完成的分段负责拼接
+    if (m_remaining.deref())
+    {
+        return;
+    }
+
+    bool ok = m_failed.loadAcquire() == 0 && !isCancelled() && concat();
+
+    qDebug() << QString::fromLocal8Bit("分段拼接%1: %2").arg(ok ? QString::fromLocal8Bit("成功") : QString::fromLocal8Bit("失败")).arg(m_fileName);
+
+    // 此时已没有其他分段在运行，无需加锁
+    m_stats.fileName = m_fileName;
+    m_stats.inputPath = m_inputPath;
+    m_stats.outputPath = m_outputPath;
+    m_stats.success = ok;
+    m_stats.wallMs = m_wallTimer.elapsed();
+    m_stats.inputBytes = QFileInfo(m_inputPath).size();
+    m_stats.outputBytes = ok ? QFileInfo(m_outputPath).size() : 0;
+
+    if (m_manager)
+    {
+        m_manager->onTaskCompleted(m_fileName, ok, m_outputPath, m_stats);
+    }
+}
+
+bool ChunkedTranscodeJob::concat()
+{
+    QString listPath = QDir(m_workDir).absoluteFilePath("concat.txt");
+    QFile listFile(listPath);
+    if (!listFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qDebug() << QString::fromLocal8Bit("无法创建拼接列表:") << listPath;
+        return false;
+    }
+
+    // 使用相对路径，concat按列表文件所在目录解析
+    QTextStream out(&listFile);
+    for (int i = 0; i < m_segments.size(); ++i)
+    {
+        out << "file '" << QFileInfo(encodedSegmentPath(i)).fileName() << "'\n";
+    }
+    out.flush();
+    listFile.close();
+
+    FFmpegUtils::TranscodeParams params;
+    params.audioBitrate = 128;
+    params.fastStart = m_settings.faststart;
+
+    if (m_scratchDirectory.isEmpty())
+    {
+        return runProcess(FFmpegUtils::buildConcatCommand(listPath, m_inputPath, m_outputPath, params));
+    }
+
+    // faststart需要重读重写整个文件，在本地完成后再一次顺序复制到输出路径
+    QString localOutput = QDir(m_workDir).absoluteFilePath("output." + QFileInfo(m_outputPath).suffix());
+    return runProcess(FFmpegUtils::buildConcatCommand(listPath, m_inputPath, localOutput, params)) &&
+           ScratchStaging::copyFile(localOutput, m_outputPath, [this]()
+                                    { return isCancelled(); });
+}
+
+bool ChunkedTranscodeJob::runProcess(const QString &command)
+{
+    QProcess process;
+    process.start(command);
+    if (!process.waitForStarted())
+    {
+        return false;
+    }
+
+    ProcessStats::Tracker tracker(process.processId());
+    while (process.state() != QProcess::NotRunning)
+    {
+        if (isCancelled())
+        {
+            FFmpegUtils::stopProcess(process);
+            return false;
+        }
+        process.waitForFinished(500);
+        tracker.poll();
+    }
+
+    // 切分和拼接的开销也计入该文件
+    ProcessStats::Usage usage = tracker.finish();
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stats.userMs += usage.userMs;
+        m_stats.systemMs += usage.systemMs;
+        m_stats.peakRssKb = qMax(m_stats.peakRssKb, usage.peakRssKb);
+    }
+
+    return process.exitStatus() == QProcess::NormalExit && process.exitCode() == 0;
+}
+
+bool ChunkedTranscodeJob::isCancelled() const
+{
+    return m_manager && m_manager->isStopped();
+}
+
+ChunkSplitTask::ChunkSplitTask(const QSharedPointer<ChunkedTranscodeJob> &job, int threadsPerJob, TranscodeExecutor::Lane lane)
+    : m_job(job), m_threadsPerJob(threadsPerJob), m_lane(lane)
+{
+    setAutoDelete(true);
+}
+
+void ChunkSplitTask::run()
+{
+    TranscodeTaskManager *manager = m_job->manager();
+    if (manager && manager->isStopped())
+    {
+        return;
+    }
+
+    qDebug() << QString::fromLocal8Bit("开始分段转码: %1").arg(m_job->fileName());
+
+    if (manager)
+    {
+        manager->onTaskStarted(m_job->fileName(), m_job->inputPath());
+    }
+
+    if (!m_job->split())
+    {
+        if (manager && manager->isStopped())
+        {
+            return;
+        }
+
+        // 切分失败（如没有可用关键帧）时回退为整体转码
+        qDebug() << QString::fromLocal8Bit("分段失败，回退为整体转码: %1").arg(m_job->fileName());
+        TranscodeTask fallback(m_job->inputPath(), m_job->outputPath(), m_job->fileName(), m_job->settings(), manager);
+        fallback.setThreadCount(m_threadsPerJob);
+        fallback.setMediaInfo(m_job->mediaInfo());
+        fallback.run();
+        return;
+    }
+
+    for (int i = 0; i < m_job->segmentCount(); ++i)
+    {
+        TranscodeTask *task = new TranscodeTask(m_job->segmentPath(i), m_job->encodedSegmentPath(i),
+                                                m_job->fileName(), m_job->settings(), manager);
+        task->setThreadCount(m_threadsPerJob);
+        task->setMediaInfo(m_job->mediaInfo()); // 按整个源文件的参数限制分辨率和帧率，各段一致
+        task->setChunk(m_job, i);
+        manager->submitTask(task, m_lane, SegmentPriority, {m_job->segmentPath(i)}, {m_job->encodedSegmentPath(i)});
+    }
+}
@@ -0,0 +1,111 @@
+﻿#ifndef CHUNKEDTRANSCODEJOB_H
+#define CHUNKEDTRANSCODEJOB_H
+
+#include <QRunnable>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QSharedPointer>
+#include <configmanager.h>
+#include "utils/ffmpegutils.h"
+#include "transcodeexecutor.h"
+#include "transcodereport.h"
+#include "utils/processstats.h"
+
+// 前置声明
+class TranscodeTaskManager;
+
+/**
+ * 分段并行转码的共享状态
+ * 长视频按关键帧切成N段，各段作为独立任务并行编码，
+ * 最后一个完成的分段负责无损拼接并通知管理器
+ */
+class ChunkedTranscodeJob
+{
+public:
+    ChunkedTranscodeJob(const QString &inputPath, const QString &outputPath,
+                        const QString &fileName, const TranscodeSettings &settings,
+                        const FFmpegUtils::MediaInfo &mediaInfo, int segmentCount,
+                        TranscodeTaskManager *manager);
+    ~ChunkedTranscodeJob();
+
+    // 分段工作目录，位于输出文件旁
+    static QString workDirFor(const QString &outputPath);
+
+    // 分段目录和拼接输出放在本地暂存目录中，拼接完成后复制到输出路径（空=位于输出文件旁）
+    void setScratchDirectory(const QString &directory);
+
+    // 切分源视频，成功后 segmentCount() 为实际分段数
+    bool split();
+
+    int segmentCount() const { return m_segments.size(); }
+    QString segmentPath(int index) const;
+    QString encodedSegmentPath(int index) const;
+
+    const QString &inputPath() const { return m_inputPath; }
+    const QString &outputPath() const { return m_outputPath; }
+    const QString &fileName() const { return m_fileName; }
+    const QString &workDir() const { return m_workDir; }
+    const TranscodeSettings &settings() const { return m_settings; }
+    const FFmpegUtils::MediaInfo &mediaInfo() const { return m_mediaInfo; }
+    TranscodeTaskManager *manager() const { return m_manager; }
+
+    // 分段任务回调
+    void onSegmentProgress(int index, qint64 frames, qint64 outTimeUs, double fps, double speed);
+    void onSegmentFinished(int index, bool success, const JobStats &segmentStats);
+
+private:
+    QString m_inputPath;
+    QString m_outputPath;
+    QString m_fileName;
+    TranscodeSettings m_settings;
+    FFmpegUtils::MediaInfo m_mediaInfo;
+    int m_requestedSegments;
+    TranscodeTaskManager *m_manager;
+    QString m_workDir;
+    QString m_scratchDirectory;
+    QStringList m_segments;
+
+    QMutex m_mutex;
+    QVector<qint64> m_segmentOutTimeUs;
+    QVector<qint64> m_segmentFrames;
+    QVector<double> m_segmentFps;
+    QVector<double> m_segmentSpeed;
+    QElapsedTimer m_sinceReport;
+    QAtomicInt m_remaining;
+    QAtomicInt m_failed;
+
+    // 资源统计：CPU时间和帧数为各段之和，峰值内存取各进程最大值
+    QElapsedTimer m_wallTimer;
+    JobStats m_stats;
+
+    static const int ProgressReportIntervalMs = 1000; // 合并进度上报的最小间隔
+
+    bool concat();
+    bool runProcess(const QString &command);
+    bool isCancelled() const;
+};
+
+/**
+ * 分段转码的入口任务
+ * 在线程池中切分源视频，然后把各分段作为独立任务提交给管理器
+ */
+class ChunkSplitTask : public QRunnable
+{
+public:
+    ChunkSplitTask(const QSharedPointer<ChunkedTranscodeJob> &job, int threadsPerJob, TranscodeExecutor::Lane lane);
+
+    void run() override;
+
+private:
+    QSharedPointer<ChunkedTranscodeJob> m_job;
+    int m_threadsPerJob;
+    TranscodeExecutor::Lane m_lane; // 分段与所属文件使用同一通道
+
+    static const int SegmentPriority = 1; // 分段优先于队列中的新文件，尽早完成已开始的文件
+};
+
+#endif // CHUNKEDTRANSCODEJOB_H
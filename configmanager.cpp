@@ -1,9 +1,9 @@
 ﻿#include "configmanager.h"
 #include <QJsonObject>
 #include <QJsonDocument>
+#include <QJsonArray>
 #include <QFile>
 #include <QDebug>
-#include <QApplication>
 
 ConfigManager *ConfigManager::m_instance = nullptr;
 
@@ -48,14 +48,19 @@ QString ConfigManager::getConfigFilePath() const
 bool ConfigManager::loadConfig()
 {
     QString configPath = getConfigFilePath();
-    QFile file(configPath);
 
-    if (!file.exists())
+    if (!QFile::exists(configPath))
     {
         qDebug() << QString::fromLocal8Bit("配置文件不存在，使用默认设置:") << configPath;
         return saveConfig(); // 创建默认配置文件
     }
 
+    return loadConfigFrom(configPath);
+}
+
+bool ConfigManager::loadConfigFrom(const QString &configPath)
+{
+    QFile file(configPath);
     if (!file.open(QIODevice::ReadOnly))
     {
         qDebug() << QString::fromLocal8Bit("无法打开配置文件:") << file.errorString();
@@ -79,7 +84,7 @@ bool ConfigManager::loadConfig()
     // 加载转码设置
     if (root.contains("transcode"))
     {
-        transcodeSettingsFromJson(root["transcode"].toObject());
+        transcodeSettingsFromJson(root["transcode"].toObject(), m_transcodeSettings);
     }
 
     // 加载系统设置
@@ -105,7 +110,7 @@ bool ConfigManager::saveConfig()
 
     QJsonObject root;
     root["version"] = "1.0";
-    root["transcode"] = transcodeSettingsToJson();
+    root["transcode"] = transcodeSettingsToJson(m_transcodeSettings);
     root["system"] = systemSettingsToJson();
 
     QJsonDocument doc(root);
@@ -124,26 +129,46 @@ void ConfigManager::setTranscodeSettings(const TranscodeSettings &settings)
     emit configChanged();
 }
 
-void ConfigManager::setSystemSettings(const SystemSettings &settings)
+void ConfigManager::setSystemSettings(const SystemSettings &settings, bool save)
 {
     m_systemSettings = settings;
-    saveConfig();
+    if (save)
+    {
+        saveConfig();
+    }
     emit systemSettingsChanged();
     emit configChanged();
 }
 
-QJsonObject ConfigManager::transcodeSettingsToJson() const
+QJsonObject ConfigManager::transcodeSettingsToJson(const TranscodeSettings &settings)
 {
     QJsonObject json;
-    json["codec"] = m_transcodeSettings.codec;
-    json["crf"] = m_transcodeSettings.crf;
-    json["preset"] = m_transcodeSettings.preset;
-    json["resolution"] = m_transcodeSettings.resolution;
-    json["framerate"] = m_transcodeSettings.framerate;
-    json["pixelFormat"] = m_transcodeSettings.pixelFormat;
-    json["colorspace"] = m_transcodeSettings.colorspace;
-    json["faststart"] = m_transcodeSettings.faststart;
-    json["profile"] = m_transcodeSettings.profile;
+    json["codec"] = settings.codec;
+    json["crf"] = settings.crf;
+    json["preset"] = settings.preset;
+    json["resolution"] = settings.resolution;
+    json["framerate"] = settings.framerate;
+    json["pixelFormat"] = settings.pixelFormat;
+    json["colorspace"] = settings.colorspace;
+    json["faststart"] = settings.faststart;
+    json["streamCopy"] = settings.streamCopy;
+    json["profile"] = settings.profile;
+    json["engine"] = settings.engine;
+    json["scaleMode"] = settings.scaleMode;
+    json["scaleAlgorithm"] = settings.scaleAlgorithm;
+    json["noUpscale"] = settings.noUpscale;
+    json["noFrameRateIncrease"] = settings.noFrameRateIncrease;
+
+    QJsonArray renditions;
+    for (const Rendition &rendition : settings.renditions)
+    {
+        QJsonObject item;
+        item["resolution"] = rendition.resolution;
+        item["crf"] = rendition.crf;
+        item["maxBitrateKbps"] = rendition.maxBitrateKbps;
+        renditions.append(item);
+    }
+    json["renditions"] = renditions;
     return json;
 }
 
@@ -158,29 +183,118 @@ QJsonObject ConfigManager::systemSettingsToJson() const
     json["showNotifications"] = m_systemSettings.showNotifications;
     json["autoStart"] = m_systemSettings.autoStart;
     json["threadCount"] = m_systemSettings.threadCount;
+    json["schedulingPolicy"] = m_systemSettings.schedulingPolicy;
+    json["threadsPerJob"] = m_systemSettings.threadsPerJob;
+    json["adaptiveConcurrency"] = m_systemSettings.adaptiveConcurrency;
+    json["minConcurrentJobs"] = m_systemSettings.minConcurrentJobs;
+    json["maxConcurrentJobs"] = m_systemSettings.maxConcurrentJobs;
+    json["urgentLaneJobs"] = m_systemSettings.urgentLaneJobs;
+    json["normalLaneJobs"] = m_systemSettings.normalLaneJobs;
+    json["backgroundLaneJobs"] = m_systemSettings.backgroundLaneJobs;
+    json["jobOrder"] = m_systemSettings.jobOrder;
+    json["chunkedEncoding"] = m_systemSettings.chunkedEncoding;
+    json["chunkThresholdSec"] = m_systemSettings.chunkThresholdSec;
+    json["scratchStaging"] = m_systemSettings.scratchStaging;
+    json["scratchDirectory"] = m_systemSettings.scratchDirectory;
+    json["minFreeSpaceMb"] = m_systemSettings.minFreeSpaceMb;
+    json["readersPerDevice"] = m_systemSettings.readersPerDevice;
+    json["writersPerDevice"] = m_systemSettings.writersPerDevice;
+    json["metricsEnabled"] = m_systemSettings.metricsEnabled;
+    json["metricsPort"] = m_systemSettings.metricsPort;
+    json["throughputTargetMinutes"] = m_systemSettings.throughputTargetMinutes;
+    json["throughputMode"] = m_systemSettings.throughputMode;
+    json["calibration"] = calibrationToJson(m_systemSettings.calibration);
     return json;
 }
 
-void ConfigManager::transcodeSettingsFromJson(const QJsonObject &json)
+void ConfigManager::transcodeSettingsFromJson(const QJsonObject &json, TranscodeSettings &settings)
 {
     if (json.contains("codec"))
-        m_transcodeSettings.codec = json["codec"].toString();
+        settings.codec = json["codec"].toString();
     if (json.contains("crf"))
-        m_transcodeSettings.crf = json["crf"].toInt();
+        settings.crf = json["crf"].toInt();
     if (json.contains("preset"))
-        m_transcodeSettings.preset = json["preset"].toString();
+        settings.preset = json["preset"].toString();
     if (json.contains("resolution"))
-        m_transcodeSettings.resolution = json["resolution"].toString();
+        settings.resolution = json["resolution"].toString();
     if (json.contains("framerate"))
-        m_transcodeSettings.framerate = json["framerate"].toInt();
+        settings.framerate = json["framerate"].toInt();
     if (json.contains("pixelFormat"))
-        m_transcodeSettings.pixelFormat = json["pixelFormat"].toString();
+        settings.pixelFormat = json["pixelFormat"].toString();
     if (json.contains("colorspace"))
-        m_transcodeSettings.colorspace = json["colorspace"].toString();
+        settings.colorspace = json["colorspace"].toString();
     if (json.contains("faststart"))
-        m_transcodeSettings.faststart = json["faststart"].toBool();
+        settings.faststart = json["faststart"].toBool();
+    if (json.contains("streamCopy"))
+        settings.streamCopy = json["streamCopy"].toBool();
     if (json.contains("profile"))
-        m_transcodeSettings.profile = json["profile"].toString();
+        settings.profile = json["profile"].toString();
+    if (json.contains("engine"))
+        settings.engine = json["engine"].toString();
+    if (json.contains("scaleMode"))
+        settings.scaleMode = json["scaleMode"].toString();
+    if (json.contains("scaleAlgorithm"))
+        settings.scaleAlgorithm = json["scaleAlgorithm"].toString();
+    if (json.contains("noUpscale"))
+        settings.noUpscale = json["noUpscale"].toBool();
+    if (json.contains("noFrameRateIncrease"))
+        settings.noFrameRateIncrease = json["noFrameRateIncrease"].toBool();
+    if (json.contains("renditions"))
+    {
+        settings.renditions.clear();
+        for (const QJsonValue &value : json["renditions"].toArray())
+        {
+            QJsonObject item = value.toObject();
+            Rendition rendition;
+            rendition.resolution = item["resolution"].toString();
+            rendition.crf = item["crf"].toInt();
+            rendition.maxBitrateKbps = item["maxBitrateKbps"].toInt();
+            if (!rendition.resolution.isEmpty())
+            {
+                settings.renditions.append(rendition);
+            }
+        }
+    }
+}
+
+QList<Rendition> ConfigManager::parseRenditions(const QString &text)
+{
+    QList<Rendition> renditions;
+    for (const QString &entry : text.split(',', Qt::SkipEmptyParts))
+    {
+        QStringList fields = entry.trimmed().split(':');
+        QStringList size = fields[0].split('x');
+        if (size.size() != 2 || size[0].toInt() <= 0 || size[1].toInt() <= 0)
+        {
+            continue; // 忽略无法识别的分辨率
+        }
+
+        Rendition rendition;
+        rendition.resolution = QString("%1x%2").arg(size[0].toInt()).arg(size[1].toInt());
+        rendition.crf = fields.size() > 1 ? qBound(0, fields[1].toInt(), 51) : 0;
+        rendition.maxBitrateKbps = fields.size() > 2 ? qMax(0, fields[2].toInt()) : 0;
+        renditions.append(rendition);
+    }
+    return renditions;
+}
+
+QString ConfigManager::formatRenditions(const QList<Rendition> &renditions)
+{
+    QStringList entries;
+    for (const Rendition &rendition : renditions)
+    {
+        QString entry = rendition.resolution;
+        if (rendition.crf > 0 || rendition.maxBitrateKbps > 0)
+        {
+            entry += QString(":%1").arg(rendition.crf);
+        }
+        if (rendition.maxBitrateKbps > 0)
+        {
+            entry += QString(":%1").arg(rendition.maxBitrateKbps);
+        }
+        entries.append(entry);
+    }
+    return entries.join(',');
 }
 
 void ConfigManager::systemSettingsFromJson(const QJsonObject &json)
@@ -201,4 +315,91 @@ void ConfigManager::systemSettingsFromJson(const QJsonObject &json)
         m_systemSettings.autoStart = json["autoStart"].toBool();
     if (json.contains("threadCount"))
         m_systemSettings.threadCount = json["threadCount"].toInt();
+    if (json.contains("schedulingPolicy"))
+        m_systemSettings.schedulingPolicy = json["schedulingPolicy"].toString();
+    if (json.contains("threadsPerJob"))
+        m_systemSettings.threadsPerJob = json["threadsPerJob"].toInt();
+    if (json.contains("adaptiveConcurrency"))
+        m_systemSettings.adaptiveConcurrency = json["adaptiveConcurrency"].toBool();
+    if (json.contains("minConcurrentJobs"))
+        m_systemSettings.minConcurrentJobs = json["minConcurrentJobs"].toInt();
+    if (json.contains("maxConcurrentJobs"))
+        m_systemSettings.maxConcurrentJobs = json["maxConcurrentJobs"].toInt();
+    if (json.contains("urgentLaneJobs"))
+        m_systemSettings.urgentLaneJobs = json["urgentLaneJobs"].toInt();
+    if (json.contains("normalLaneJobs"))
+        m_systemSettings.normalLaneJobs = json["normalLaneJobs"].toInt();
+    if (json.contains("backgroundLaneJobs"))
+        m_systemSettings.backgroundLaneJobs = json["backgroundLaneJobs"].toInt();
+    if (json.contains("jobOrder"))
+        m_systemSettings.jobOrder = json["jobOrder"].toString();
+    if (json.contains("chunkedEncoding"))
+        m_systemSettings.chunkedEncoding = json["chunkedEncoding"].toBool();
+    if (json.contains("chunkThresholdSec"))
+        m_systemSettings.chunkThresholdSec = json["chunkThresholdSec"].toInt();
+    if (json.contains("scratchStaging"))
+        m_systemSettings.scratchStaging = json["scratchStaging"].toBool();
+    if (json.contains("scratchDirectory"))
+        m_systemSettings.scratchDirectory = json["scratchDirectory"].toString();
+    if (json.contains("minFreeSpaceMb"))
+        m_systemSettings.minFreeSpaceMb = json["minFreeSpaceMb"].toInt();
+    if (json.contains("readersPerDevice"))
+        m_systemSettings.readersPerDevice = json["readersPerDevice"].toInt();
+    if (json.contains("writersPerDevice"))
+        m_systemSettings.writersPerDevice = json["writersPerDevice"].toInt();
+    if (json.contains("metricsEnabled"))
+        m_systemSettings.metricsEnabled = json["metricsEnabled"].toBool();
+    if (json.contains("metricsPort"))
+        m_systemSettings.metricsPort = json["metricsPort"].toInt();
+    if (json.contains("throughputTargetMinutes"))
+        m_systemSettings.throughputTargetMinutes = json["throughputTargetMinutes"].toInt();
+    if (json.contains("throughputMode"))
+        m_systemSettings.throughputMode = json["throughputMode"].toString();
+    if (json.contains("calibration"))
+        m_systemSettings.calibration = calibrationFromJson(json["calibration"].toObject());
+}
+
+QJsonObject ConfigManager::calibrationToJson(const CalibrationProfile &profile)
+{
+    QJsonArray points;
+    for (const CalibrationPoint &point : profile.points)
+    {
+        QJsonObject json;
+        json["preset"] = point.preset;
+        json["jobs"] = point.jobs;
+        json["threads"] = point.threads;
+        json["realtimeFactor"] = point.realtimeFactor;
+        points.append(json);
+    }
+
+    QJsonObject json;
+    json["codec"] = profile.codec;
+    json["resolution"] = profile.resolution;
+    json["cores"] = profile.cores;
+    json["threadsPerJob"] = profile.threadsPerJob;
+    json["measuredAt"] = profile.measuredAt;
+    json["points"] = points;
+    return json;
+}
+
+CalibrationProfile ConfigManager::calibrationFromJson(const QJsonObject &json)
+{
+    CalibrationProfile profile;
+    profile.codec = json["codec"].toString();
+    profile.resolution = json["resolution"].toString();
+    profile.cores = json["cores"].toInt();
+    profile.threadsPerJob = json["threadsPerJob"].toInt();
+    profile.measuredAt = json["measuredAt"].toString();
+
+    for (const QJsonValue &value : json["points"].toArray())
+    {
+        QJsonObject object = value.toObject();
+        CalibrationPoint point;
+        point.preset = object["preset"].toString();
+        point.jobs = object["jobs"].toInt(1);
+        point.threads = object["threads"].toInt();
+        point.realtimeFactor = object["realtimeFactor"].toDouble();
+        profile.points.append(point);
+    }
+    return profile;
 }
@@ -7,31 +7,90 @@
 #include <QString>
 #include <QStandardPaths>
 #include <QDir>
+#include <QList>
+
+// 附加输出规格（码率阶梯中的一级），与主输出共用一次解码
+struct Rendition
+{
+    QString resolution;     // 输出分辨率，如 480x854，同时用作文件名后缀
+    int crf = 0;            // 0表示沿用主输出的CRF
+    int maxBitrateKbps = 0; // 峰值码率上限，0表示不限制
+};
 
 struct TranscodeSettings
 {
 
-    QString codec = "libx264";       // 编码器
-    int crf = 23;                    // CRF质量
-    QString preset = "medium";       // 编码预设
-    QString resolution = "720x1280"; // 分辨率
-    int framerate = 30;              // 帧率
-    QString pixelFormat = "yuv420p"; // 像素格式
-    QString colorspace = "bt709";    // 色彩空间
-    bool faststart = true;           // 快速启动
-    QString profile = "high";        // 编码档次
+    QString codec = "libx264";          // 编码器
+    int crf = 23;                       // CRF质量
+    QString preset = "medium";          // 编码预设
+    QString resolution = "720x1280";    // 分辨率
+    int framerate = 30;                 // 帧率
+    QString pixelFormat = "yuv420p";    // 像素格式
+    QString colorspace = "bt709";       // 色彩空间
+    bool faststart = true;              // 快速启动
+    QString profile = "high";           // 编码档次
+    bool streamCopy = true;             // 源流已符合目标参数时直接复制
+    QString engine = "ffmpeg";          // 转码引擎：ffmpeg（启动进程）/libav（进程内）
+    QString scaleMode = "pad";          // 缩放方式：fit/fill/pad/stretch
+    QString scaleAlgorithm = "bicubic"; // 缩放算法：fast_bilinear/bilinear/bicubic/lanczos
+    bool noUpscale = false;             // 分辨率不超过源文件（resolution作为上限）
+    bool noFrameRateIncrease = false;   // 帧率不超过源文件（framerate作为上限）
+    QList<Rendition> renditions;        // 附加输出，为空时只输出主分辨率
+};
+
+// 标定测得的一个成本点：某预设在某并发数下的合计吞吐量
+struct CalibrationPoint
+{
+    QString preset;              // 编码预设
+    int jobs = 1;                // 并发任务数
+    int threads = 0;             // 每个任务的编码线程数
+    double realtimeFactor = 0.0; // 合计每秒墙钟时间产出的视频秒数
+};
+
+// 本机的编码成本模型，由标定生成
+struct CalibrationProfile
+{
+    QString codec;                  // 标定时的编码器
+    QString resolution;             // 标定时的输出分辨率
+    int cores = 0;                  // 标定时的逻辑核心数
+    int threadsPerJob = 0;          // 标定时的每任务线程数设置，与当前设置不同时成本点不再适用
+    QString measuredAt;             // 标定时间
+    QList<CalibrationPoint> points; // 成本点
+
+    bool isValid() const { return !points.isEmpty(); }
 };
 
 struct SystemSettings
 {
-    QString theme = "modern";       // 主题：modern/dark
-    QString language = "zh_CN";     // 语言
-    bool autoSaveProgress = true;   // 自动保存进度
-    QString defaultSourcePath = ""; // 默认源目录
-    QString defaultTargetPath = ""; // 默认输出目录
-    bool showNotifications = true;  // 显示通知
-    bool autoStart = false;         // 开机自启
-    int threadCount = 0;            // 线程数（0=自动检测）
+    QString theme = "modern";              // 主题：modern/dark
+    QString language = "zh_CN";            // 语言
+    bool autoSaveProgress = true;          // 自动保存进度
+    QString defaultSourcePath = "";        // 默认源目录
+    QString defaultTargetPath = "";        // 默认输出目录
+    bool showNotifications = true;         // 显示通知
+    bool autoStart = false;                // 开机自启
+    int threadCount = 0;                   // 线程数（0=自动检测）
+    QString schedulingPolicy = "balanced"; // 调度策略：throughput/balanced/latency
+    int threadsPerJob = 0;                 // 每个任务的编码线程数（0=按调度策略）
+    bool adaptiveConcurrency = true;       // 运行期间按实测帧率调整并发数
+    int minConcurrentJobs = 1;             // 自适应并发的下限
+    int maxConcurrentJobs = 0;             // 自适应并发的上限（0=核心数 / 每任务线程数 + 1）
+    int urgentLaneJobs = 0;                // 紧急通道并发上限（0=只受总并发限制）
+    int normalLaneJobs = 0;                // 普通通道并发上限
+    int backgroundLaneJobs = 0;            // 后台通道并发上限
+    QString jobOrder = "longestFirst";     // 任务顺序：name/longestFirst/shortestFirst
+    bool chunkedEncoding = true;           // 长视频分段并行转码
+    int chunkThresholdSec = 1200;          // 估计工作量超过该秒数时启用分段转码
+    bool scratchStaging = false;           // 源文件和输出先在本地暂存目录处理（适合网络存储）
+    QString scratchDirectory = "";         // 暂存目录（空=系统临时目录，可指向tmpfs）
+    int minFreeSpaceMb = 2048;             // 输出和暂存所在磁盘的剩余空间下限，低于时暂停启动新任务（0=不检查）
+    int readersPerDevice = 0;              // 同一设备上同时读取的任务数（0=不限制）
+    int writersPerDevice = 0;              // 同一设备上同时写入的任务数（0=不限制）
+    bool metricsEnabled = false;           // 在本机端口提供Prometheus指标
+    int metricsPort = 9464;                // 指标端口（仅监听127.0.0.1）
+    int throughputTargetMinutes = 0;       // 吞吐目标：每小时产出的视频分钟数（0=不按标定自动选择）
+    QString throughputMode = "output";     // 目标类型：output=固定产出/ingest=跟上入库（留余量）
+    CalibrationProfile calibration;        // 本机标定结果
 };
 
 class ConfigManager : public QObject
@@ -47,13 +106,22 @@ public:
 
     // 系统设置
     const SystemSettings &getSystemSettings() const { return m_systemSettings; }
-    void setSystemSettings(const SystemSettings &settings);
+    void setSystemSettings(const SystemSettings &settings, bool save = true); // save为false时只在本进程内生效
 
     // 文件操作
     bool loadConfig();
+    bool loadConfigFrom(const QString &configPath); // 从指定文件加载（不写回默认配置文件）
     bool saveConfig();
     QString getConfigFilePath() const;
 
+    // 转码设置与JSON互转（也用于转码日志中记录批次设置）
+    static QJsonObject transcodeSettingsToJson(const TranscodeSettings &settings);
+    static void transcodeSettingsFromJson(const QJsonObject &json, TranscodeSettings &settings);
+
+    // 附加输出与文本互转，格式为逗号分隔的 宽x高[:crf[:峰值码率kbps]]，如 "480x854:28,1080x1920"
+    static QList<Rendition> parseRenditions(const QString &text);
+    static QString formatRenditions(const QList<Rendition> &renditions);
+
 signals:
     void configChanged();
     void transcodeSettingsChanged();
@@ -67,10 +135,10 @@ private:
     SystemSettings m_systemSettings;
 
     void setDefaultValues();
-    QJsonObject transcodeSettingsToJson() const;
     QJsonObject systemSettingsToJson() const;
-    void transcodeSettingsFromJson(const QJsonObject &json);
     void systemSettingsFromJson(const QJsonObject &json);
+    static QJsonObject calibrationToJson(const CalibrationProfile &profile);
+    static CalibrationProfile calibrationFromJson(const QJsonObject &json);
 };
 
 #endif // CONFIGMANAGER_H
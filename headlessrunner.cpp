@@ -0,0 +1,375 @@
+﻿#include "headlessrunner.h"
+#include "configmanager.h"
+#include "transcodetaskmanager.h"
+#include "transcodejournal.h"
+#include "watchfolderservice.h"
+#include "calibration.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QThread>
+#include <QTimer>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+    // 信号处理函数中只能写入sig_atomic_t，由定时器在事件循环中检查
+    volatile std::sig_atomic_t g_receivedSignal = 0;
+
+    void onTerminationSignal(int signal)
+    {
+        g_receivedSignal = signal;
+    }
+}
+
+HeadlessRunner::HeadlessRunner(QObject *parent)
+    : QObject(parent)
+{
+}
+
+HeadlessRunner::~HeadlessRunner()
+{
+}
+
+bool HeadlessRunner::isRequested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--headless") == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+int HeadlessRunner::exec(QCoreApplication &app)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QString::fromLocal8Bit("无界面批量转码，进度以JSON Lines输出到stdout"));
+    QCommandLineOption helpOption = parser.addHelpOption();
+    QCommandLineOption headlessOption("headless", QString::fromLocal8Bit("以无界面模式运行"));
+    QCommandLineOption sourceOption(QStringList() << "s" << "source", QString::fromLocal8Bit("源目录，可重复指定"), "dir");
+    QCommandLineOption targetOption(QStringList() << "t" << "target", QString::fromLocal8Bit("输出目录"), "dir");
+    QCommandLineOption settingsOption("settings", QString::fromLocal8Bit("配置文件，格式与transcoder_config.json相同"), "file");
+    QCommandLineOption watchOption("watch", QString::fromLocal8Bit("持续监视源目录，新文件写入完成后自动转码，直到收到SIGINT/SIGTERM"));
+    QCommandLineOption resumeOption("resume", QString::fromLocal8Bit("继续上次被中断的无界面批次，沿用当时的文件、输出目录和设置"));
+    QCommandLineOption calibrateOption("calibrate", QString::fromLocal8Bit("按当前编码器和分辨率标定本机编码吞吐量，结果保存到用户配置"));
+    parser.addOption(headlessOption);
+    parser.addOption(sourceOption);
+    parser.addOption(targetOption);
+    parser.addOption(settingsOption);
+    parser.addOption(watchOption);
+    parser.addOption(resumeOption);
+    parser.addOption(calibrateOption);
+    parser.addPositionalArgument("sources", QString::fromLocal8Bit("源目录（也可以用 --source 指定）"), "[dir...]");
+
+    if (!parser.parse(app.arguments()))
+    {
+        std::fprintf(stderr, "%s\n", qPrintable(parser.errorText()));
+        return ExitUsage;
+    }
+
+    if (parser.isSet(helpOption))
+    {
+        std::fprintf(stdout, "%s", qPrintable(parser.helpText()));
+        return ExitSuccess;
+    }
+
+    // 指定的配置文件覆盖用户配置，但不写回
+    ConfigManager *config = ConfigManager::instance();
+    if (parser.isSet(settingsOption) && !config->loadConfigFrom(parser.value(settingsOption)))
+    {
+        emitEvent("error", {{"message", QString::fromLocal8Bit("无法加载配置文件: %1").arg(parser.value(settingsOption))}});
+        return ExitUsage;
+    }
+
+    if (parser.isSet(calibrateOption))
+    {
+        // 使用 --settings 时标定结果只输出，不覆盖用户配置
+        return runCalibration(!parser.isSet(settingsOption));
+    }
+
+    // 监视模式启动时会重新扫描存量文件，中断的文件随之重新加入，不需要 --resume
+    bool watch = parser.isSet(watchOption);
+    bool resume = parser.isSet(resumeOption) && !watch;
+    QStringList sources = parser.values(sourceOption) + parser.positionalArguments();
+    QString target = parser.value(targetOption);
+    if (!resume && (sources.isEmpty() || target.isEmpty()))
+    {
+        std::fprintf(stderr, "%s", qPrintable(parser.helpText()));
+        return ExitUsage;
+    }
+
+    // 无界面批次使用独立的恢复日志，不会截断界面上未完成批次的日志；
+    // 中断文件的临时输出和分段目录只是半成品，无论是否继续都先删除
+    QString journalPath = TranscodeJournal::headlessPath();
+    TranscodeJournal::Recovery recovery;
+    if (TranscodeJournal::isLocked(journalPath))
+    {
+        // 另一个无界面批次正在运行：不动它的日志和临时文件，本批次不记录恢复日志
+        if (resume)
+        {
+            emitEvent("error", {{"message", QString::fromLocal8Bit("另一个无界面批次正在运行，无法继续中断的批次")}});
+            return ExitError;
+        }
+        emitEvent("journalBusy", {{"journal", journalPath}});
+    }
+    else
+    {
+        recovery = TranscodeJournal::recover(journalPath);
+        TranscodeJournal::cleanOrphans(recovery);
+        if (!resume)
+        {
+            if (!recovery.isEmpty())
+            {
+                emitEvent("recoveryDiscarded", {{"files", recovery.fileCount()}, {"target", recovery.targetDirectory}});
+            }
+            TranscodeJournal::remove(journalPath);
+        }
+    }
+
+    TranscodeSettings settings = config->getTranscodeSettings();
+    QMap<QString, QStringList> files;
+    if (resume)
+    {
+        // 沿用中断批次的输出目录和设置，续转的文件与已完成的保持一致
+        files = recovery.files;
+        if (!recovery.isEmpty())
+        {
+            target = recovery.targetDirectory;
+            settings = recovery.settings;
+        }
+    }
+    else if (!watch)
+    {
+        // 监视模式下已有文件和新文件一样由监视服务在稳定后逐个加入
+        files = TranscodeTaskManager::collectVideoFiles(sources);
+    }
+    for (const QStringList &names : files)
+    {
+        m_totalFiles += names.size();
+    }
+
+    QJsonObject batch;
+    batch["files"] = m_totalFiles;
+    batch["target"] = target.isEmpty() ? QString() : QDir(target).absolutePath();
+    batch["watch"] = watch;
+    batch["resume"] = resume;
+    emitEvent("batch", batch);
+
+    if (files.isEmpty() && !watch)
+    {
+        emitEvent("finished", {{"succeeded", 0}, {"failed", 0}});
+        return ExitSuccess;
+    }
+
+    // 与界面相同：管理器运行在独立线程中，探测和提交任务不阻塞事件循环
+    m_workerThread = new QThread(this);
+    m_manager = new TranscodeTaskManager(files);
+    m_manager->setTargetDirectory(QDir(target).absolutePath());
+    m_manager->setTranscodeSettings(settings);
+    m_manager->setJournalPath(journalPath);
+    m_manager->setContinuous(watch);
+    m_manager->moveToThread(m_workerThread);
+
+    connect(m_manager, &TranscodeTaskManager::currentFileChanged, this, &HeadlessRunner::onCurrentFileChanged, Qt::QueuedConnection);
+    connect(m_manager, &TranscodeTaskManager::fileProgressUpdated, this, &HeadlessRunner::onFileProgressUpdated, Qt::QueuedConnection);
+    connect(m_manager, &TranscodeTaskManager::fileProcessed, this, &HeadlessRunner::onFileProcessed, Qt::QueuedConnection);
+    connect(m_manager, &TranscodeTaskManager::fileStatsUpdated, this, &HeadlessRunner::onFileStatsUpdated, Qt::QueuedConnection);
+    connect(m_manager, &TranscodeTaskManager::progressUpdated, this, &HeadlessRunner::onProgressUpdated, Qt::QueuedConnection);
+    connect(m_manager, &TranscodeTaskManager::errorOccurred, this, &HeadlessRunner::onErrorOccurred, Qt::QueuedConnection);
+    connect(m_manager, &TranscodeTaskManager::admissionPausedChanged, this, &HeadlessRunner::onAdmissionPausedChanged, Qt::QueuedConnection);
+    connect(m_manager, &TranscodeTaskManager::finished, this, &HeadlessRunner::onFinished, Qt::QueuedConnection);
+
+    connect(m_workerThread, &QThread::started, m_manager, &TranscodeTaskManager::start);
+    connect(m_manager, &TranscodeTaskManager::finished, m_workerThread, &QThread::quit);
+    connect(m_workerThread, &QThread::finished, m_manager, &QObject::deleteLater);
+
+    installSignalHandlers();
+    m_signalTimer = new QTimer(this);
+    connect(m_signalTimer, &QTimer::timeout, this, &HeadlessRunner::checkSignals);
+    m_signalTimer->start(SignalPollMs);
+
+    if (watch)
+    {
+        m_watcher = new WatchFolderService(this);
+        connect(m_watcher, &WatchFolderService::fileReady, this, &HeadlessRunner::onFileDetected);
+        connect(m_watcher, &WatchFolderService::fileReady, m_manager, &TranscodeTaskManager::enqueueFile, Qt::QueuedConnection);
+        for (const QString &source : sources)
+        {
+            if (!m_watcher->addDirectory(source))
+            {
+                emitEvent("error", {{"message", QString::fromLocal8Bit("无法监视目录: %1").arg(source)}});
+            }
+        }
+    }
+
+    m_workerThread->start();
+    return app.exec();
+}
+
+void HeadlessRunner::onCurrentFileChanged(const QString &fileName)
+{
+    emitEvent("started", {{"file", fileName}});
+}
+
+void HeadlessRunner::onFileProgressUpdated(const QString &fileName, int percent, double fps, double speed)
+{
+    emitEvent("progress", {{"file", fileName}, {"percent", percent}, {"fps", fps}, {"speed", speed}});
+}
+
+void HeadlessRunner::onFileProcessed(const QString &fileName, bool success)
+{
+    if (success)
+    {
+        m_succeeded++;
+    }
+    else
+    {
+        m_failed++;
+    }
+    emitEvent("file", {{"file", fileName}, {"success", success}});
+}
+
+void HeadlessRunner::onFileStatsUpdated(const JobStats &stats)
+{
+    emitEvent("stats", {{"file", stats.fileName},
+                        {"wallMs", stats.wallMs},
+                        {"userMs", stats.userMs},
+                        {"systemMs", stats.systemMs},
+                        {"peakRssKb", stats.peakRssKb},
+                        {"inputBytes", stats.inputBytes},
+                        {"outputBytes", stats.outputBytes},
+                        {"fps", stats.fps()}});
+}
+
+void HeadlessRunner::onProgressUpdated(int value)
+{
+    emitEvent("batchProgress", {{"percent", value}});
+}
+
+void HeadlessRunner::onErrorOccurred(const QString &errorMessage)
+{
+    m_hadError = true;
+    emitEvent("error", {{"message", errorMessage}});
+}
+
+void HeadlessRunner::onAdmissionPausedChanged(bool paused, const QString &reason)
+{
+    emitEvent("admission", {{"paused", paused}, {"reason", reason}});
+}
+
+void HeadlessRunner::onFinished()
+{
+    if (m_finished)
+    {
+        return;
+    }
+    m_finished = true;
+    m_signalTimer->stop();
+    if (m_watcher)
+    {
+        m_watcher->disconnect();
+    }
+
+    // 等待工作线程退出：管理器随线程结束被销毁，析构时等待ffmpeg子进程全部退出
+    m_workerThread->quit();
+    m_workerThread->wait();
+    m_manager = nullptr;
+
+    // 监视模式只能通过信号结束，这是正常停止
+    int code = ExitSuccess;
+    if (m_interrupted && !m_watcher)
+    {
+        code = ExitInterrupted;
+    }
+    else if (m_hadError)
+    {
+        code = ExitError;
+    }
+    else if (m_failed > 0)
+    {
+        code = ExitFailures;
+    }
+
+    emitEvent("finished", {{"succeeded", m_succeeded}, {"failed", m_failed}, {"interrupted", m_interrupted}, {"exitCode", code}});
+    QCoreApplication::exit(code);
+}
+
+void HeadlessRunner::onFileDetected(const QString &sourceDir, const QString &fileName, bool backlog)
+{
+    emitEvent("detected", {{"dir", sourceDir}, {"file", fileName}, {"backlog", backlog}});
+}
+
+void HeadlessRunner::checkSignals()
+{
+    if (g_receivedSignal == 0 || m_interrupted)
+    {
+        return;
+    }
+
+    m_interrupted = true;
+    emitEvent("interrupted", {{"signal", static_cast<int>(g_receivedSignal)}});
+
+    // 停止后管理器发出finished，正在运行的ffmpeg会被终止并清理临时文件
+    if (m_manager)
+    {
+        m_manager->stop();
+    }
+}
+
+int HeadlessRunner::runCalibration(bool save)
+{
+    ConfigManager *config = ConfigManager::instance();
+    Calibration calibration(config->getTranscodeSettings(), config->getSystemSettings());
+    int exitCode = ExitSuccess;
+
+    connect(&calibration, &Calibration::progress, this, [this](int percent, const QString &message)
+            { emitEvent("calibration", {{"percent", percent}, {"step", message}}); });
+    connect(&calibration, &Calibration::finished, this, [this, config, save, &exitCode](const CalibrationProfile &profile, const QString &error)
+            {
+                if (!error.isEmpty())
+                {
+                    emitEvent("error", {{"message", error}});
+                    exitCode = ExitError;
+                    return;
+                }
+
+                SystemSettings settings = config->getSystemSettings();
+                settings.calibration = profile;
+                config->setSystemSettings(settings, save);
+
+                QJsonArray points;
+                for (const CalibrationPoint &point : profile.points)
+                {
+                    points.append(QJsonObject{{"preset", point.preset}, {"jobs", point.jobs}, {"threads", point.threads}, {"realtimeFactor", point.realtimeFactor}});
+                }
+                emitEvent("finished", {{"codec", profile.codec}, {"resolution", profile.resolution}, {"cores", profile.cores}, {"threadsPerJob", profile.threadsPerJob}, {"points", points}, {"saved", save}});
+            });
+
+    // 同一线程内直接连接，run()返回时结果已处理
+    calibration.run();
+    return exitCode;
+}
+
+void HeadlessRunner::emitEvent(const QString &event, QJsonObject fields)
+{
+    fields["event"] = event;
+    QByteArray line = QJsonDocument(fields).toJson(QJsonDocument::Compact);
+    line.append('\n');
+
+    // 每个事件单独一行并立即刷新，便于管道另一端逐行读取
+    std::fwrite(line.constData(), 1, line.size(), stdout);
+    std::fflush(stdout);
+}
+
+void HeadlessRunner::installSignalHandlers()
+{
+    std::signal(SIGINT, onTerminationSignal);
+    std::signal(SIGTERM, onTerminationSignal);
+}
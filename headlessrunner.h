@@ -0,0 +1,77 @@
+﻿#ifndef HEADLESSRUNNER_H
+#define HEADLESSRUNNER_H
+
+#include <QObject>
+#include <QMap>
+#include <QStringList>
+#include <QJsonObject>
+#include "transcodereport.h"
+
+class QCoreApplication;
+class QThread;
+class QTimer;
+class TranscodeTaskManager;
+class WatchFolderService;
+
+/**
+ * 无界面批处理模式
+ * 不创建窗口，直接驱动TranscodeTaskManager，
+ * 在stdout上逐行输出JSON格式的进度，并以退出码报告结果，供systemd/cron调用
+ */
+class HeadlessRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    // 退出码
+    enum ExitCode
+    {
+        ExitSuccess = 0,     // 全部成功（或没有需要转码的文件；监视模式下正常停止）
+        ExitFailures = 1,    // 部分文件转码失败
+        ExitUsage = 2,       // 参数错误
+        ExitError = 3,       // 无法执行（如目标目录无法创建）
+        ExitInterrupted = 4  // 批次未完成时收到SIGINT/SIGTERM
+    };
+
+    explicit HeadlessRunner(QObject *parent = nullptr);
+    ~HeadlessRunner();
+
+    // 命令行中是否带有 --headless
+    static bool isRequested(int argc, char *argv[]);
+
+    // 解析参数并运行批次，返回退出码
+    int exec(QCoreApplication &app);
+
+private slots:
+    void onCurrentFileChanged(const QString &fileName);
+    void onFileProgressUpdated(const QString &fileName, int percent, double fps, double speed);
+    void onFileProcessed(const QString &fileName, bool success);
+    void onFileStatsUpdated(const JobStats &stats);
+    void onProgressUpdated(int value);
+    void onErrorOccurred(const QString &errorMessage);
+    void onAdmissionPausedChanged(bool paused, const QString &reason);
+    void onFinished();
+    void onFileDetected(const QString &sourceDir, const QString &fileName, bool backlog);
+    void checkSignals();
+
+private:
+    QThread *m_workerThread = nullptr;
+    TranscodeTaskManager *m_manager = nullptr;
+    QTimer *m_signalTimer = nullptr;
+    WatchFolderService *m_watcher = nullptr; // 监视模式下的投放目录监视
+
+    int m_totalFiles = 0;
+    int m_succeeded = 0;
+    int m_failed = 0;
+    bool m_hadError = false;
+    bool m_interrupted = false;
+    bool m_finished = false;
+
+    static const int SignalPollMs = 200; // 检查退出信号的间隔
+
+    int runCalibration(bool save);
+    void emitEvent(const QString &event, QJsonObject fields = QJsonObject());
+    static void installSignalHandlers();
+};
+
+#endif // HEADLESSRUNNER_H
@@ -0,0 +1,331 @@
+﻿#include "libraryinspectordialog.h"
+#include "probecache.h"
+#include "transcodetaskmanager.h"
+#include <QDirIterator>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QThread>
+
+/**
+ * 递归扫描一个目录，按批把找到的视频文件交给对话框
+ */
+class LibraryInspectorDialog::ScanTask : public QRunnable
+{
+public:
+    ScanTask(LibraryInspectorDialog *dialog, const QString &dir)
+        : m_dialog(dialog), m_dir(dir) {}
+
+    void run() override
+    {
+        QStringList extensions = TranscodeTaskManager::supportedExtensions();
+        QList<QPair<QString, qint64>> batch;
+        QDirIterator it(m_dir, QDir::Files | QDir::NoSymLinks | QDir::Readable, QDirIterator::Subdirectories);
+        while (it.hasNext() && !m_dialog->m_cancelled.loadAcquire())
+        {
+            it.next();
+            QFileInfo info = it.fileInfo();
+            if (!extensions.contains(info.suffix().toLower()))
+            {
+                continue;
+            }
+            batch.append(qMakePair(info.absoluteFilePath(), info.size()));
+            if (batch.size() >= ScanBatchSize)
+            {
+                post(batch);
+                batch.clear();
+            }
+        }
+        post(batch);
+    }
+
+private:
+    LibraryInspectorDialog *m_dialog;
+    QString m_dir;
+
+    void post(const QList<QPair<QString, qint64>> &batch)
+    {
+        if (batch.isEmpty())
+        {
+            return;
+        }
+        LibraryInspectorDialog *dialog = m_dialog;
+        QMetaObject::invokeMethod(dialog, [dialog, batch]()
+                                  { dialog->onFilesFound(batch); }, Qt::QueuedConnection);
+    }
+};
+
+/**
+ * 探测一个文件，结果排队等待定时写入模型
+ */
+class LibraryInspectorDialog::ProbeTask : public QRunnable
+{
+public:
+    ProbeTask(LibraryInspectorDialog *dialog, const QString &path)
+        : m_dialog(dialog), m_path(path) {}
+
+    void run() override
+    {
+        if (m_dialog->m_cancelled.loadAcquire())
+        {
+            return;
+        }
+
+        // 命中缓存或能直接解析容器头时不启动ffprobe
+        FFmpegUtils::MediaInfo info = ProbeCache::instance()->mediaInfo(m_path);
+        LibraryInspectorDialog *dialog = m_dialog;
+        QString path = m_path;
+        QMetaObject::invokeMethod(dialog, [dialog, path, info]()
+                                  { dialog->m_pendingResults.append(qMakePair(path, info)); }, Qt::QueuedConnection);
+    }
+
+private:
+    LibraryInspectorDialog *m_dialog;
+    QString m_path;
+};
+
+LibraryInspectorDialog::LibraryInspectorDialog(QWidget *parent)
+    : QDialog(parent), m_cancelled(0)
+{
+    // 容器头解析以读盘为主，ffprobe回退时每个探测一个进程；并发过多只会让磁盘来回寻道
+    m_pool.setMaxThreadCount(qBound(2, QThread::idealThreadCount(), 8));
+
+    setupUI();
+    setWindowTitle(QString::fromLocal8Bit("片库分析"));
+    setMinimumSize(900, 600);
+    resize(1100, 700);
+
+    // 结果按固定间隔成批写入模型，避免大型片库逐个刷新表格
+    m_flushTimer = new QTimer(this);
+    connect(m_flushTimer, &QTimer::timeout, this, &LibraryInspectorDialog::flushResults);
+    m_flushTimer->start(FlushIntervalMs);
+
+    updateStatus();
+}
+
+LibraryInspectorDialog::~LibraryInspectorDialog()
+{
+    // 等待正在运行的扫描和探测结束，之后投递到本对象的结果随对象一起丢弃
+    m_cancelled.storeRelease(1);
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+void LibraryInspectorDialog::setupUI()
+{
+    m_mainLayout = new QVBoxLayout(this);
+
+    // 操作按钮
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    m_addButton = new QPushButton(QString::fromLocal8Bit("添加目录"), this);
+    m_stopButton = new QPushButton(QString::fromLocal8Bit("停止"), this);
+    m_clearButton = new QPushButton(QString::fromLocal8Bit("清空"), this);
+    m_exportCsvButton = new QPushButton(QString::fromLocal8Bit("导出CSV"), this);
+    m_exportJsonButton = new QPushButton(QString::fromLocal8Bit("导出JSON"), this);
+    m_closeButton = new QPushButton(QString::fromLocal8Bit("关闭"), this);
+    for (QPushButton *button : {m_addButton, m_stopButton, m_clearButton, m_exportCsvButton, m_exportJsonButton, m_closeButton})
+    {
+        button->setMinimumHeight(35);
+    }
+
+    buttonLayout->addWidget(m_addButton);
+    buttonLayout->addWidget(m_stopButton);
+    buttonLayout->addWidget(m_clearButton);
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(m_exportCsvButton);
+    buttonLayout->addWidget(m_exportJsonButton);
+    buttonLayout->addWidget(m_closeButton);
+
+    // 汇总和进度
+    m_statusLabel = new QLabel(this);
+    m_statusLabel->setWordWrap(true);
+    m_statusLabel->setStyleSheet("QLabel { color: #666; padding: 5px; }");
+
+    m_progressBar = new QProgressBar(this);
+    m_progressBar->setVisible(false);
+
+    // 结果表格：按 SortRole 的原始数值排序；结果陆续到达时不自动重排，点击表头时再排序
+    m_model = new LibraryInspectorModel(this);
+    m_proxyModel = new QSortFilterProxyModel(this);
+    m_proxyModel->setSourceModel(m_model);
+    m_proxyModel->setSortRole(LibraryInspectorModel::SortRole);
+    m_proxyModel->setDynamicSortFilter(false);
+
+    m_tableView = new QTableView(this);
+    m_tableView->setModel(m_proxyModel);
+    m_tableView->setSortingEnabled(true);
+    m_tableView->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_tableView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_tableView->setAlternatingRowColors(true);
+    m_tableView->verticalHeader()->setVisible(false);
+    m_tableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
+    m_tableView->horizontalHeader()->setSectionResizeMode(LibraryInspectorModel::Path, QHeaderView::Stretch);
+    for (int column = LibraryInspectorModel::Duration; column < LibraryInspectorModel::ColumnCount; ++column)
+    {
+        m_tableView->setColumnWidth(column, 90);
+    }
+    m_tableView->setColumnWidth(LibraryInspectorModel::VideoCodec, 130);
+
+    // 布局
+    m_mainLayout->addLayout(buttonLayout);
+    m_mainLayout->addWidget(m_statusLabel);
+    m_mainLayout->addWidget(m_progressBar);
+    m_mainLayout->addWidget(m_tableView, 1);
+
+    // 连接信号
+    connect(m_addButton, &QPushButton::clicked, this, &LibraryInspectorDialog::onAddDirectory);
+    connect(m_stopButton, &QPushButton::clicked, this, &LibraryInspectorDialog::onStop);
+    connect(m_clearButton, &QPushButton::clicked, this, &LibraryInspectorDialog::onClear);
+    connect(m_exportCsvButton, &QPushButton::clicked, this, &LibraryInspectorDialog::onExportCsv);
+    connect(m_exportJsonButton, &QPushButton::clicked, this, &LibraryInspectorDialog::onExportJson);
+    connect(m_closeButton, &QPushButton::clicked, this, &QDialog::accept);
+}
+
+void LibraryInspectorDialog::inspectDirectories(const QStringList &dirs)
+{
+    if (m_cancelled.fetchAndStoreOrdered(0))
+    {
+        // 上次停止时未探测的文件重新排队，重复的结果写入模型时忽略
+        for (const LibraryEntry &entry : m_model->entries())
+        {
+            if (!entry.probed)
+            {
+                m_pool.start(new ProbeTask(this, entry.path));
+            }
+        }
+    }
+    for (const QString &dir : dirs)
+    {
+        if (QFileInfo(dir).isDir())
+        {
+            // 扫描优先于排队中的探测启动，尽早列出全部文件
+            m_pool.start(new ScanTask(this, dir), 1);
+        }
+    }
+    updateStatus();
+}
+
+void LibraryInspectorDialog::onAddDirectory()
+{
+    QString dir = QFileDialog::getExistingDirectory(this, QString::fromLocal8Bit("选择片库目录"));
+    if (!dir.isEmpty())
+    {
+        inspectDirectories(QStringList() << dir);
+    }
+}
+
+void LibraryInspectorDialog::onStop()
+{
+    // 丢弃排队中的扫描和探测，正在运行的探测完成后照常写入结果
+    m_cancelled.storeRelease(1);
+    m_pool.clear();
+    updateStatus();
+}
+
+void LibraryInspectorDialog::onClear()
+{
+    m_pendingResults.clear();
+    m_model->clear();
+    updateStatus();
+}
+
+void LibraryInspectorDialog::onExportCsv()
+{
+    exportReport(false);
+}
+
+void LibraryInspectorDialog::onExportJson()
+{
+    exportReport(true);
+}
+
+void LibraryInspectorDialog::exportReport(bool json)
+{
+    flushResults();
+
+    QString path = QFileDialog::getSaveFileName(
+        this,
+        QString::fromLocal8Bit("导出片库报告"),
+        json ? "library.json" : "library.csv",
+        json ? QString::fromLocal8Bit("JSON文件 (*.json)") : QString::fromLocal8Bit("CSV文件 (*.csv)"));
+    if (path.isEmpty())
+    {
+        return;
+    }
+
+    bool ok = json ? m_model->writeJson(path) : m_model->writeCsv(path);
+    if (!ok)
+    {
+        QMessageBox::warning(this, QString::fromLocal8Bit("导出失败"), QString::fromLocal8Bit("无法写入文件: %1").arg(path));
+    }
+}
+
+void LibraryInspectorDialog::onFilesFound(const QList<QPair<QString, qint64>> &files)
+{
+    // 停止后仍在投递的批次只列出，不再探测
+    QStringList added = m_model->addFiles(files);
+    if (!m_cancelled.loadAcquire())
+    {
+        for (const QString &path : added)
+        {
+            m_pool.start(new ProbeTask(this, path));
+        }
+    }
+    updateStatus();
+}
+
+void LibraryInspectorDialog::flushResults()
+{
+    // 空闲时不刷新，汇总需要遍历全部文件
+    if (m_pendingResults.isEmpty() && !m_busy && m_pool.activeThreadCount() == 0)
+    {
+        return;
+    }
+
+    if (!m_pendingResults.isEmpty())
+    {
+        m_model->setResults(m_pendingResults);
+        m_pendingResults.clear();
+    }
+    updateStatus();
+}
+
+void LibraryInspectorDialog::updateStatus()
+{
+    bool busy = m_pool.activeThreadCount() > 0 || !m_pendingResults.isEmpty();
+    m_busy = busy;
+    int total = m_model->rowCount();
+    int probed = m_model->probedCount();
+
+    m_progressBar->setVisible(busy);
+    m_progressBar->setRange(0, qMax(total, 1));
+    m_progressBar->setValue(probed);
+    m_stopButton->setEnabled(busy);
+    m_clearButton->setEnabled(!busy && total > 0);
+    m_exportCsvButton->setEnabled(total > 0);
+    m_exportJsonButton->setEnabled(total > 0);
+
+    if (total == 0)
+    {
+        m_statusLabel->setText(busy ? QString::fromLocal8Bit("正在扫描目录...")
+                                    : QString::fromLocal8Bit("添加目录后递归扫描其中的视频文件（%1）").arg(TranscodeTaskManager::supportedExtensions().join(", ")));
+        return;
+    }
+
+    double totalDuration = 0.0;
+    qint64 totalBytes = 0;
+    for (const LibraryEntry &entry : m_model->entries())
+    {
+        totalDuration += entry.info.durationSec;
+        totalBytes += entry.sizeBytes;
+    }
+
+    m_statusLabel->setText(QString::fromLocal8Bit("共 %1 个文件，已探测 %2，失败 %3；总时长 %4 小时，总大小 %5 GB")
+                               .arg(total)
+                               .arg(probed)
+                               .arg(m_model->failedCount())
+                               .arg(totalDuration / 3600.0, 0, 'f', 1)
+                               .arg(totalBytes / (1024.0 * 1024 * 1024), 0, 'f', 1));
+}
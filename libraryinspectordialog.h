@@ -0,0 +1,75 @@
+﻿#ifndef LIBRARYINSPECTORDIALOG_H
+#define LIBRARYINSPECTORDIALOG_H
+
+#include <QAtomicInt>
+#include <QDialog>
+#include <QLabel>
+#include <QList>
+#include <QPair>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QSortFilterProxyModel>
+#include <QTableView>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVBoxLayout>
+#include "libraryinspectormodel.h"
+
+/**
+ * 片库分析
+ * 递归扫描目录树中的视频文件，用有限并发的线程池逐个探测（走探测缓存和容器头解析，
+ * 必要时才启动ffprobe），在可排序的表格中列出时长、编码、分辨率、帧率、码率和大小，
+ * 并可导出CSV/JSON，用于规划批次和找出处理成本高的源文件。
+ */
+class LibraryInspectorDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit LibraryInspectorDialog(QWidget *parent = nullptr);
+    ~LibraryInspectorDialog();
+
+    // 扫描目录树并探测其中的视频文件，可多次调用，已列出的文件不重复探测
+    void inspectDirectories(const QStringList &dirs);
+
+private slots:
+    void onAddDirectory();
+    void onStop();
+    void onClear();
+    void onExportCsv();
+    void onExportJson();
+    void flushResults();
+
+private:
+    class ScanTask;
+    class ProbeTask;
+
+    void setupUI();
+    void updateStatus();
+    void onFilesFound(const QList<QPair<QString, qint64>> &files);
+    void exportReport(bool json);
+
+    QVBoxLayout *m_mainLayout;
+    QPushButton *m_addButton;
+    QPushButton *m_stopButton;
+    QPushButton *m_clearButton;
+    QPushButton *m_exportCsvButton;
+    QPushButton *m_exportJsonButton;
+    QPushButton *m_closeButton;
+    QLabel *m_statusLabel;
+    QProgressBar *m_progressBar;
+    QTableView *m_tableView;
+    LibraryInspectorModel *m_model;
+    QSortFilterProxyModel *m_proxyModel;
+    QTimer *m_flushTimer;
+
+    QThreadPool m_pool;                                             // 扫描和探测共用，线程数即并发探测上限
+    QAtomicInt m_cancelled;                                         // 停止或关闭后，尚未开始的扫描和探测直接返回
+    QList<QPair<QString, FFmpegUtils::MediaInfo>> m_pendingResults; // 等待定时写入模型的结果
+    bool m_busy = false;                                            // 上次刷新时是否有扫描或探测在运行
+
+    static const int FlushIntervalMs = 200;
+    static const int ScanBatchSize = 500;
+};
+
+#endif // LIBRARYINSPECTORDIALOG_H
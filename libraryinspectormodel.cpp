@@ -0,0 +1,361 @@
+﻿#include "libraryinspectormodel.h"
+#include "transcodereport.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+LibraryInspectorModel::LibraryInspectorModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+int LibraryInspectorModel::rowCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent)
+    return m_entries.size();
+}
+
+int LibraryInspectorModel::columnCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent)
+    return ColumnCount;
+}
+
+QVariant LibraryInspectorModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_entries.size())
+        return QVariant();
+
+    const LibraryEntry &entry = m_entries.at(index.row());
+    const FFmpegUtils::MediaInfo &info = entry.info;
+    bool valid = info.isValid();
+
+    switch (role)
+    {
+    case Qt::DisplayRole:
+        switch (index.column())
+        {
+        case Path:
+            return entry.path;
+        case Duration:
+            if (!entry.probed)
+            {
+                return QString("-");
+            }
+            return valid ? formatDuration(info.durationSec) : QString::fromLocal8Bit("探测失败");
+        case VideoCodec:
+            if (!info.hasVideo())
+            {
+                return QString("-");
+            }
+            return info.videoProfile.isEmpty() ? info.videoCodec : QString("%1 (%2)").arg(info.videoCodec, info.videoProfile);
+        case Resolution:
+            return info.width > 0 ? QString("%1x%2").arg(info.width).arg(info.height) : QString("-");
+        case FrameRate:
+            return info.frameRate > 0 ? QString::number(info.frameRate, 'f', 2) : QString("-");
+        case Bitrate:
+            return info.bitrate > 0 ? formatBitrate(info.bitrate) : QString("-");
+        case FileSize:
+            return formatBytes(entry.sizeBytes);
+        case AudioCodec:
+            return info.hasAudio() ? info.audioCodec : QString("-");
+        case PixelCount:
+            return entry.pixelCount() > 0 ? QString("%1 G").arg(entry.pixelCount() / 1e9, 0, 'f', 1) : QString("-");
+        }
+        break;
+
+    case SortRole:
+        switch (index.column())
+        {
+        case Path:
+            return entry.path;
+        case Duration:
+            return info.durationSec;
+        case VideoCodec:
+            return info.videoCodec;
+        case Resolution:
+            return qint64(info.width) * info.height;
+        case FrameRate:
+            return info.frameRate;
+        case Bitrate:
+            return info.bitrate;
+        case FileSize:
+            return entry.sizeBytes;
+        case AudioCodec:
+            return info.audioCodec;
+        case PixelCount:
+            return entry.pixelCount();
+        }
+        break;
+
+    case Qt::ToolTipRole:
+        if (index.column() == Path)
+        {
+            return entry.path;
+        }
+        else if (index.column() == Duration && entry.isFailed())
+        {
+            return QString::fromLocal8Bit("ffprobe无法读取此文件");
+        }
+        else if (index.column() == VideoCodec && !info.pixelFormat.isEmpty())
+        {
+            return info.pixelFormat;
+        }
+        else if (index.column() == Bitrate && info.videoBitrate > 0)
+        {
+            return QString::fromLocal8Bit("视频 %1，音频 %2").arg(formatBitrate(info.videoBitrate), info.audioBitrate > 0 ? formatBitrate(info.audioBitrate) : QString("-"));
+        }
+        else if (index.column() == PixelCount)
+        {
+            return QString::fromLocal8Bit("宽 × 高 × 帧率 × 时长，即需要解码和编码的总像素数");
+        }
+        break;
+
+    case Qt::TextAlignmentRole:
+        if (index.column() != Path && index.column() != VideoCodec && index.column() != AudioCodec)
+        {
+            return int(Qt::AlignRight | Qt::AlignVCenter);
+        }
+        break;
+    }
+
+    return QVariant();
+}
+
+QVariant LibraryInspectorModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole || orientation != Qt::Horizontal)
+        return QVariant();
+
+    switch (section)
+    {
+    case Path:
+        return QString::fromLocal8Bit("文件");
+    case Duration:
+        return QString::fromLocal8Bit("时长");
+    case VideoCodec:
+        return QString::fromLocal8Bit("视频编码");
+    case Resolution:
+        return QString::fromLocal8Bit("分辨率");
+    case FrameRate:
+        return QString::fromLocal8Bit("帧率");
+    case Bitrate:
+        return QString::fromLocal8Bit("码率");
+    case FileSize:
+        return QString::fromLocal8Bit("大小");
+    case AudioCodec:
+        return QString::fromLocal8Bit("音频编码");
+    case PixelCount:
+        return QString::fromLocal8Bit("像素总量");
+    }
+    return QVariant();
+}
+
+QStringList LibraryInspectorModel::addFiles(const QList<QPair<QString, qint64>> &files)
+{
+    QList<LibraryEntry> added;
+    QStringList paths;
+    for (const auto &file : files)
+    {
+        if (m_rows.contains(file.first))
+        {
+            continue;
+        }
+        m_rows.insert(file.first, m_entries.size() + added.size());
+
+        LibraryEntry entry;
+        entry.path = file.first;
+        entry.sizeBytes = file.second;
+        added.append(entry);
+        paths.append(file.first);
+    }
+
+    if (!added.isEmpty())
+    {
+        beginInsertRows(QModelIndex(), m_entries.size(), m_entries.size() + added.size() - 1);
+        m_entries.append(added);
+        endInsertRows();
+    }
+    return paths;
+}
+
+void LibraryInspectorModel::setResults(const QList<QPair<QString, FFmpegUtils::MediaInfo>> &results)
+{
+    int first = m_entries.size();
+    int last = -1;
+    for (const auto &result : results)
+    {
+        int row = m_rows.value(result.first, -1);
+        if (row < 0 || m_entries[row].probed)
+        {
+            continue;
+        }
+
+        LibraryEntry &entry = m_entries[row];
+        entry.info = result.second;
+        entry.probed = true;
+        m_probed++;
+        if (entry.isFailed())
+        {
+            m_failed++;
+        }
+        first = qMin(first, row);
+        last = qMax(last, row);
+    }
+
+    // 一批结果只发一次信号，探测大型片库时避免逐行刷新
+    if (last >= 0)
+    {
+        emit dataChanged(createIndex(first, 0), createIndex(last, ColumnCount - 1));
+    }
+}
+
+void LibraryInspectorModel::clear()
+{
+    beginResetModel();
+    m_entries.clear();
+    m_rows.clear();
+    m_probed = 0;
+    m_failed = 0;
+    endResetModel();
+}
+
+bool LibraryInspectorModel::writeCsv(const QString &path) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+    {
+        qDebug() << QString::fromLocal8Bit("无法写入片库报告:") << path << file.errorString();
+        return false;
+    }
+
+    QTextStream out(&file);
+    out.setCodec("UTF-8");
+    out.setGenerateByteOrderMark(true); // 便于Excel识别中文文件名
+
+    out << "path,size_bytes,duration_sec,video_codec,profile,pixel_format,width,height,frame_rate,bitrate,video_bitrate,audio_codec,audio_bitrate,gigapixels,status\n";
+    for (const LibraryEntry &entry : m_entries)
+    {
+        const FFmpegUtils::MediaInfo &info = entry.info;
+        out << TranscodeReport::csvField(entry.path) << ','
+            << entry.sizeBytes << ','
+            << QString::number(info.durationSec, 'f', 3) << ','
+            << TranscodeReport::csvField(info.videoCodec) << ','
+            << TranscodeReport::csvField(info.videoProfile) << ','
+            << TranscodeReport::csvField(info.pixelFormat) << ','
+            << info.width << ','
+            << info.height << ','
+            << QString::number(info.frameRate, 'f', 3) << ','
+            << info.bitrate << ','
+            << info.videoBitrate << ','
+            << TranscodeReport::csvField(info.audioCodec) << ','
+            << info.audioBitrate << ','
+            << QString::number(entry.pixelCount() / 1e9, 'f', 3) << ','
+            << (!entry.probed ? "pending" : entry.isFailed() ? "failed" : "ok") << '\n';
+    }
+
+    file.close();
+    return true;
+}
+
+bool LibraryInspectorModel::writeJson(const QString &path) const
+{
+    QJsonArray files;
+    double totalDuration = 0.0;
+    qint64 totalBytes = 0;
+    double totalPixels = 0.0;
+
+    for (const LibraryEntry &entry : m_entries)
+    {
+        const FFmpegUtils::MediaInfo &info = entry.info;
+        QJsonObject object;
+        object["path"] = entry.path;
+        object["sizeBytes"] = entry.sizeBytes;
+        object["status"] = !entry.probed ? "pending" : entry.isFailed() ? "failed" : "ok";
+        if (info.isValid())
+        {
+            object["durationSec"] = info.durationSec;
+            object["bitrate"] = info.bitrate;
+            object["gigapixels"] = entry.pixelCount() / 1e9;
+        }
+        if (info.hasVideo())
+        {
+            object["videoCodec"] = info.videoCodec;
+            object["profile"] = info.videoProfile;
+            object["pixelFormat"] = info.pixelFormat;
+            object["width"] = info.width;
+            object["height"] = info.height;
+            object["frameRate"] = info.frameRate;
+            object["videoBitrate"] = info.videoBitrate;
+        }
+        if (info.hasAudio())
+        {
+            object["audioCodec"] = info.audioCodec;
+            object["audioBitrate"] = info.audioBitrate;
+        }
+        files.append(object);
+
+        totalDuration += info.durationSec;
+        totalBytes += entry.sizeBytes;
+        totalPixels += entry.pixelCount();
+    }
+
+    QJsonObject summary;
+    summary["files"] = m_entries.size();
+    summary["probed"] = m_probed;
+    summary["failed"] = m_failed;
+    summary["durationSec"] = totalDuration;
+    summary["sizeBytes"] = totalBytes;
+    summary["gigapixels"] = totalPixels / 1e9;
+
+    QJsonObject root;
+    root["generated"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    root["summary"] = summary;
+    root["files"] = files;
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qDebug() << QString::fromLocal8Bit("无法写入片库报告:") << path << file.errorString();
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson());
+    file.close();
+    return true;
+}
+
+QString LibraryInspectorModel::formatDuration(double seconds)
+{
+    qint64 total = qint64(seconds);
+    if (total >= 3600)
+    {
+        return QString("%1:%2:%3").arg(total / 3600).arg((total % 3600) / 60, 2, 10, QChar('0')).arg(total % 60, 2, 10, QChar('0'));
+    }
+    return QString("%1:%2").arg(total / 60).arg(total % 60, 2, 10, QChar('0'));
+}
+
+QString LibraryInspectorModel::formatBytes(qint64 bytes)
+{
+    if (bytes >= 1024LL * 1024 * 1024)
+    {
+        return QString("%1 GB").arg(bytes / (1024.0 * 1024 * 1024), 0, 'f', 2);
+    }
+    if (bytes >= 1024 * 1024)
+    {
+        return QString("%1 MB").arg(bytes / (1024.0 * 1024), 0, 'f', 1);
+    }
+    return QString("%1 KB").arg(bytes / 1024.0, 0, 'f', 0);
+}
+
+QString LibraryInspectorModel::formatBitrate(qint64 bitsPerSecond)
+{
+    if (bitsPerSecond >= 1000000)
+    {
+        return QString("%1 Mbps").arg(bitsPerSecond / 1000000.0, 0, 'f', 1);
+    }
+    return QString("%1 Kbps").arg(bitsPerSecond / 1000.0, 0, 'f', 0);
+}
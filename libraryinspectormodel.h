@@ -0,0 +1,86 @@
+﻿#ifndef LIBRARYINSPECTORMODEL_H
+#define LIBRARYINSPECTORMODEL_H
+
+#include <QAbstractTableModel>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include "utils/ffmpegutils.h"
+
+/**
+ * 片库中的一个文件
+ */
+struct LibraryEntry
+{
+    QString path;
+    qint64 sizeBytes = 0;
+    FFmpegUtils::MediaInfo info;
+    bool probed = false; // 已探测（成功或失败）
+
+    bool isFailed() const { return probed && !info.isValid(); }
+
+    // 需要解码/编码的总像素数（宽 × 高 × 帧率 × 时长），用于比较处理成本
+    double pixelCount() const { return double(info.width) * info.height * info.frameRate * info.durationSec; }
+};
+
+/**
+ * 片库分析表格模型
+ * 每行一个文件，探测结果陆续写入；Qt::UserRole 返回原始数值，供代理模型按数值排序
+ */
+class LibraryInspectorModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column
+    {
+        Path = 0,
+        Duration,
+        VideoCodec,
+        Resolution,
+        FrameRate,
+        Bitrate,
+        FileSize,
+        AudioCodec,
+        PixelCount,
+        ColumnCount
+    };
+
+    static const int SortRole = Qt::UserRole;
+
+    explicit LibraryInspectorModel(QObject *parent = nullptr);
+
+    // QAbstractTableModel interface
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    // 添加待探测的文件（已存在的路径忽略），返回实际添加的路径
+    QStringList addFiles(const QList<QPair<QString, qint64>> &files);
+
+    // 写入一批探测结果
+    void setResults(const QList<QPair<QString, FFmpegUtils::MediaInfo>> &results);
+
+    void clear();
+
+    const QList<LibraryEntry> &entries() const { return m_entries; }
+    int probedCount() const { return m_probed; }
+    int failedCount() const { return m_failed; }
+
+    // 导出全部文件（含未探测完的），格式与批次报告一致：CSV带BOM，JSON带汇总
+    bool writeCsv(const QString &path) const;
+    bool writeJson(const QString &path) const;
+
+private:
+    QList<LibraryEntry> m_entries;
+    QHash<QString, int> m_rows; // 路径 -> 行号
+    int m_probed = 0;
+    int m_failed = 0;
+
+    static QString formatDuration(double seconds);
+    static QString formatBytes(qint64 bytes);
+    static QString formatBitrate(qint64 bitsPerSecond);
+};
+
+#endif // LIBRARYINSPECTORMODEL_H
@@ -2,6 +2,7 @@
 #include "transcoder.h"
 #include "configmanager.h"
 #include "encoding.h"
+#include "headlessrunner.h"
 
 #include <QApplication>
 #include <QTextCodec>
@@ -12,8 +13,6 @@
 
 int main(int argc, char *argv[])
 {
-    QApplication a(argc, argv);
-
     // 设置控制台代码页（Windows）
     setConsoleCodePage();
 
@@ -22,6 +21,16 @@ int main(int argc, char *argv[])
     QTextCodec::setCodecForLocale(QTextCodec::codecForName("UTF-8"));
 #endif
 
+    // 无界面模式：不创建窗口，用于没有图形环境的转码服务器
+    if (HeadlessRunner::isRequested(argc, argv))
+    {
+        QCoreApplication app(argc, argv);
+        HeadlessRunner runner;
+        return runner.exec(app);
+    }
+
+    QApplication a(argc, argv);
+
     // 设置应用程序图标（用于任务栏）
     a.setWindowIcon(QIcon(":/icons/app_icon.png"));
 
@@ -0,0 +1,235 @@
+﻿#include "probecache.h"
+#include "utils/containerprobe.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace
+{
+    // 固定序列化格式，不随Qt版本变化
+    const QDataStream::Version StreamVersion = QDataStream::Qt_5_6;
+}
+
+ProbeCache *ProbeCache::instance()
+{
+    // 局部静态变量的初始化是线程安全的
+    static ProbeCache cache(defaultPath());
+    return &cache;
+}
+
+QString ProbeCache::defaultPath()
+{
+    QString configDir = QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation);
+    QDir().mkpath(configDir);
+    return QDir(configDir).filePath("probe_cache.bin");
+}
+
+ProbeCache::ProbeCache(const QString &path)
+    : m_path(path), m_lock(path + ".lock")
+{
+    load();
+}
+
+bool ProbeCache::lookup(const QString &path, QByteArray *json)
+{
+    QFileInfo fileInfo(path);
+    if (!fileInfo.exists())
+    {
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    auto it = m_entries.constFind(fileInfo.absoluteFilePath());
+    if (it == m_entries.constEnd() ||
+        it->size != fileInfo.size() ||
+        it->mtimeMs != fileInfo.lastModified().toMSecsSinceEpoch())
+    {
+        return false;
+    }
+
+    if (json)
+    {
+        *json = qUncompress(it->json);
+    }
+    return true;
+}
+
+void ProbeCache::insert(const QString &path, const QByteArray &json)
+{
+    QFileInfo fileInfo(path);
+    if (!fileInfo.exists() || json.isEmpty())
+    {
+        return;
+    }
+
+    Entry entry;
+    entry.size = fileInfo.size();
+    entry.mtimeMs = fileInfo.lastModified().toMSecsSinceEpoch();
+    entry.json = qCompress(json);
+
+    QMutexLocker locker(&m_mutex);
+    QString key = fileInfo.absoluteFilePath();
+    m_entries.insert(key, entry);
+
+    // 每条记录立即追加，中途退出也不会丢失已探测的结果
+    appendRecord(key, entry);
+}
+
+QByteArray ProbeCache::probeJson(const QString &path)
+{
+    QByteArray json;
+    if (lookup(path, &json))
+    {
+        return json;
+    }
+
+    // 探测期间不持有锁，多个线程可以同时探测不同的文件
+    json = FFmpegUtils::probeJson(path);
+    insert(path, json);
+    return json;
+}
+
+FFmpegUtils::MediaInfo ProbeCache::mediaInfo(const QString &path)
+{
+    // 未缓存时先直接读取容器头，成功则不启动ffprobe；解析很快，结果不写入缓存
+    QByteArray json;
+    if (!lookup(path, &json))
+    {
+        FFmpegUtils::MediaInfo info;
+        if (ContainerProbe::probe(path, info))
+        {
+            return info;
+        }
+        json = probeJson(path);
+    }
+    return json.isEmpty() ? FFmpegUtils::MediaInfo() : FFmpegUtils::parseProbeOutput(json);
+}
+
+int ProbeCache::size() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_entries.size();
+}
+
+void ProbeCache::load()
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_lock.tryLock(LockTimeoutMs))
+    {
+        qDebug() << QString::fromLocal8Bit("探测缓存被其他进程占用，本次不加载:") << m_path;
+        return;
+    }
+    readFile();
+    m_lock.unlock();
+}
+
+void ProbeCache::readFile()
+{
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(StreamVersion);
+    quint32 magic = 0;
+    in >> magic;
+    if (magic != Magic)
+    {
+        // 格式不符时丢弃，重新探测即可
+        file.close();
+        QFile::remove(m_path);
+        return;
+    }
+
+    bool truncated = false;
+    while (!in.atEnd())
+    {
+        QString path;
+        Entry entry;
+        in >> path >> entry.size >> entry.mtimeMs >> entry.json;
+        if (in.status() != QDataStream::Ok)
+        {
+            truncated = true;
+            break;
+        }
+        m_entries.insert(path, entry);
+        m_records++;
+    }
+    file.close();
+
+    // 被覆盖的旧记录超过一半或尾部不完整时重写；仍持有锁，
+    // m_entries包含文件中的全部记录，不会丢掉其他进程刚追加的结果
+    if (truncated || (m_records >= MinCompactRecords && m_records > m_entries.size() * 2))
+    {
+        compact();
+    }
+}
+
+void ProbeCache::compact()
+{
+    // 写入临时文件后原子替换，其他进程读到的总是完整的旧文件或新文件
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qDebug() << QString::fromLocal8Bit("无法重写探测缓存:") << m_path;
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(StreamVersion);
+    out << Magic;
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it)
+    {
+        writeRecord(out, it.key(), it.value());
+    }
+    if (file.commit())
+    {
+        m_records = m_entries.size();
+    }
+}
+
+bool ProbeCache::appendRecord(const QString &path, const Entry &entry)
+{
+    if (!m_lock.tryLock(LockTimeoutMs))
+    {
+        qDebug() << QString::fromLocal8Bit("探测缓存被其他进程占用，结果只保存在内存中:") << m_path;
+        return false;
+    }
+
+    // 每次持锁打开再关闭：其他进程重写后文件已被替换，长期持有的句柄会写入被替换掉的旧文件
+    QFile file(m_path);
+    bool isNew = !file.exists() || file.size() == 0;
+    bool ok = file.open(QIODevice::WriteOnly | QIODevice::Append);
+    if (ok)
+    {
+        QDataStream out(&file);
+        out.setVersion(StreamVersion);
+        if (isNew)
+        {
+            out << Magic;
+        }
+        writeRecord(out, path, entry);
+        ok = file.flush();
+        file.close();
+        m_records++;
+    }
+    else
+    {
+        qDebug() << QString::fromLocal8Bit("无法写入探测缓存:") << m_path;
+    }
+
+    m_lock.unlock();
+    return ok;
+}
+
+void ProbeCache::writeRecord(QDataStream &out, const QString &path, const Entry &entry)
+{
+    out << path << entry.size << entry.mtimeMs << entry.json;
+}
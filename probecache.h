@@ -0,0 +1,79 @@
+﻿#ifndef PROBECACHE_H
+#define PROBECACHE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QLockFile>
+#include <QMutex>
+#include <QString>
+#include "utils/ffmpegutils.h"
+
+/**
+ * 媒体探测缓存
+ * 按 路径 + 文件大小 + 修改时间 缓存ffprobe的JSON输出（容器、流和章节信息），
+ * 任务管理器、转码任务和视频信息对话框共用，同一文件在多次运行之间只探测一次。
+ *
+ * 磁盘上是追加写入的二进制索引（QDataStream），同一路径的新记录覆盖旧记录；
+ * 加载时过期记录过多或文件尾部不完整（写入时崩溃）就重写一次。
+ * 线程安全，可在任意线程中调用；界面和无界面实例可能同时运行，
+ * 读取、追加和重写都持有缓存文件旁的锁文件。
+ */
+class ProbeCache
+{
+public:
+    // 进程内共享的缓存，位于配置目录下
+    static ProbeCache *instance();
+
+    // 默认缓存路径，与配置文件位于同一目录
+    static QString defaultPath();
+
+    explicit ProbeCache(const QString &path);
+
+    ProbeCache(const ProbeCache &) = delete;
+    ProbeCache &operator=(const ProbeCache &) = delete;
+
+    /**
+     * 查找缓存
+     * @param path 媒体文件路径
+     * @param json 命中时写入ffprobe的JSON输出
+     * @return true 如果命中（文件大小和修改时间与缓存时一致）
+     */
+    bool lookup(const QString &path, QByteArray *json);
+
+    // 写入探测结果，文件不存在时忽略
+    void insert(const QString &path, const QByteArray &json);
+
+    // 命中缓存时直接返回，否则运行ffprobe并写入缓存；失败时返回空
+    QByteArray probeJson(const QString &path);
+
+    // 同 probeJson，解析为媒体信息；未缓存时先尝试 ContainerProbe 直接解析容器头
+    FFmpegUtils::MediaInfo mediaInfo(const QString &path);
+
+    int size() const;
+
+private:
+    struct Entry
+    {
+        qint64 size = 0;
+        qint64 mtimeMs = 0;
+        QByteArray json; // qCompress压缩后的ffprobe输出
+    };
+
+    QString m_path;
+    mutable QMutex m_mutex;
+    QHash<QString, Entry> m_entries; // 绝对路径 -> 缓存项
+    QLockFile m_lock;                // 跨进程锁，与m_mutex一起持有
+    int m_records = 0;               // 文件中的记录数（含被覆盖的旧记录）
+
+    static const quint32 Magic = 0x54504331;   // 文件头 "TPC1"
+    static const int MinCompactRecords = 1024; // 记录数少于此值时不重写
+    static const int LockTimeoutMs = 5000;     // 等待其他进程释放锁的最长时间
+
+    void load();
+    void readFile();
+    void compact();
+    bool appendRecord(const QString &path, const Entry &entry);
+    static void writeRecord(QDataStream &out, const QString &path, const Entry &entry);
+};
+
+#endif // PROBECACHE_H
@@ -6,18 +6,36 @@
 #include <QApplication>
 #include <QFile>
 #include <QThread>
+#include <QProgressDialog>
+#include <QDateTime>
+#include <QStandardItemModel>
+#include "calibration.h"
+#include "utils/libavengine.h"
+#include "utils/cpuscheduler.h"
 
 SettingDialog::SettingDialog(QWidget *parent) : QDialog(parent),
                                                 ui(new Ui::SettingDialog)
 {
     ui->setupUi(this);
     initThreadCountComboBox();
+    initThreadsPerJobComboBox();
+    initEngineComboBox();
     connectSignals();
     loadSettings();
 }
 
 SettingDialog::~SettingDialog()
 {
+    // 对话框关闭时停止仍在进行的标定
+    if (m_calibrationThread)
+    {
+        if (m_calibrationWorker)
+        {
+            m_calibrationWorker->cancel();
+        }
+        m_calibrationThread->quit();
+        m_calibrationThread->wait();
+    }
     delete ui;
 }
 
@@ -32,12 +50,21 @@ void SettingDialog::connectSignals()
 
     // 主题变更
     connect(ui->themeComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &SettingDialog::onThemeChanged);
+
+    // 标定与吞吐目标
+    connect(ui->calibrateButton, &QPushButton::clicked, this, &SettingDialog::onCalibrateButtonClicked);
+    connect(ui->throughputTargetSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &SettingDialog::updateCalibrationStatus);
+    connect(ui->throughputModeComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &SettingDialog::updateCalibrationStatus);
+    connect(ui->codecComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &SettingDialog::updateCalibrationStatus);
+    connect(ui->resolutionComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &SettingDialog::updateCalibrationStatus);
+    connect(ui->threadsPerJobComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &SettingDialog::updateCalibrationStatus);
 }
 
 void SettingDialog::loadSettings()
 {
     ConfigManager *config = ConfigManager::instance();
 
+    m_calibration = config->getSystemSettings().calibration;
     setTranscodeSettingsToUI(config->getTranscodeSettings());
     setSystemSettingsToUI(config->getSystemSettings());
 
@@ -142,6 +169,9 @@ TranscodeSettings SettingDialog::getTranscodeSettingsFromUI() const
     // 帧率
     settings.framerate = ui->framerateSpinBox->value();
 
+    // 附加输出
+    settings.renditions = ConfigManager::parseRenditions(ui->renditionsLineEdit->text());
+
     // 像素格式
     QString pixelText = ui->pixelFormatComboBox->currentText();
     if (pixelText.contains("yuv420p"))
@@ -171,6 +201,16 @@ TranscodeSettings SettingDialog::getTranscodeSettingsFromUI() const
 
     // 快速启动
     settings.faststart = ui->faststartCheckBox->isChecked();
+    settings.streamCopy = ui->streamCopyCheckBox->isChecked();
+
+    // 转码引擎
+    settings.engine = (ui->engineComboBox->currentIndex() == 1) ? "libav" : "ffmpeg";
+
+    // 缩放方式和算法，下拉框文本以配置名开头
+    settings.scaleMode = ui->scaleModeComboBox->currentText().section(' ', 0, 0);
+    settings.scaleAlgorithm = ui->scaleAlgorithmComboBox->currentText().section(' ', 0, 0);
+    settings.noUpscale = ui->noUpscaleCheckBox->isChecked();
+    settings.noFrameRateIncrease = ui->noFrameRateIncreaseCheckBox->isChecked();
 
     return settings;
 }
@@ -211,6 +251,50 @@ SystemSettings SettingDialog::getSystemSettingsFromUI() const
 
     qDebug() << "Selected thread count:" << settings.threadCount;
 
+    // 调度策略
+    static const CpuScheduler::Policy policies[] = {CpuScheduler::Throughput, CpuScheduler::Balanced, CpuScheduler::Latency};
+    int policyIndex = qBound(0, ui->schedulingPolicyComboBox->currentIndex(), 2);
+    settings.schedulingPolicy = CpuScheduler::policyToString(policies[policyIndex]);
+
+    // 每任务线程数
+    settings.threadsPerJob = ui->threadsPerJobComboBox->currentData().toInt();
+
+    // 自适应并发
+    settings.adaptiveConcurrency = ui->adaptiveConcurrencyCheckBox->isChecked();
+    settings.minConcurrentJobs = ui->minConcurrentJobsSpinBox->value();
+    settings.maxConcurrentJobs = ui->maxConcurrentJobsSpinBox->value();
+
+    // 通道并发上限
+    settings.urgentLaneJobs = ui->urgentLaneJobsSpinBox->value();
+    settings.normalLaneJobs = ui->normalLaneJobsSpinBox->value();
+    settings.backgroundLaneJobs = ui->backgroundLaneJobsSpinBox->value();
+
+    // 任务顺序
+    QStringList jobOrders = {"longestFirst", "shortestFirst", "name"};
+    settings.jobOrder = jobOrders.value(ui->jobOrderComboBox->currentIndex(), "longestFirst");
+
+    // 分段转码
+    settings.chunkedEncoding = ui->chunkedEncodingCheckBox->isChecked();
+    settings.chunkThresholdSec = ui->chunkThresholdSpinBox->value() * 60;
+
+    // 本地暂存
+    settings.scratchStaging = ui->scratchStagingCheckBox->isChecked();
+    settings.scratchDirectory = ui->scratchDirectoryLineEdit->text().trimmed();
+    settings.minFreeSpaceMb = ui->minFreeSpaceSpinBox->value();
+
+    // 每设备并发读写
+    settings.readersPerDevice = ui->readersPerDeviceSpinBox->value();
+    settings.writersPerDevice = ui->writersPerDeviceSpinBox->value();
+
+    // 指标服务
+    settings.metricsEnabled = ui->metricsEnabledCheckBox->isChecked();
+    settings.metricsPort = ui->metricsPortSpinBox->value();
+
+    // 吞吐目标
+    settings.throughputTargetMinutes = ui->throughputTargetSpinBox->value();
+    settings.throughputMode = (ui->throughputModeComboBox->currentIndex() == 1) ? "ingest" : "output";
+    settings.calibration = m_calibration;
+
     return settings;
 }
 
@@ -271,6 +355,9 @@ void SettingDialog::setTranscodeSettingsToUI(const TranscodeSettings &settings)
     // 帧率
     ui->framerateSpinBox->setValue(settings.framerate);
 
+    // 附加输出
+    ui->renditionsLineEdit->setText(ConfigManager::formatRenditions(settings.renditions));
+
     // 像素格式
     if (settings.pixelFormat == "yuv420p")
     {
@@ -315,6 +402,19 @@ void SettingDialog::setTranscodeSettingsToUI(const TranscodeSettings &settings)
 
     // 快速启动
     ui->faststartCheckBox->setChecked(settings.faststart);
+    ui->streamCopyCheckBox->setChecked(settings.streamCopy);
+
+    // 转码引擎
+    ui->engineComboBox->setCurrentIndex((settings.engine == "libav") ? 1 : 0);
+
+    // 缩放方式和算法
+    QStringList scaleModes = {"pad", "fill", "fit", "stretch"};
+    ui->scaleModeComboBox->setCurrentIndex(qMax(0, scaleModes.indexOf(settings.scaleMode)));
+    QStringList scaleAlgorithms = {"fast_bilinear", "bilinear", "bicubic", "lanczos"};
+    int algorithmIndex = scaleAlgorithms.indexOf(settings.scaleAlgorithm);
+    ui->scaleAlgorithmComboBox->setCurrentIndex(algorithmIndex != -1 ? algorithmIndex : 2);
+    ui->noUpscaleCheckBox->setChecked(settings.noUpscale);
+    ui->noFrameRateIncreaseCheckBox->setChecked(settings.noFrameRateIncrease);
 }
 
 void SettingDialog::setSystemSettingsToUI(const SystemSettings &settings)
@@ -335,6 +435,156 @@ void SettingDialog::setSystemSettingsToUI(const SystemSettings &settings)
 
     // 线程数设置
     setThreadCountToUI(settings.threadCount);
+
+    // 调度策略
+    switch (CpuScheduler::policyFromString(settings.schedulingPolicy))
+    {
+    case CpuScheduler::Throughput:
+        ui->schedulingPolicyComboBox->setCurrentIndex(0);
+        break;
+    case CpuScheduler::Latency:
+        ui->schedulingPolicyComboBox->setCurrentIndex(2);
+        break;
+    case CpuScheduler::Balanced:
+    default:
+        ui->schedulingPolicyComboBox->setCurrentIndex(1);
+        break;
+    }
+
+    setThreadsPerJobToUI(settings.threadsPerJob);
+
+    // 自适应并发
+    ui->adaptiveConcurrencyCheckBox->setChecked(settings.adaptiveConcurrency);
+    ui->minConcurrentJobsSpinBox->setValue(settings.minConcurrentJobs);
+    ui->maxConcurrentJobsSpinBox->setValue(settings.maxConcurrentJobs);
+
+    // 通道并发上限
+    ui->urgentLaneJobsSpinBox->setValue(settings.urgentLaneJobs);
+    ui->normalLaneJobsSpinBox->setValue(settings.normalLaneJobs);
+    ui->backgroundLaneJobsSpinBox->setValue(settings.backgroundLaneJobs);
+
+    // 任务顺序
+    QStringList jobOrders = {"longestFirst", "shortestFirst", "name"};
+    int orderIndex = jobOrders.indexOf(settings.jobOrder);
+    ui->jobOrderComboBox->setCurrentIndex(orderIndex != -1 ? orderIndex : 0);
+
+    // 分段转码
+    ui->chunkedEncodingCheckBox->setChecked(settings.chunkedEncoding);
+    ui->chunkThresholdSpinBox->setValue(qMax(1, settings.chunkThresholdSec / 60));
+
+    // 本地暂存
+    ui->scratchStagingCheckBox->setChecked(settings.scratchStaging);
+    ui->scratchDirectoryLineEdit->setText(settings.scratchDirectory);
+    ui->minFreeSpaceSpinBox->setValue(settings.minFreeSpaceMb);
+
+    // 每设备并发读写
+    ui->readersPerDeviceSpinBox->setValue(settings.readersPerDevice);
+    ui->writersPerDeviceSpinBox->setValue(settings.writersPerDevice);
+
+    // 指标服务
+    ui->metricsEnabledCheckBox->setChecked(settings.metricsEnabled);
+    ui->metricsPortSpinBox->setValue(settings.metricsPort);
+
+    // 吞吐目标
+    ui->throughputTargetSpinBox->setValue(settings.throughputTargetMinutes);
+    ui->throughputModeComboBox->setCurrentIndex((settings.throughputMode == "ingest") ? 1 : 0);
+    updateCalibrationStatus();
+}
+
+void SettingDialog::onCalibrateButtonClicked()
+{
+    if (m_calibrationThread)
+    {
+        return;
+    }
+
+    // 按当前界面上的编码器、分辨率、每任务线程数和调度策略标定
+    QThread *thread = new QThread(this);
+    Calibration *calibration = new Calibration(getTranscodeSettingsFromUI(), getSystemSettingsFromUI());
+    calibration->moveToThread(thread);
+    m_calibrationThread = thread;
+    m_calibrationWorker = calibration;
+
+    // 先于其他连接建立：无论标定正常结束、取消还是对话框关闭时被停止，线程结束后都删除标定对象
+    connect(thread, &QThread::finished, calibration, &QObject::deleteLater);
+    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+
+    QProgressDialog *progressDialog = new QProgressDialog(QString::fromLocal8Bit("正在标定..."), QString::fromLocal8Bit("取消"), 0, 100, this);
+    progressDialog->setWindowTitle(QString::fromLocal8Bit("本机标定"));
+    progressDialog->setWindowModality(Qt::WindowModal);
+    progressDialog->setMinimumDuration(0);
+    progressDialog->setAutoClose(false);
+    progressDialog->setAutoReset(false);
+
+    connect(thread, &QThread::started, calibration, &Calibration::run);
+    connect(calibration, &Calibration::progress, progressDialog, [progressDialog](int percent, const QString &message)
+            {
+                progressDialog->setValue(percent);
+                progressDialog->setLabelText(message);
+            });
+    connect(progressDialog, &QProgressDialog::canceled, this, [calibration]()
+            { calibration->cancel(); });
+    connect(calibration, &Calibration::finished, this, [this, progressDialog](const CalibrationProfile &profile, const QString &error)
+            {
+                progressDialog->deleteLater();
+                if (!error.isEmpty())
+                {
+                    QMessageBox::warning(this, QString::fromLocal8Bit("本机标定"), error);
+                    return;
+                }
+                m_calibration = profile;
+                updateCalibrationStatus();
+            });
+    connect(calibration, &Calibration::finished, thread, &QThread::quit);
+
+    ui->calibrateButton->setEnabled(false);
+    connect(thread, &QThread::finished, this, [this]()
+            { ui->calibrateButton->setEnabled(true); });
+
+    thread->start();
+}
+
+void SettingDialog::updateCalibrationStatus()
+{
+    if (!m_calibration.isValid())
+    {
+        ui->calibrationStatusLabel->setText(QString::fromLocal8Bit("未标定"));
+        return;
+    }
+
+    QString status = QString::fromLocal8Bit("%1 %2，%3 核，%4")
+                         .arg(m_calibration.codec)
+                         .arg(m_calibration.resolution)
+                         .arg(m_calibration.cores)
+                         .arg(QDateTime::fromString(m_calibration.measuredAt, Qt::ISODate).toString("yyyy-MM-dd hh:mm"));
+
+    // 预览当前目标下会选择的预设和并发数
+    int target = ui->throughputTargetSpinBox->value();
+    if (target > 0)
+    {
+        QString mode = (ui->throughputModeComboBox->currentIndex() == 1) ? "ingest" : "output";
+        int threadsPerJob = ui->threadsPerJobComboBox->currentData().toInt();
+        Calibration::Choice choice = Calibration::choose(m_calibration, getTranscodeSettingsFromUI(), threadsPerJob, target, mode);
+        if (!choice.valid)
+        {
+            status += QString::fromLocal8Bit("\n标定时的编码器或每任务线程数与当前不同，需要重新标定");
+        }
+        else if (choice.achievable)
+        {
+            status += QString::fromLocal8Bit("\n将使用 %1 × %2 个任务（约 %3 分钟/小时）")
+                          .arg(choice.preset)
+                          .arg(choice.jobs)
+                          .arg(qRound(choice.realtimeFactor * 60));
+        }
+        else
+        {
+            status += QString::fromLocal8Bit("\n无法达到目标，最快为 %1 × %2 个任务（约 %3 分钟/小时）")
+                          .arg(choice.preset)
+                          .arg(choice.jobs)
+                          .arg(qRound(choice.realtimeFactor * 60));
+        }
+    }
+    ui->calibrationStatusLabel->setText(status);
 }
 
 void SettingDialog::onResetButtonClicked()
@@ -441,8 +691,47 @@ void SettingDialog::setThreadCountToUI(int threadCount)
 
 int SettingDialog::getOptimalThreadCount() const
 {
-    int coreCount = QThread::idealThreadCount();
-    if (coreCount <= 0)
-        coreCount = 4;
-    return qMax(1, coreCount - 1);
+    CpuScheduler::Plan plan = CpuScheduler::plan(CpuScheduler::availableCores(), 0, 0, CpuScheduler::Balanced);
+    return plan.jobs;
+}
+
+void SettingDialog::initEngineComboBox()
+{
+    // 未编译进程内引擎时该选项不可选，已保存的libav设置在转码时退回ffmpeg进程
+    if (LibavEngine::isAvailable())
+    {
+        ui->engineComboBox->setItemData(1, LibavEngine::version(), Qt::ToolTipRole);
+        return;
+    }
+
+    QStandardItemModel *model = qobject_cast<QStandardItemModel *>(ui->engineComboBox->model());
+    if (model)
+    {
+        model->item(1)->setEnabled(false);
+    }
+    ui->engineComboBox->setItemData(1, QString::fromLocal8Bit("编译时未开启 TRANSCODER_WITH_LIBAV"), Qt::ToolTipRole);
+}
+
+void SettingDialog::initThreadsPerJobComboBox()
+{
+    ui->threadsPerJobComboBox->clear();
+
+    // 自动：按调度策略计算
+    ui->threadsPerJobComboBox->addItem(QString::fromLocal8Bit("自动"), 0);
+
+    int coreCount = CpuScheduler::availableCores();
+    QList<int> threadCounts = {1, 2, 4, 8, 16, 32};
+    for (int count : threadCounts)
+    {
+        if (count <= coreCount)
+        {
+            ui->threadsPerJobComboBox->addItem(QString::fromLocal8Bit("%1线程").arg(count), count);
+        }
+    }
+}
+
+void SettingDialog::setThreadsPerJobToUI(int threadsPerJob)
+{
+    int index = ui->threadsPerJobComboBox->findData(threadsPerJob);
+    ui->threadsPerJobComboBox->setCurrentIndex(index != -1 ? index : 0);
 }
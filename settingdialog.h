@@ -2,8 +2,12 @@
 #define SETTINGDIALOG_H
 
 #include <QDialog>
+#include <QPointer>
 #include "configmanager.h"
 
+class QThread;
+class Calibration;
+
 QT_BEGIN_NAMESPACE
 namespace Ui
 {
@@ -24,10 +28,15 @@ private slots:
     void onBrowseSourceButtonClicked();
     void onBrowseTargetButtonClicked();
     void onThemeChanged();
+    void onCalibrateButtonClicked();
+    void updateCalibrationStatus();
     void accept() override;
 
 private:
     Ui::SettingDialog *ui;
+    CalibrationProfile m_calibration; // 标定结果不在界面上编辑，恢复默认设置时保留
+    QPointer<QThread> m_calibrationThread;     // 标定线程结束后自动删除，指针随之清空
+    QPointer<Calibration> m_calibrationWorker;
 
     void loadSettings();
     void saveSettings();
@@ -35,7 +44,10 @@ private:
     void connectSignals();
     void applyTheme(const QString &theme);
     void initThreadCountComboBox();
+    void initThreadsPerJobComboBox();
+    void initEngineComboBox();
     void setThreadCountToUI(int threadCount);
+    void setThreadsPerJobToUI(int threadsPerJob);
     int getOptimalThreadCount() const;
 
     TranscodeSettings getTranscodeSettingsFromUI() const;
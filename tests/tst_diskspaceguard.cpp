@@ -0,0 +1,48 @@
+﻿#include "utils/diskspaceguard.h"
+#include <QStorageInfo>
+#include <QTemporaryDir>
+#include <QtTest>
+
+/**
+ * 磁盘空间预留：各剧集目录中的同名文件分别预留
+ */
+class TestDiskSpaceGuard : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void sameFileNameInDifferentDirectories()
+    {
+        QTemporaryDir root;
+        QVERIFY(root.isValid());
+        QDir dir(root.path());
+        QVERIFY(dir.mkpath("dramaA") && dir.mkpath("dramaB"));
+        QString outputA = dir.absoluteFilePath("dramaA/第1集_temp.mp4");
+        QString outputB = dir.absoluteFilePath("dramaB/第1集_temp.mp4");
+
+        // 每个文件约占剩余空间的30%，两个都预留后再要50%必须失败
+        qint64 available = QStorageInfo(root.path()).bytesAvailable();
+        QVERIFY(available > 0);
+        DiskSpaceGuard::Needs needsA, needsB, needsLarge;
+        DiskSpaceGuard::addNeed(needsA, dir.absoluteFilePath("dramaA"), available * 3 / 10, {outputA});
+        DiskSpaceGuard::addNeed(needsB, dir.absoluteFilePath("dramaB"), available * 3 / 10, {outputB});
+        DiskSpaceGuard::addNeed(needsLarge, root.path(), available / 2, {});
+
+        DiskSpaceGuard guard;
+        guard.setFloorBytes(1);
+        QVERIFY(guard.tryReserve(outputA, needsA));
+        QVERIFY(guard.tryReserve(outputB, needsB));
+        QVERIFY(!guard.tryReserve("large", needsLarge));
+
+        // 释放其中一个只归还它自己的预留
+        guard.release(outputA);
+        QVERIFY(guard.hasReservations());
+        QVERIFY(guard.tryReserve("large", needsLarge));
+        guard.release(outputB);
+        guard.release("large");
+        QVERIFY(!guard.hasReservations());
+    }
+};
+
+QTEST_APPLESS_MAIN(TestDiskSpaceGuard)
+#include "tst_diskspaceguard.moc"
@@ -0,0 +1,79 @@
+﻿#include "utils/ffmpegutils.h"
+#include <QtTest>
+
+/**
+ * 直接复制流的判断：只有与重新编码的输出完全一致的源才能复制
+ */
+class TestStreamCompliance : public QObject
+{
+    Q_OBJECT
+
+private:
+    // 与默认转码参数（h264 High 720x1280 30fps yuv420p bt709）一致的ffprobe输出，色彩标注可替换
+    static QByteArray probeJson(const QString &colorSpace, const QString &primaries, const QString &transfer, const QString &range)
+    {
+        QJsonObject stream;
+        stream["codec_type"] = "video";
+        stream["codec_name"] = "h264";
+        stream["profile"] = "High";
+        stream["pix_fmt"] = "yuv420p";
+        stream["width"] = 720;
+        stream["height"] = 1280;
+        stream["avg_frame_rate"] = "30/1";
+        if (!colorSpace.isEmpty())
+        {
+            stream["color_space"] = colorSpace;
+            stream["color_primaries"] = primaries;
+            stream["color_transfer"] = transfer;
+            stream["color_range"] = range;
+        }
+
+        QJsonObject format;
+        format["duration"] = "60.000000";
+        format["size"] = "1000000";
+
+        QJsonObject root;
+        root["format"] = format;
+        root["streams"] = QJsonArray{stream};
+        return QJsonDocument(root).toJson();
+    }
+
+    static FFmpegUtils::TranscodeParams targetParams()
+    {
+        FFmpegUtils::TranscodeParams params;
+        params.resolutionPreset = FFmpegUtils::RESOLUTION_CUSTOM;
+        params.customResolution = QSize(720, 1280);
+        return params;
+    }
+
+private slots:
+    void matchingSourceIsCopied()
+    {
+        FFmpegUtils::MediaInfo info = FFmpegUtils::parseProbeOutput(probeJson("bt709", "bt709", "bt709", "tv"));
+        QCOMPARE(info.colorSpace, QString("bt709"));
+        QVERIFY(FFmpegUtils::checkCompliance(info, targetParams()).video);
+    }
+
+    void bt470bgSourceIsReencoded()
+    {
+        FFmpegUtils::MediaInfo info = FFmpegUtils::parseProbeOutput(probeJson("bt470bg", "bt470bg", "smpte170m", "tv"));
+        QCOMPARE(info.colorSpace, QString("bt470bg"));
+        QVERIFY(!FFmpegUtils::checkCompliance(info, targetParams()).video);
+    }
+
+    void untaggedSourceIsReencoded()
+    {
+        FFmpegUtils::MediaInfo info = FFmpegUtils::parseProbeOutput(probeJson(QString(), QString(), QString(), QString()));
+        QVERIFY(info.colorSpace.isEmpty());
+        QVERIFY(!FFmpegUtils::checkCompliance(info, targetParams()).video);
+    }
+
+    void fullRangeSourceIsReencoded()
+    {
+        FFmpegUtils::MediaInfo info = FFmpegUtils::parseProbeOutput(probeJson("bt709", "bt709", "bt709", "pc"));
+        QVERIFY(!FFmpegUtils::checkCompliance(info, targetParams()).video);
+    }
+};
+
+QTEST_APPLESS_MAIN(TestStreamCompliance)
+#include "tst_streamcompliance.moc"
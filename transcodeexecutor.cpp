@@ -0,0 +1,253 @@
+﻿#include "transcodeexecutor.h"
+#include <QDebug>
+
+/**
+ * 包装实际任务：执行结束后释放槽位并调度下一个任务
+ */
+class TranscodeExecutor::LaneTask : public QRunnable
+{
+public:
+    LaneTask(QRunnable *task, Lane lane, TranscodeExecutor *executor)
+        : m_task(task), m_lane(lane), m_executor(executor)
+    {
+        setAutoDelete(true);
+    }
+
+    void run() override
+    {
+        m_task->run();
+
+        // 先归还资源再删除任务，避免新任务复用同一地址时与未归还的记录混淆
+        m_executor->releaseTask(m_task);
+        if (m_task->autoDelete())
+        {
+            delete m_task;
+        }
+        m_executor->onTaskFinished(m_lane);
+    }
+
+private:
+    QRunnable *m_task;
+    Lane m_lane;
+    TranscodeExecutor *m_executor;
+};
+
+TranscodeExecutor::TranscodeExecutor()
+{
+    m_pool.setMaxThreadCount(m_maxConcurrent);
+}
+
+TranscodeExecutor::~TranscodeExecutor()
+{
+    clear();
+    waitForDone();
+}
+
+void TranscodeExecutor::setMaxConcurrent(int jobs)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maxConcurrent = qMax(1, jobs);
+
+    // 调度由执行器自己控制，线程池只需要足够的线程；缩小时运行中的任务不受影响
+    m_pool.setMaxThreadCount(m_maxConcurrent);
+    dispatchLocked();
+}
+
+int TranscodeExecutor::maxConcurrent() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maxConcurrent;
+}
+
+void TranscodeExecutor::setLaneLimit(Lane lane, int jobs)
+{
+    QMutexLocker locker(&m_mutex);
+    m_laneLimits[lane] = qMax(0, jobs);
+    dispatchLocked();
+}
+
+void TranscodeExecutor::setAdmissionCheck(const AdmissionCheck &check, const ReleaseCallback &release)
+{
+    QMutexLocker locker(&m_mutex);
+    m_admissionCheck = check;
+    m_releaseCallback = release;
+}
+
+void TranscodeExecutor::retryAdmission()
+{
+    QMutexLocker locker(&m_mutex);
+    dispatchLocked();
+}
+
+bool TranscodeExecutor::isAdmissionPaused() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_admissionPaused;
+}
+
+void TranscodeExecutor::submit(QRunnable *task, Lane lane, int priority)
+{
+    QMutexLocker locker(&m_mutex);
+
+    // 按优先级插入，相同优先级保持提交顺序
+    QList<Entry> &queue = m_queues[lane];
+    int index = 0;
+    while (index < queue.size() && queue[index].priority >= priority)
+    {
+        ++index;
+    }
+
+    Entry entry;
+    entry.task = task;
+    entry.priority = priority;
+    queue.insert(index, entry);
+
+    dispatchLocked();
+}
+
+bool TranscodeExecutor::take(QRunnable *task)
+{
+    QMutexLocker locker(&m_mutex);
+    for (QList<Entry> &queue : m_queues)
+    {
+        for (int i = 0; i < queue.size(); ++i)
+        {
+            if (queue[i].task == task)
+            {
+                queue.removeAt(i);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void TranscodeExecutor::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    for (QList<Entry> &queue : m_queues)
+    {
+        for (const Entry &entry : queue)
+        {
+            if (entry.task->autoDelete())
+            {
+                delete entry.task;
+            }
+        }
+        queue.clear();
+    }
+}
+
+void TranscodeExecutor::waitForDone()
+{
+    m_pool.waitForDone();
+}
+
+int TranscodeExecutor::runningCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    int running = 0;
+    for (int count : m_running)
+    {
+        running += count;
+    }
+    return running;
+}
+
+int TranscodeExecutor::queuedCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    int queued = 0;
+    for (const QList<Entry> &queue : m_queues)
+    {
+        queued += queue.size();
+    }
+    return queued;
+}
+
+QString TranscodeExecutor::laneToString(Lane lane)
+{
+    switch (lane)
+    {
+    case Urgent:
+        return "urgent";
+    case Background:
+        return "background";
+    case Normal:
+    default:
+        return "normal";
+    }
+}
+
+void TranscodeExecutor::dispatchLocked()
+{
+    int running = 0;
+    for (int count : m_running)
+    {
+        running += count;
+    }
+
+    // 所有排队任务都未通过准入检查的通道本轮不再启动任务，其它通道照常启动
+    bool blocked[LaneCount] = {};
+    m_admissionPaused = false;
+
+    while (running < m_maxConcurrent)
+    {
+        // 从最高优先级的通道开始找未达到上限且有任务的通道
+        int lane = 0;
+        for (; lane < LaneCount; ++lane)
+        {
+            bool underLimit = m_laneLimits[lane] == 0 || m_running[lane] < m_laneLimits[lane];
+            if (!m_queues[lane].isEmpty() && underLimit && !blocked[lane])
+            {
+                break;
+            }
+        }
+
+        if (lane == LaneCount)
+        {
+            return;
+        }
+
+        // 按队列顺序找第一个通过准入检查的任务
+        int index = 0;
+        if (m_admissionCheck)
+        {
+            while (index < m_queues[lane].size() && !m_admissionCheck(m_queues[lane][index].task))
+            {
+                m_admissionPaused = true;
+                ++index;
+            }
+            if (index == m_queues[lane].size())
+            {
+                blocked[lane] = true;
+                continue;
+            }
+        }
+
+        Entry entry = m_queues[lane].takeAt(index);
+        m_running[lane]++;
+        running++;
+        m_pool.start(new LaneTask(entry.task, static_cast<Lane>(lane), this));
+    }
+}
+
+void TranscodeExecutor::releaseTask(QRunnable *task)
+{
+    ReleaseCallback release;
+    {
+        QMutexLocker locker(&m_mutex);
+        release = m_releaseCallback;
+    }
+    if (release)
+    {
+        release(task);
+    }
+}
+
+void TranscodeExecutor::onTaskFinished(Lane lane)
+{
+    QMutexLocker locker(&m_mutex);
+    m_running[lane]--;
+    dispatchLocked();
+}
@@ -0,0 +1,101 @@
+﻿#ifndef TRANSCODEEXECUTOR_H
+#define TRANSCODEEXECUTOR_H
+
+#include <QRunnable>
+#include <QThreadPool>
+#include <QMutex>
+#include <QList>
+#include <QString>
+#include <functional>
+
+/**
+ * 转码任务执行器
+ * 使用独立的线程池（不修改QThreadPool::globalInstance()），
+ * 任务按紧急/普通/后台三条通道排队，每条通道有自己的并发上限，
+ * 有空闲槽位时总是先启动优先级最高的通道中的任务。
+ * 可设置准入检查：通道中未通过检查的任务留在队列中，先启动同一通道中后面能通过的任务，
+ * 等下一次调度（任务结束或 retryAdmission()）时再检查
+ */
+class TranscodeExecutor
+{
+public:
+    // 任务通道，数值越小优先级越高
+    enum Lane
+    {
+        Urgent = 0, // 紧急：监视目录中新到达的文件等需要尽快产出的任务
+        Normal,     // 普通：手动提交的批次
+        Background, // 后台：存量文件的重新编码
+        LaneCount
+    };
+
+    // 准入检查，在执行器锁内调用，不能再调用执行器的方法
+    using AdmissionCheck = std::function<bool(QRunnable *task)>;
+    // 通过准入的任务执行结束后调用（任务删除之前，不持有执行器锁），用于归还准入时占用的资源
+    using ReleaseCallback = std::function<void(QRunnable *task)>;
+
+    TranscodeExecutor();
+    ~TranscodeExecutor();
+
+    // 总并发上限（所有通道之和）
+    void setMaxConcurrent(int jobs);
+    int maxConcurrent() const;
+
+    // 单个通道的并发上限（0=只受总并发限制）
+    void setLaneLimit(Lane lane, int jobs);
+
+    /**
+     * 提交任务
+     * @param task 任务，autoDelete为true时执行后由执行器删除
+     * @param lane 所属通道
+     * @param priority 通道内的优先级，越大越先执行，相同时先进先出
+     */
+    void submit(QRunnable *task, Lane lane = Normal, int priority = 0);
+
+    // 启动任务前的准入检查和结束后的释放（为空时不检查）
+    void setAdmissionCheck(const AdmissionCheck &check, const ReleaseCallback &release = ReleaseCallback());
+
+    // 重新尝试启动因准入检查暂停的任务（如磁盘空间已释放）
+    void retryAdmission();
+
+    // 最近一次调度是否有任务未通过准入检查
+    bool isAdmissionPaused() const;
+
+    // 从队列中取出尚未开始的任务（不删除），任务已开始或不在队列中时返回false
+    bool take(QRunnable *task);
+
+    // 丢弃所有尚未开始的任务
+    void clear();
+
+    // 等待所有已开始的任务结束
+    void waitForDone();
+
+    int runningCount() const;
+    int queuedCount() const;
+
+    static QString laneToString(Lane lane);
+
+private:
+    class LaneTask;
+
+    struct Entry
+    {
+        QRunnable *task = nullptr;
+        int priority = 0;
+    };
+
+    QThreadPool m_pool;
+    mutable QMutex m_mutex;
+    QList<Entry> m_queues[LaneCount];
+    int m_running[LaneCount] = {};
+    int m_laneLimits[LaneCount] = {};
+    int m_maxConcurrent = 1;
+    AdmissionCheck m_admissionCheck;
+    ReleaseCallback m_releaseCallback;
+    bool m_admissionPaused = false;
+
+    void dispatchLocked();
+    void onTaskFinished(Lane lane);
+    void releaseTask(QRunnable *task);
+};
+
+#endif // TRANSCODEEXECUTOR_H
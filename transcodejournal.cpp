@@ -0,0 +1,330 @@
+﻿#include "transcodejournal.h"
+#include "chunkedtranscodejob.h"
+#include "transcodetaskmanager.h"
+#include "utils/scratchstaging.h"
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QSet>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+int TranscodeJournal::Recovery::fileCount() const
+{
+    int count = 0;
+    for (const QStringList &names : files)
+    {
+        count += names.size();
+    }
+    return count;
+}
+
+TranscodeJournal::TranscodeJournal()
+{
+}
+
+TranscodeJournal::~TranscodeJournal()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_file.isOpen())
+    {
+        syncLocked();
+        m_file.close();
+    }
+}
+
+QString TranscodeJournal::defaultPath()
+{
+    return configFilePath("transcode_journal.jsonl");
+}
+
+QString TranscodeJournal::headlessPath()
+{
+    return configFilePath("transcode_journal_headless.jsonl");
+}
+
+bool TranscodeJournal::open(const QString &path, const QString &targetDirectory, const TranscodeSettings &settings,
+                            const QString &scratchDirectory)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_file.isOpen())
+        {
+            m_file.close();
+        }
+
+        // 批次可能运行数小时，不按锁的存在时间判断失效，只看持有进程是否还在运行
+        m_lock.reset(new QLockFile(lockPath(path)));
+        m_lock->setStaleLockTime(0);
+        if (!m_lock->tryLock(0))
+        {
+            qDebug() << QString::fromLocal8Bit("转码日志正被另一个实例使用:") << path;
+            m_lock.reset();
+            return false;
+        }
+
+        m_file.setFileName(path);
+        if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            qDebug() << QString::fromLocal8Bit("无法创建转码日志:") << path << m_file.errorString();
+            m_lock.reset();
+            return false;
+        }
+        m_unsynced = 0;
+        m_sinceSync.start();
+    }
+
+    QJsonObject header;
+    header["type"] = "batch";
+    header["version"] = 1;
+    header["time"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    header["target"] = targetDirectory;
+    header["scratch"] = scratchDirectory;
+    header["settings"] = ConfigManager::transcodeSettingsToJson(settings);
+    append(header, true);
+    return true;
+}
+
+bool TranscodeJournal::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+void TranscodeJournal::recordQueued(const QString &inputPath, const QString &tempOutputPath)
+{
+    QJsonObject record;
+    record["type"] = "queued";
+    record["input"] = inputPath;
+    record["temp"] = tempOutputPath;
+    append(record);
+}
+
+void TranscodeJournal::recordFinished(const QString &tempOutputPath, bool success)
+{
+    QJsonObject record;
+    record["type"] = "finished";
+    record["temp"] = tempOutputPath;
+    record["success"] = success;
+    append(record);
+}
+
+void TranscodeJournal::sync()
+{
+    QMutexLocker locker(&m_mutex);
+    syncLocked();
+}
+
+void TranscodeJournal::discard()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_file.isOpen())
+    {
+        m_file.close();
+    }
+    if (!m_file.fileName().isEmpty())
+    {
+        QFile::remove(m_file.fileName());
+    }
+    m_lock.reset();
+}
+
+bool TranscodeJournal::isLocked(const QString &path)
+{
+    QLockFile lock(lockPath(path));
+    lock.setStaleLockTime(0);
+    if (!lock.tryLock(0))
+    {
+        return true;
+    }
+    lock.unlock();
+    return false;
+}
+
+void TranscodeJournal::append(const QJsonObject &record, bool forceSync)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_file.isOpen())
+    {
+        return;
+    }
+
+    m_file.write(QJsonDocument(record).toJson(QJsonDocument::Compact));
+    m_file.write("\n");
+    m_unsynced++;
+
+    // 合并多条记录做一次fsync，避免每条记录都等待磁盘
+    if (forceSync || m_unsynced >= SyncBatchSize || m_sinceSync.elapsed() >= SyncIntervalMs)
+    {
+        syncLocked();
+    }
+}
+
+void TranscodeJournal::syncLocked()
+{
+    if (!m_file.isOpen() || m_unsynced == 0)
+    {
+        return;
+    }
+
+    m_file.flush();
+#ifdef Q_OS_WIN
+    _commit(m_file.handle());
+#else
+    fsync(m_file.handle());
+#endif
+    m_unsynced = 0;
+    m_sinceSync.restart();
+}
+
+TranscodeJournal::Recovery TranscodeJournal::recover(const QString &path)
+{
+    Recovery recovery;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return recovery;
+    }
+
+    QStringList order;             // 排队顺序
+    QMap<QString, QString> inputs; // 临时输出 -> 源文件
+    QSet<QString> finished;
+    bool hasHeader = false;
+
+    while (!file.atEnd())
+    {
+        // 崩溃时最后一行可能不完整，解析失败的行直接跳过
+        QJsonObject record = QJsonDocument::fromJson(file.readLine()).object();
+        QString type = record["type"].toString();
+
+        if (type == "batch")
+        {
+            hasHeader = true;
+            recovery.targetDirectory = record["target"].toString();
+            recovery.scratchDirectory = record["scratch"].toString();
+            ConfigManager::transcodeSettingsFromJson(record["settings"].toObject(), recovery.settings);
+        }
+        else if (type == "queued")
+        {
+            QString temp = record["temp"].toString();
+            if (!inputs.contains(temp))
+            {
+                order.append(temp);
+            }
+            inputs.insert(temp, record["input"].toString());
+        }
+        else if (type == "finished")
+        {
+            // 失败的文件同样视为已处理，不在恢复时反复重试
+            finished.insert(record["temp"].toString());
+        }
+    }
+    file.close();
+
+    if (!hasHeader)
+    {
+        return recovery;
+    }
+
+    for (const QString &temp : order)
+    {
+        QString input = inputs.value(temp);
+        if (finished.contains(temp) || QFile::exists(finalOutputPath(temp)) || !QFile::exists(input))
+        {
+            continue;
+        }
+
+        QFileInfo inputInfo(input);
+        recovery.files[inputInfo.absolutePath()].append(inputInfo.fileName());
+        recovery.tempOutputs.append(temp);
+    }
+
+    qDebug() << QString::fromLocal8Bit("转码日志中未完成的文件: %1").arg(recovery.fileCount());
+    return recovery;
+}
+
+void TranscodeJournal::cleanOrphans(const Recovery &recovery)
+{
+    const QString &scratch = recovery.scratchDirectory;
+    QStringList files;
+    QStringList chunkDirs;
+
+    // 暂存时源文件先复制到本地
+    if (!scratch.isEmpty())
+    {
+        for (auto it = recovery.files.begin(); it != recovery.files.end(); ++it)
+        {
+            for (const QString &name : it.value())
+            {
+                files << ScratchStaging::localPathFor(scratch, QDir(it.key()).absoluteFilePath(name));
+            }
+        }
+    }
+
+    for (const QString &temp : recovery.tempOutputs)
+    {
+        QStringList outputs = {temp};
+        for (const Rendition &rendition : recovery.settings.renditions)
+        {
+            outputs << TranscodeTaskManager::renditionOutputPath(temp, rendition);
+        }
+        chunkDirs << ChunkedTranscodeJob::workDirFor(temp);
+
+        files << outputs;
+        if (!scratch.isEmpty())
+        {
+            for (const QString &output : outputs)
+            {
+                files << ScratchStaging::localPathFor(scratch, output);
+            }
+            chunkDirs << ChunkedTranscodeJob::workDirFor(ScratchStaging::localPathFor(scratch, temp));
+        }
+    }
+
+    for (const QString &path : files)
+    {
+        if (QFile::exists(path) && QFile::remove(path))
+        {
+            qDebug() << QString::fromLocal8Bit("删除中断遗留的临时文件:") << path;
+        }
+    }
+    for (const QString &path : chunkDirs)
+    {
+        QDir chunks(path);
+        if (chunks.exists())
+        {
+            chunks.removeRecursively();
+        }
+    }
+}
+
+void TranscodeJournal::remove(const QString &path)
+{
+    QFile::remove(path);
+}
+
+QString TranscodeJournal::configFilePath(const QString &fileName)
+{
+    QString configDir = QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation);
+    QDir().mkpath(configDir);
+    return QDir(configDir).filePath(fileName);
+}
+
+QString TranscodeJournal::lockPath(const QString &path)
+{
+    return path + ".lock";
+}
+
+QString TranscodeJournal::finalOutputPath(const QString &tempOutputPath)
+{
+    // 与TranscodeTaskManager::onTaskCompleted中的重命名规则一致
+    QString finalPath = tempOutputPath;
+    finalPath.replace("_temp", "");
+    return finalPath;
+}
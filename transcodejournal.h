@@ -0,0 +1,90 @@
+﻿#ifndef TRANSCODEJOURNAL_H
+#define TRANSCODEJOURNAL_H
+
+#include <QString>
+#include <QStringList>
+#include <QMap>
+#include <QFile>
+#include <QLockFile>
+#include <QMutex>
+#include <QScopedPointer>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <configmanager.h>
+
+/**
+ * 转码批次日志
+ * 以JSON Lines追加写入批次设置和每个文件的排队/完成记录，
+ * 程序或系统崩溃后据此恢复未完成的文件。
+ * 写入按批次fsync：丢失最后几条记录时，恢复阶段会结合输出文件是否存在来纠正。
+ * 打开期间持有日志旁的锁文件，其他实例据此判断批次仍在运行，不会恢复或清理它
+ */
+class TranscodeJournal
+{
+public:
+    // 从日志中恢复出的未完成批次
+    struct Recovery
+    {
+        QString targetDirectory;
+        QString scratchDirectory;         // 批次使用的本地暂存目录（为空表示未暂存）
+        TranscodeSettings settings;
+        QMap<QString, QStringList> files; // 源目录 -> 未完成的文件名
+        QStringList tempOutputs;          // 未完成文件对应的临时输出路径
+
+        bool isEmpty() const { return files.isEmpty(); }
+        int fileCount() const;
+    };
+
+    TranscodeJournal();
+    ~TranscodeJournal();
+
+    // 默认日志路径，与配置文件位于同一目录
+    static QString defaultPath();
+
+    // 无界面模式的日志路径，与界面的批次互不覆盖
+    static QString headlessPath();
+
+    // 开始新批次：获取锁后截断旧日志并写入批次头，另一个实例正在使用该日志时失败
+    bool open(const QString &path, const QString &targetDirectory, const TranscodeSettings &settings,
+              const QString &scratchDirectory = QString());
+    bool isOpen() const;
+
+    void recordQueued(const QString &inputPath, const QString &tempOutputPath);
+    void recordFinished(const QString &tempOutputPath, bool success);
+
+    // 立即把已写入的记录刷到磁盘
+    void sync();
+
+    // 批次完成或被用户停止：删除日志并释放锁
+    void discard();
+
+    // 日志是否正被另一个运行中的实例持有（崩溃实例留下的锁视为已释放）
+    static bool isLocked(const QString &path);
+
+    // 读取日志，返回最终输出仍不存在的文件
+    static Recovery recover(const QString &path);
+
+    // 删除未完成文件留下的临时输出（含附加输出）、分段目录和暂存目录中的副本
+    static void cleanOrphans(const Recovery &recovery);
+
+    // 放弃恢复时删除日志
+    static void remove(const QString &path);
+
+private:
+    QFile m_file;
+    QScopedPointer<QLockFile> m_lock;
+    QMutex m_mutex;
+    QElapsedTimer m_sinceSync;
+    int m_unsynced = 0;
+
+    static const int SyncIntervalMs = 1000; // 两次fsync的最小间隔
+    static const int SyncBatchSize = 32;    // 累积这么多条记录后立即fsync
+
+    void append(const QJsonObject &record, bool forceSync = false);
+    void syncLocked();
+    static QString finalOutputPath(const QString &tempOutputPath);
+    static QString configFilePath(const QString &fileName);
+    static QString lockPath(const QString &path);
+};
+
+#endif // TRANSCODEJOURNAL_H
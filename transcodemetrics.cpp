@@ -0,0 +1,121 @@
+﻿#include "transcodemetrics.h"
+#include <QDateTime>
+
+TranscodeMetrics::TranscodeMetrics()
+    : m_jobDuration({10, 30, 60, 120, 300, 600, 1200, 1800, 3600, 7200}),
+      m_queueWait({1, 5, 15, 60, 300, 900, 1800, 3600, 7200})
+{
+}
+
+TranscodeMetrics::Histogram::Histogram(const QVector<double> &upperBounds)
+    : bounds(upperBounds), counts(upperBounds.size() + 1, 0)
+{
+}
+
+void TranscodeMetrics::Histogram::observe(double value)
+{
+    int bucket = 0;
+    while (bucket < bounds.size() && value > bounds[bucket])
+    {
+        bucket++;
+    }
+    counts[bucket]++;
+    sum += value;
+    count++;
+}
+
+void TranscodeMetrics::jobQueued(const QString &inputPath)
+{
+    QMutexLocker locker(&m_mutex);
+    m_queuedAt.insert(inputPath, QDateTime::currentMSecsSinceEpoch());
+}
+
+void TranscodeMetrics::jobStarted(const QString &inputPath)
+{
+    QMutexLocker locker(&m_mutex);
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    auto it = m_queuedAt.find(inputPath);
+    if (it != m_queuedAt.end())
+    {
+        m_queueWait.observe((now - it.value()) / 1000.0);
+        m_queuedAt.erase(it);
+    }
+    m_running.insert(inputPath);
+    m_lastProgressMs = now;
+}
+
+void TranscodeMetrics::jobProgress(const QString &inputPath, double fps)
+{
+    QMutexLocker locker(&m_mutex);
+    m_fileFps.insert(inputPath, fps);
+    m_lastProgressMs = QDateTime::currentMSecsSinceEpoch();
+}
+
+void TranscodeMetrics::jobFinished(const JobStats &stats)
+{
+    QMutexLocker locker(&m_mutex);
+    m_queuedAt.remove(stats.inputPath);
+    m_running.remove(stats.inputPath);
+    m_fileFps.remove(stats.inputPath);
+
+    if (stats.success)
+    {
+        m_completed++;
+    }
+    else
+    {
+        m_failed++;
+    }
+    m_inputBytes += stats.inputBytes;
+    m_outputBytes += stats.outputBytes;
+    m_jobDuration.observe(stats.wallMs / 1000.0);
+}
+
+QByteArray TranscodeMetrics::render() const
+{
+    QMutexLocker locker(&m_mutex);
+
+    double totalFps = 0.0;
+    for (double fps : m_fileFps)
+    {
+        totalFps += fps;
+    }
+
+    QByteArray out;
+    appendMetric(out, "transcoder_jobs_queued", "gauge", "Files waiting to start.", QString::number(m_queuedAt.size()));
+    appendMetric(out, "transcoder_jobs_running", "gauge", "Files currently being transcoded.", QString::number(m_running.size()));
+    appendMetric(out, "transcoder_jobs_completed_total", "counter", "Files transcoded successfully.", QString::number(m_completed));
+    appendMetric(out, "transcoder_jobs_failed_total", "counter", "Files that failed to transcode.", QString::number(m_failed));
+    appendMetric(out, "transcoder_encode_fps", "gauge", "Sum of the latest encode fps of all running files.", QString::number(totalFps, 'f', 2));
+    appendMetric(out, "transcoder_input_bytes_total", "counter", "Source bytes of finished files.", QString::number(m_inputBytes));
+    appendMetric(out, "transcoder_output_bytes_total", "counter", "Output bytes of finished files.", QString::number(m_outputBytes));
+    appendMetric(out, "transcoder_last_progress_timestamp_seconds", "gauge", "Unix time of the latest progress report from any encoder.",
+                 QString::number(m_lastProgressMs / 1000.0, 'f', 3));
+    appendHistogram(out, "transcoder_job_duration_seconds", "Wall time per finished file.", m_jobDuration);
+    appendHistogram(out, "transcoder_queue_wait_seconds", "Time from queueing to start per file.", m_queueWait);
+    return out;
+}
+
+void TranscodeMetrics::appendMetric(QByteArray &out, const char *name, const char *type, const char *help, const QString &value)
+{
+    out += QByteArray("# HELP ") + name + ' ' + help + '\n';
+    out += QByteArray("# TYPE ") + name + ' ' + type + '\n';
+    out += QByteArray(name) + ' ' + value.toLatin1() + '\n';
+}
+
+void TranscodeMetrics::appendHistogram(QByteArray &out, const char *name, const char *help, const Histogram &histogram)
+{
+    out += QByteArray("# HELP ") + name + ' ' + help + '\n';
+    out += QByteArray("# TYPE ") + name + " histogram\n";
+
+    // Prometheus的桶是累积计数
+    quint64 cumulative = 0;
+    for (int i = 0; i < histogram.bounds.size(); ++i)
+    {
+        cumulative += histogram.counts[i];
+        out += QByteArray(name) + "_bucket{le=\"" + QByteArray::number(histogram.bounds[i]) + "\"} " + QByteArray::number(cumulative) + '\n';
+    }
+    out += QByteArray(name) + "_bucket{le=\"+Inf\"} " + QByteArray::number(histogram.count) + '\n';
+    out += QByteArray(name) + "_sum " + QByteArray::number(histogram.sum, 'f', 3) + '\n';
+    out += QByteArray(name) + "_count " + QByteArray::number(histogram.count) + '\n';
+}
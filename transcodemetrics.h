@@ -0,0 +1,62 @@
+﻿#ifndef TRANSCODEMETRICS_H
+#define TRANSCODEMETRICS_H
+
+#include <QByteArray>
+#include <QMap>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QVector>
+#include "transcodereport.h"
+
+/**
+ * 转码指标
+ * 由管理器在各回调中更新（可能来自多个工作线程），
+ * 按Prometheus文本格式输出队列深度、吞吐量和任务耗时分布
+ */
+class TranscodeMetrics
+{
+public:
+    TranscodeMetrics();
+
+    // 不同剧集目录中常有同名文件，各任务按源文件路径区分
+    void jobQueued(const QString &inputPath);
+    void jobStarted(const QString &inputPath);
+    void jobProgress(const QString &inputPath, double fps);
+    void jobFinished(const JobStats &stats);
+
+    // Prometheus text exposition format 0.0.4
+    QByteArray render() const;
+
+private:
+    /**
+     * 累积直方图（单位：秒）
+     */
+    struct Histogram
+    {
+        QVector<double> bounds;  // 各桶上界，不含+Inf
+        QVector<quint64> counts; // 落入各桶的样本数（非累积）
+        double sum = 0.0;
+        quint64 count = 0;
+
+        explicit Histogram(const QVector<double> &upperBounds = {});
+        void observe(double value);
+    };
+
+    mutable QMutex m_mutex;
+    QMap<QString, qint64> m_queuedAt; // 源路径 -> 入队时间（ms）
+    QSet<QString> m_running;          // 运行中文件的源路径
+    QMap<QString, double> m_fileFps;  // 运行中文件（按源路径）的最新帧率
+    quint64 m_completed = 0;
+    quint64 m_failed = 0;
+    qint64 m_inputBytes = 0;
+    qint64 m_outputBytes = 0;
+    qint64 m_lastProgressMs = 0;      // 最近一次收到进度的时间，用于发现停滞的编码
+    Histogram m_jobDuration;
+    Histogram m_queueWait;
+
+    static void appendHistogram(QByteArray &out, const char *name, const char *help, const Histogram &histogram);
+    static void appendMetric(QByteArray &out, const char *name, const char *type, const char *help, const QString &value);
+};
+
+#endif // TRANSCODEMETRICS_H
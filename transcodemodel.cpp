@@ -59,6 +59,10 @@ QVariant TranscodeModel::data(const QModelIndex &index, int role) const
         case Progress:
             if (record.status == TranscodeStatus::Processing)
             {
+                if (record.speed > 0)
+                {
+                    return QString("%1% (%2x)").arg(record.progress).arg(record.speed, 0, 'f', 2);
+                }
                 return QString("%1%").arg(record.progress);
             }
             else if (record.status == TranscodeStatus::Success)
@@ -70,6 +74,24 @@ QVariant TranscodeModel::data(const QModelIndex &index, int role) const
                 return QString::fromLocal8Bit("失败");
             }
             return QString("-");
+        case WallTime:
+            return record.hasStats ? formatDuration(record.stats.wallMs) : QString("-");
+        case CpuTime:
+            if (record.hasStats)
+            {
+                return QString("%1 / %2").arg(formatDuration(record.stats.userMs)).arg(formatDuration(record.stats.systemMs));
+            }
+            return QString("-");
+        case PeakMemory:
+            return record.hasStats && record.stats.peakRssKb > 0 ? formatBytes(record.stats.peakRssKb * 1024) : QString("-");
+        case FileSize:
+            if (record.hasStats)
+            {
+                return QString("%1 → %2").arg(formatBytes(record.stats.inputBytes)).arg(formatBytes(record.stats.outputBytes));
+            }
+            return QString("-");
+        case AverageFps:
+            return record.hasStats && record.stats.frames > 0 ? QString::number(record.stats.fps(), 'f', 1) : QString("-");
         }
         break;
 
@@ -103,10 +125,18 @@ QVariant TranscodeModel::data(const QModelIndex &index, int role) const
         {
             return record.targetPath;
         }
+        else if (index.column() == CpuTime && record.hasStats)
+        {
+            return QString::fromLocal8Bit("用户态 / 内核态，平均占用 %1 核").arg(record.stats.cpuCores(), 0, 'f', 2);
+        }
+        else if (index.column() == AverageFps && record.hasStats && record.stats.remux)
+        {
+            return QString::fromLocal8Bit("视频流直接复制");
+        }
         break;
 
     case Qt::TextAlignmentRole:
-        if (index.column() == Index || index.column() == Progress)
+        if (index.column() == Index || index.column() >= Progress)
         {
             return Qt::AlignCenter;
         }
@@ -167,18 +197,39 @@ QVariant TranscodeModel::headerData(int section, Qt::Orientation orientation, in
         return QString::fromLocal8Bit("目标路径");
     case Progress:
         return QString::fromLocal8Bit("进度");
+    case WallTime:
+        return QString::fromLocal8Bit("耗时");
+    case CpuTime:
+        return QString::fromLocal8Bit("CPU时间");
+    case PeakMemory:
+        return QString::fromLocal8Bit("峰值内存");
+    case FileSize:
+        return QString::fromLocal8Bit("大小");
+    case AverageFps:
+        return QString::fromLocal8Bit("平均帧率");
     }
 
     return QVariant();
 }
 
-void TranscodeModel::addRecord(const QString &fileName, const QString &sourcePath, const QString &targetPath)
+void TranscodeModel::addRecord(const QString &fileName, const QString &sourcePath, const QString &targetPath, const QString &rendition)
 {
     beginInsertRows(QModelIndex(), m_records.size(), m_records.size());
     m_records.append(TranscodeRecord(fileName, sourcePath, targetPath));
+    m_records.last().rendition = rendition;
     endInsertRows();
 }
 
+QString TranscodeModel::recordName(int row) const
+{
+    return (row >= 0 && row < m_records.size()) ? m_records.at(row).fileName : QString();
+}
+
+QString TranscodeModel::recordRendition(int row) const
+{
+    return (row >= 0 && row < m_records.size()) ? m_records.at(row).rendition : QString();
+}
+
 void TranscodeModel::updateRecordStatus(const QString &fileName, TranscodeStatus status, const QString &errorMessage)
 {
     int index = findRecordIndex(fileName);
@@ -196,12 +247,13 @@ void TranscodeModel::updateRecordStatus(const QString &fileName, TranscodeStatus
     }
 }
 
-void TranscodeModel::updateRecordProgress(const QString &fileName, int progress)
+void TranscodeModel::updateRecordProgress(const QString &fileName, int progress, double speed)
 {
     int index = findRecordIndex(fileName);
     if (index != -1)
     {
         m_records[index].progress = progress;
+        m_records[index].speed = speed;
         m_records[index].status = TranscodeStatus::Processing;
 
         QModelIndex progressIndex = createIndex(index, Progress);
@@ -210,6 +262,20 @@ void TranscodeModel::updateRecordProgress(const QString &fileName, int progress)
     }
 }
 
+void TranscodeModel::updateRecordStats(const QString &fileName, const JobStats &stats)
+{
+    int index = findRecordIndex(fileName);
+    if (index != -1)
+    {
+        m_records[index].stats = stats;
+        m_records[index].hasStats = true;
+
+        QModelIndex topLeft = createIndex(index, WallTime);
+        QModelIndex bottomRight = createIndex(index, AverageFps);
+        emit dataChanged(topLeft, bottomRight);
+    }
+}
+
 void TranscodeModel::clearRecords()
 {
     beginResetModel();
@@ -227,4 +293,31 @@ int TranscodeModel::findRecordIndex(const QString &fileName) const
         }
     }
     return -1;
+}
+
+QString TranscodeModel::formatDuration(qint64 ms)
+{
+    qint64 seconds = ms / 1000;
+    if (seconds >= 3600)
+    {
+        return QString("%1:%2:%3").arg(seconds / 3600).arg((seconds % 3600) / 60, 2, 10, QChar('0')).arg(seconds % 60, 2, 10, QChar('0'));
+    }
+    if (seconds >= 60)
+    {
+        return QString("%1:%2").arg(seconds / 60).arg(seconds % 60, 2, 10, QChar('0'));
+    }
+    return QString("%1s").arg(ms / 1000.0, 0, 'f', 1);
+}
+
+QString TranscodeModel::formatBytes(qint64 bytes)
+{
+    if (bytes >= 1024LL * 1024 * 1024)
+    {
+        return QString("%1 GB").arg(bytes / (1024.0 * 1024 * 1024), 0, 'f', 2);
+    }
+    if (bytes >= 1024 * 1024)
+    {
+        return QString("%1 MB").arg(bytes / (1024.0 * 1024), 0, 'f', 1);
+    }
+    return QString("%1 KB").arg(bytes / 1024.0, 0, 'f', 0);
 }
\ No newline at end of file
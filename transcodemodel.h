@@ -3,6 +3,7 @@
 
 #include <QAbstractTableModel>
 #include <QIcon>
+#include "transcodereport.h"
 
 enum class TranscodeStatus
 {
@@ -14,16 +15,20 @@ enum class TranscodeStatus
 
 struct TranscodeRecord
 {
-    QString fileName;
+    QString fileName;  // 主输出为源文件名，附加输出为 "文件名 [分辨率]"
     QString sourcePath;
     QString targetPath;
+    QString rendition; // 附加输出的分辨率，主输出为空
     TranscodeStatus status;
     QString errorMessage;
     int progress;
+    double speed;   // 编码倍速（相对实时）
+    JobStats stats; // 完成后的资源统计
+    bool hasStats;
 
     TranscodeRecord(const QString &file, const QString &source, const QString &target)
         : fileName(file), sourcePath(source), targetPath(target),
-          status(TranscodeStatus::Pending), progress(0) {}
+          status(TranscodeStatus::Pending), progress(0), speed(0.0), hasStats(false) {}
 };
 
 class TranscodeModel : public QAbstractTableModel
@@ -38,6 +43,11 @@ public:
         SourcePath,
         TargetPath,
         Progress,
+        WallTime,
+        CpuTime,
+        PeakMemory,
+        FileSize,
+        AverageFps,
         ColumnCount
     };
 
@@ -51,11 +61,16 @@ public:
     QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
 
     // 添加和更新记录
-    void addRecord(const QString &fileName, const QString &sourcePath, const QString &targetPath);
+    void addRecord(const QString &fileName, const QString &sourcePath, const QString &targetPath, const QString &rendition = QString());
     void updateRecordStatus(const QString &fileName, TranscodeStatus status, const QString &errorMessage = QString());
-    void updateRecordProgress(const QString &fileName, int progress);
+    void updateRecordProgress(const QString &fileName, int progress, double speed = 0.0);
+    void updateRecordStats(const QString &fileName, const JobStats &stats);
     void clearRecords();
 
+    // 记录的名称和附加输出分辨率（主输出为空）
+    QString recordName(int row) const;
+    QString recordRendition(int row) const;
+
 private:
     QList<TranscodeRecord> m_records;
     QIcon m_successIcon;
@@ -64,6 +79,8 @@ private:
     QIcon m_processingIcon;
 
     int findRecordIndex(const QString &fileName) const;
+    static QString formatDuration(qint64 ms);
+    static QString formatBytes(qint64 bytes);
 };
 
 #endif // TRANSCODEMODEL_H
\ No newline at end of file
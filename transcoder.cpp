@@ -15,6 +15,7 @@
 #include <QRegularExpression>
 #include <QHeaderView>
 #include <QDir>
+#include <QTimer>
 
 Transcoder::Transcoder(QWidget *parent)
     : QMainWindow(parent), ui(new Ui::Transcoder)
@@ -48,7 +49,12 @@ Transcoder::Transcoder(QWidget *parent)
     ui->tableView->setColumnWidth(1, 100); // 状态列
     ui->tableView->setColumnWidth(2, 450); // 源路径列 - 加宽
     ui->tableView->setColumnWidth(3, 450); // 目标路径列 - 加宽
-    ui->tableView->setColumnWidth(4, 60);  // 进度列 - 适中
+    ui->tableView->setColumnWidth(4, 110); // 进度列 - 包含倍速
+    ui->tableView->setColumnWidth(5, 80);  // 耗时列
+    ui->tableView->setColumnWidth(6, 120); // CPU时间列 - 用户态/内核态
+    ui->tableView->setColumnWidth(7, 90);  // 峰值内存列
+    ui->tableView->setColumnWidth(8, 160); // 大小列 - 输入/输出
+    ui->tableView->setColumnWidth(9, 80);  // 平均帧率列
 
     // 设置列的调整策略 - 允许手动调整
     ui->tableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
@@ -58,6 +64,7 @@ Transcoder::Transcoder(QWidget *parent)
 
     connect(ui->renameFileBtn, &QPushButton::clicked, this, &Transcoder::renameFile);
     connect(ui->videoInfoBtn, &QPushButton::clicked, this, &Transcoder::showVideoInfoDialog);
+    connect(ui->libraryInspectorBtn, &QPushButton::clicked, this, &Transcoder::showLibraryInspectorDialog);
     // 选择
     connect(ui->transcodeBtn, &QPushButton::clicked, this, &Transcoder::startTranscode);
     // 选择转码目录
@@ -77,6 +84,9 @@ Transcoder::Transcoder(QWidget *parent)
     QShortcut *darkThemeShortcut = new QShortcut(QKeySequence("Ctrl+2"), this);
     connect(modernThemeShortcut, &QShortcut::activated, this, &Transcoder::switchToModernTheme);
     connect(darkThemeShortcut, &QShortcut::activated, this, &Transcoder::switchToDarkTheme);
+
+    // 窗口显示后检查上次是否有中断的批次
+    QTimer::singleShot(0, this, &Transcoder::checkInterruptedBatch);
 }
 
 Transcoder::~Transcoder()
@@ -116,12 +126,15 @@ void Transcoder::startTranscode()
     // 在开始转码前再次更新已存在文件的状态
     updateExistingFilesStatus();
 
+    ConfigManager *config = ConfigManager::instance();
+    runTranscode(config->getTranscodeSettings());
+}
+
+void Transcoder::runTranscode(const TranscodeSettings &settings)
+{
     workerThread = new QThread(this);
     worker = new TranscodeTaskManager(this->selectedPaths);
     worker->setTargetDirectory(targetPath);
-
-    ConfigManager *config = ConfigManager::instance();
-    const TranscodeSettings &settings = config->getTranscodeSettings();
     worker->setTranscodeSettings(settings);
 
     worker->moveToThread(workerThread);
@@ -135,8 +148,11 @@ void Transcoder::startTranscode()
     connect(worker, &TranscodeTaskManager::progressUpdated, this, &Transcoder::updateProgress, Qt::QueuedConnection);
     connect(worker, &TranscodeTaskManager::finished, this, &Transcoder::onTranscodeFinished, Qt::QueuedConnection);
     connect(worker, &TranscodeTaskManager::currentFileChanged, this, &Transcoder::onCurrentFileChanged, Qt::QueuedConnection);
+    connect(worker, &TranscodeTaskManager::fileProgressUpdated, this, &Transcoder::onFileProgressUpdated, Qt::QueuedConnection);
     connect(worker, &TranscodeTaskManager::fileProcessed, this, &Transcoder::onFileProcessed, Qt::QueuedConnection);
+    connect(worker, &TranscodeTaskManager::fileStatsUpdated, this, &Transcoder::onFileStatsUpdated, Qt::QueuedConnection);
     connect(worker, &TranscodeTaskManager::errorOccurred, this, &Transcoder::onTranscodeError, Qt::QueuedConnection);
+    connect(worker, &TranscodeTaskManager::admissionPausedChanged, this, &Transcoder::onAdmissionPausedChanged, Qt::QueuedConnection);
 
     connect(workerThread, &QThread::started, worker, &TranscodeTaskManager::start);
     connect(worker, &TranscodeTaskManager::finished, workerThread, &QThread::quit);
@@ -150,6 +166,54 @@ void Transcoder::startTranscode()
     QMessageBox::information(this, QString::fromLocal8Bit("提示"), QString::fromLocal8Bit("转码任务已开始！\n输出目录: %1").arg(targetPath));
 }
 
+void Transcoder::checkInterruptedBatch()
+{
+    if (!ConfigManager::instance()->getSystemSettings().autoSaveProgress)
+    {
+        return;
+    }
+
+    // 另一个实例的批次仍在运行时，它的临时文件不是遗留文件
+    QString journalPath = TranscodeJournal::defaultPath();
+    if (TranscodeJournal::isLocked(journalPath))
+    {
+        return;
+    }
+
+    TranscodeJournal::Recovery recovery = TranscodeJournal::recover(journalPath);
+    if (recovery.isEmpty())
+    {
+        TranscodeJournal::remove(journalPath);
+        return;
+    }
+
+    QMessageBox::StandardButton reply = QMessageBox::question(
+        this, QString::fromLocal8Bit("恢复转码"),
+        QString::fromLocal8Bit("检测到上次中断的转码任务，还有 %1 个文件未完成。\n输出目录: %2\n是否继续转码？")
+            .arg(recovery.fileCount())
+            .arg(recovery.targetDirectory));
+
+    // 对话框期间另一个实例可能已开始新批次并截断日志
+    if (TranscodeJournal::isLocked(journalPath))
+    {
+        return;
+    }
+
+    // 无论是否继续，中断时留下的临时文件都已无用
+    TranscodeJournal::cleanOrphans(recovery);
+    if (reply != QMessageBox::Yes)
+    {
+        TranscodeJournal::remove(journalPath);
+        return;
+    }
+
+    // 按日志中记录的目录和转码设置继续未完成的文件，附加输出的行也按当时的设置生成
+    this->selectedPaths = recovery.files;
+    this->targetPath = recovery.targetDirectory;
+    loadFilesToTable(recovery.settings.renditions);
+    runTranscode(recovery.settings);
+}
+
 void Transcoder::stopTranscode()
 {
     if (worker && workerThread && workerThread->isRunning())
@@ -221,31 +285,7 @@ void Transcoder::selectTargetDir()
 
 QMap<QString, QStringList> Transcoder::validatePaths(const QStringList &paths)
 {
-    QMap<QString, QStringList> result;
-    for (const QString &path : paths)
-    {
-        QFileInfo info(path);
-
-        if (!info.isDir())
-        {
-            continue;
-        }
-
-        QDir dir(path);
-        QFileInfoList entries = dir.entryInfoList(QDir::Files | QDir::NoSymLinks | QDir::Readable, QDir::Name);
-        QStringList names;
-        for (const QFileInfo &entry : entries)
-        {
-            if (this->supportedExtensions.contains(entry.suffix().toLower()))
-                names.append(entry.fileName());
-        }
-        if (names.isEmpty())
-        {
-            continue;
-        }
-        result.insert(dir.absolutePath(), names);
-    }
-    return result;
+    return TranscodeTaskManager::collectVideoFiles(paths);
 }
 
 void Transcoder::updateProgress(int value)
@@ -260,6 +300,7 @@ void Transcoder::onTranscodeFinished()
     ui->transcodeBtn->disconnect();                                                      // 断开停止连接
     connect(ui->transcodeBtn, &QPushButton::clicked, this, &Transcoder::startTranscode); // 重新连接开始转码
     ui->progressLayout->hide();
+    ui->progressBar->setFormat("%p%");
 
     if (worker)
     {
@@ -276,6 +317,17 @@ void Transcoder::onCurrentFileChanged(const QString &fileName)
     transcodeModel->updateRecordStatus(fileName, TranscodeStatus::Processing);
 }
 
+void Transcoder::onFileProgressUpdated(const QString &fileName, int percent, double fps, double speed)
+{
+    Q_UNUSED(fps)
+    transcodeModel->updateRecordProgress(fileName, percent, speed);
+}
+
+void Transcoder::onFileStatsUpdated(const JobStats &stats)
+{
+    transcodeModel->updateRecordStats(stats.fileName, stats);
+}
+
 void Transcoder::onFileProcessed(const QString &fileName, bool success)
 {
     if (success)
@@ -296,6 +348,14 @@ void Transcoder::onTranscodeError(const QString &errorMessage)
     QMessageBox::warning(this, QString::fromLocal8Bit("转码错误"), errorMessage);
 }
 
+void Transcoder::onAdmissionPausedChanged(bool paused, const QString &reason)
+{
+    // 暂停只是等待空间释放，不弹窗打断，在进度条上提示
+    qDebug() << QString::fromLocal8Bit("磁盘空间准入:") << paused << reason;
+    ui->progressBar->setFormat(paused ? QString::fromLocal8Bit("%p% - 磁盘空间不足，等待空间释放后继续") : QString("%p%"));
+    ui->progressBar->setToolTip(reason);
+}
+
 void Transcoder::showSelectedDirsDialog()
 {
     auto *dialog = new SelectedDirsDialog(this);
@@ -331,6 +391,13 @@ void Transcoder::showVideoInfoDialog()
     dialog->deleteLater();
 }
 
+void Transcoder::showLibraryInspectorDialog()
+{
+    LibraryInspectorDialog *dialog = new LibraryInspectorDialog(this);
+    dialog->exec();
+    dialog->deleteLater();
+}
+
 void Transcoder::switchToModernTheme()
 {
     applyTheme(":/styles/modern.qss");
@@ -386,6 +453,11 @@ void Transcoder::onFilterStatusChanged()
 }
 
 void Transcoder::loadFilesToTable()
+{
+    loadFilesToTable(ConfigManager::instance()->getTranscodeSettings().renditions);
+}
+
+void Transcoder::loadFilesToTable(const QList<Rendition> &renditions)
 {
     if (selectedPaths.isEmpty())
     {
@@ -395,7 +467,7 @@ void Transcoder::loadFilesToTable()
     // 清空之前的记录
     transcodeModel->clearRecords();
 
-    // 添加所有文件到模型
+    // 添加所有文件到模型，每个附加输出单独一行
     for (auto it = selectedPaths.begin(); it != selectedPaths.end(); ++it)
     {
         const QString &dirPath = it.key();
@@ -409,6 +481,10 @@ void Transcoder::loadFilesToTable()
                 targetFilePath = QDir(targetPath).absoluteFilePath(file);
             }
             transcodeModel->addRecord(file, sourcePath, targetFilePath);
+            for (const Rendition &rendition : renditions)
+            {
+                transcodeModel->addRecord(TranscodeTaskManager::renditionKey(file, rendition), sourcePath, targetFilePath, rendition.resolution);
+            }
         }
     }
 
@@ -435,9 +511,10 @@ void Transcoder::updateExistingFilesStatus()
     {
         QString sourcePath = transcodeModel->data(transcodeModel->index(i, TranscodeModel::SourcePath), Qt::DisplayRole).toString();
 
-        // 从源路径中提取文件名
+        // 记录名：主输出为源文件名，附加输出带分辨率
         QFileInfo sourceFileInfo(sourcePath);
-        QString fileName = sourceFileInfo.fileName();
+        QString fileName = transcodeModel->recordName(i);
+        QString rendition = transcodeModel->recordRendition(i);
 
         qDebug() << QString::fromLocal8Bit("处理文件：") << fileName << QString::fromLocal8Bit("，源路径：") << sourcePath;
 
@@ -451,6 +528,12 @@ void Transcoder::updateExistingFilesStatus()
         QString baseName = sourceFileInfo.baseName();
         QString finalOutputName = baseName + ".mp4";
         QString finalOutputPath = QDir(dramaTargetDir).absoluteFilePath(finalOutputName);
+        if (!rendition.isEmpty())
+        {
+            Rendition spec;
+            spec.resolution = rendition;
+            finalOutputPath = TranscodeTaskManager::renditionOutputPath(finalOutputPath, spec);
+        }
 
         qDebug() << QString::fromLocal8Bit("最终输出路径：") << finalOutputPath;
 
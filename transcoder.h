@@ -13,6 +13,7 @@
 #include <QLabel>
 #include "transcodetaskmanager.h"
 #include "videoinfodialog.h"
+#include "libraryinspectordialog.h"
 #include "transcodemodel.h"
 
 QT_BEGIN_NAMESPACE
@@ -28,7 +29,7 @@ class Transcoder : public QMainWindow
     Q_OBJECT
 
 public:
-    const QStringList supportedExtensions = {"mp4", "mkv", "avi", "mov"};
+    const QStringList supportedExtensions = TranscodeTaskManager::supportedExtensions();
 
     Transcoder(QWidget *parent = nullptr);
     ~Transcoder();
@@ -42,21 +43,28 @@ public slots:
     void updateProgress(int value);
     void onTranscodeFinished();
     void onCurrentFileChanged(const QString &fileName);
+    void onFileProgressUpdated(const QString &fileName, int percent, double fps, double speed);
     void onFileProcessed(const QString &fileName, bool success);
+    void onFileStatsUpdated(const JobStats &stats);
     void onTranscodeError(const QString &errorMessage);
+    void onAdmissionPausedChanged(bool paused, const QString &reason);
     void switchToModernTheme();
     void switchToDarkTheme();
     void showSelectedDirsDialog();
     void showSettingsDialog();
     void showVideoInfoDialog();
+    void showLibraryInspectorDialog();
     void onFilterStatusChanged();
+    void checkInterruptedBatch(); // 启动时恢复中断的批次
 
 private:
     Ui::Transcoder *ui;
     QMap<QString, QStringList> validatePaths(const QStringList &paths);
     void applyTheme(const QString &themePath);
-    void loadFilesToTable();
+    void loadFilesToTable();                                   // 按当前配置的附加输出生成表格行
+    void loadFilesToTable(const QList<Rendition> &renditions); // 按指定的附加输出生成表格行
     void updateExistingFilesStatus();
+    void runTranscode(const TranscodeSettings &settings);
 
     TranscodeTaskManager *worker;
     QThread *workerThread;
@@ -8,30 +8,31 @@ CONFIG += c++17
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# 转码核心（不依赖界面），与 bench/transcoder-bench.pro 共用
+include(transcoder_core.pri)
+
 SOURCES += \
-    configmanager.cpp \
+    headlessrunner.cpp \
+    libraryinspectordialog.cpp \
+    libraryinspectormodel.cpp \
     main.cpp \
     renamedialog.cpp \
     selecteddirsdialog.cpp \
     settingdialog.cpp \
     transcoder.cpp \
-    transcodetask.cpp \
-    transcodetaskmanager.cpp \
     transcodemodel.cpp \
-    utils/ffmpegutils.cpp \
     utils/httpclient.cpp \
     videoinfodialog.cpp
 
 HEADERS += \
-    configmanager.h \
+    headlessrunner.h \
+    libraryinspectordialog.h \
+    libraryinspectormodel.h \
     renamedialog.h \
     selecteddirsdialog.h \
     settingdialog.h \
     transcoder.h \
-    transcodetask.h \
-    transcodetaskmanager.h \
     transcodemodel.h \
-    utils/ffmpegutils.h \
     utils/httpclient.h \
     videoinfodialog.h
 
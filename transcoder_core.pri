@@ -0,0 +1,58 @@
+# 转码核心源文件，由 transcoder.pro 和 bench/transcoder-bench.pro 包含
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/calibration.cpp \
+    $$PWD/chunkedtranscodejob.cpp \
+    $$PWD/configmanager.cpp \
+    $$PWD/probecache.cpp \
+    $$PWD/transcodeexecutor.cpp \
+    $$PWD/transcodejournal.cpp \
+    $$PWD/transcodemetrics.cpp \
+    $$PWD/transcodereport.cpp \
+    $$PWD/transcodetask.cpp \
+    $$PWD/transcodetaskmanager.cpp \
+    $$PWD/utils/concurrencycontroller.cpp \
+    $$PWD/utils/containerprobe.cpp \
+    $$PWD/utils/cpuscheduler.cpp \
+    $$PWD/utils/deviceiolimiter.cpp \
+    $$PWD/utils/diskspaceguard.cpp \
+    $$PWD/utils/ffmpegutils.cpp \
+    $$PWD/utils/libavengine.cpp \
+    $$PWD/utils/metricsserver.cpp \
+    $$PWD/utils/processstats.cpp \
+    $$PWD/utils/scratchstaging.cpp \
+    $$PWD/watchfolderservice.cpp
+
+HEADERS += \
+    $$PWD/calibration.h \
+    $$PWD/chunkedtranscodejob.h \
+    $$PWD/configmanager.h \
+    $$PWD/probecache.h \
+    $$PWD/transcodeexecutor.h \
+    $$PWD/transcodejournal.h \
+    $$PWD/transcodemetrics.h \
+    $$PWD/transcodereport.h \
+    $$PWD/transcodetask.h \
+    $$PWD/transcodetaskmanager.h \
+    $$PWD/utils/concurrencycontroller.h \
+    $$PWD/utils/containerprobe.h \
+    $$PWD/utils/cpuscheduler.h \
+    $$PWD/utils/deviceiolimiter.h \
+    $$PWD/utils/diskspaceguard.h \
+    $$PWD/utils/ffmpegutils.h \
+    $$PWD/utils/libavengine.h \
+    $$PWD/utils/metricsserver.h \
+    $$PWD/utils/processstats.h \
+    $$PWD/utils/scratchstaging.h \
+    $$PWD/watchfolderservice.h
+
+# 读取子进程峰值内存（GetProcessMemoryInfo）
+win32: LIBS += -lpsapi
+
+# 进程内转码引擎：qmake CONFIG+=libav（需要FFmpeg 5.1及以上的开发包）
+libav {
+    DEFINES += TRANSCODER_WITH_LIBAV
+    CONFIG += link_pkgconfig
+    PKGCONFIG += libavformat libavcodec libavutil libswscale libswresample
+}
@@ -0,0 +1,136 @@
+﻿#include "transcodereport.h"
+#include <QDebug>
+#include <QDateTime>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+void TranscodeReport::add(const JobStats &stats)
+{
+    m_jobs.append(stats);
+}
+
+void TranscodeReport::clear()
+{
+    m_jobs.clear();
+}
+
+bool TranscodeReport::write(const QString &basePath) const
+{
+    bool jsonOk = writeJson(basePath + ".json");
+    bool csvOk = writeCsv(basePath + ".csv");
+    return jsonOk && csvOk;
+}
+
+bool TranscodeReport::writeJson(const QString &path) const
+{
+    QJsonArray jobs;
+    qint64 totalWallMs = 0;
+    qint64 totalCpuMs = 0;
+    qint64 totalInput = 0;
+    qint64 totalOutput = 0;
+    int succeeded = 0;
+
+    for (const JobStats &stats : m_jobs)
+    {
+        QJsonObject job;
+        job["file"] = stats.fileName;
+        job["input"] = stats.inputPath;
+        job["output"] = stats.outputPath;
+        job["success"] = stats.success;
+        job["remux"] = stats.remux;
+        job["wallMs"] = stats.wallMs;
+        job["userMs"] = stats.userMs;
+        job["systemMs"] = stats.systemMs;
+        job["peakRssKb"] = stats.peakRssKb;
+        job["inputBytes"] = stats.inputBytes;
+        job["outputBytes"] = stats.outputBytes;
+        job["frames"] = stats.frames;
+        job["fps"] = stats.fps();
+        job["cpuCores"] = stats.cpuCores();
+        jobs.append(job);
+
+        totalWallMs += stats.wallMs;
+        totalCpuMs += stats.userMs + stats.systemMs;
+        totalInput += stats.inputBytes;
+        totalOutput += stats.outputBytes;
+        if (stats.success)
+        {
+            succeeded++;
+        }
+    }
+
+    QJsonObject summary;
+    summary["jobs"] = m_jobs.size();
+    summary["succeeded"] = succeeded;
+    summary["failed"] = m_jobs.size() - succeeded;
+    summary["jobWallMs"] = totalWallMs;
+    summary["cpuMs"] = totalCpuMs;
+    summary["inputBytes"] = totalInput;
+    summary["outputBytes"] = totalOutput;
+
+    QJsonObject root;
+    root["generated"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    root["summary"] = summary;
+    root["jobs"] = jobs;
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qDebug() << QString::fromLocal8Bit("无法写入报告:") << path << file.errorString();
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson());
+    file.close();
+    return true;
+}
+
+bool TranscodeReport::writeCsv(const QString &path) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+    {
+        qDebug() << QString::fromLocal8Bit("无法写入报告:") << path << file.errorString();
+        return false;
+    }
+
+    QTextStream out(&file);
+    out.setCodec("UTF-8");
+    out.setGenerateByteOrderMark(true); // 便于Excel识别中文文件名
+
+    out << "file,input,output,success,remux,wall_ms,user_ms,system_ms,peak_rss_kb,input_bytes,output_bytes,frames,fps,cpu_cores\n";
+    for (const JobStats &stats : m_jobs)
+    {
+        out << csvField(stats.fileName) << ','
+            << csvField(stats.inputPath) << ','
+            << csvField(stats.outputPath) << ','
+            << (stats.success ? 1 : 0) << ','
+            << (stats.remux ? 1 : 0) << ','
+            << stats.wallMs << ','
+            << stats.userMs << ','
+            << stats.systemMs << ','
+            << stats.peakRssKb << ','
+            << stats.inputBytes << ','
+            << stats.outputBytes << ','
+            << stats.frames << ','
+            << QString::number(stats.fps(), 'f', 2) << ','
+            << QString::number(stats.cpuCores(), 'f', 2) << '\n';
+    }
+
+    file.close();
+    return true;
+}
+
+QString TranscodeReport::csvField(const QString &value)
+{
+    if (!value.contains(',') && !value.contains('"') && !value.contains('\n'))
+    {
+        return value;
+    }
+
+    QString escaped = value;
+    escaped.replace("\"", "\"\"");
+    return "\"" + escaped + "\"";
+}
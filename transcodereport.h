@@ -0,0 +1,60 @@
+﻿#ifndef TRANSCODEREPORT_H
+#define TRANSCODEREPORT_H
+
+#include <QString>
+#include <QList>
+#include <QMetaType>
+
+/**
+ * 单个文件的资源统计
+ */
+struct JobStats
+{
+    QString fileName;
+    QString inputPath;
+    QString outputPath;
+    bool success = false;
+    qint64 wallMs = 0;      // 墙钟时间
+    qint64 userMs = 0;      // 子进程用户态CPU时间
+    qint64 systemMs = 0;    // 子进程内核态CPU时间
+    qint64 peakRssKb = 0;   // 子进程峰值常驻内存（分段转码时取各段最大值）
+    qint64 inputBytes = 0;  // 源文件大小
+    qint64 outputBytes = 0; // 输出文件大小
+    qint64 frames = 0;      // 编码帧数
+    bool remux = false;     // 是否为直接复制流
+
+    // 平均编码帧率（帧数 / 墙钟时间）
+    double fps() const { return wallMs > 0 ? frames * 1000.0 / wallMs : 0.0; }
+
+    // CPU时间 / 墙钟时间，即平均占用的核心数
+    double cpuCores() const { return wallMs > 0 ? double(userMs + systemMs) / wallMs : 0.0; }
+};
+
+Q_DECLARE_METATYPE(JobStats)
+
+/**
+ * 批次性能报告
+ * 汇总每个文件的JobStats，批次结束后写出JSON和CSV，用于分析编码耗时分布和调整预设
+ */
+class TranscodeReport
+{
+public:
+    void add(const JobStats &stats);
+    void clear();
+    bool isEmpty() const { return m_jobs.isEmpty(); }
+    const QList<JobStats> &jobs() const { return m_jobs; }
+
+    // 写出 <basePath>.json 和 <basePath>.csv
+    bool write(const QString &basePath) const;
+
+    bool writeJson(const QString &path) const;
+    bool writeCsv(const QString &path) const;
+
+    // 按CSV规则转义字段（含逗号、引号或换行时加引号）
+    static QString csvField(const QString &value);
+
+private:
+    QList<JobStats> m_jobs;
+};
+
+#endif // TRANSCODEREPORT_H
@@ -1,62 +1,363 @@
 ﻿#include "transcodetask.h"
 #include "transcodetaskmanager.h"
+#include "chunkedtranscodejob.h"
+#include "probecache.h"
 #include "utils/ffmpegutils.h"
+#include "utils/libavengine.h"
+#include "utils/scratchstaging.h"
 #include <QDebug>
 #include <QProcess>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
 
 TranscodeTask::TranscodeTask(const QString &inputPath, const QString &outputPath,
                              const QString &fileName, const TranscodeSettings &settings,
                              TranscodeTaskManager *manager)
-    : m_inputPath(inputPath), m_outputPath(outputPath), m_fileName(fileName), m_settings(settings), m_manager(manager)
+    : m_inputPath(inputPath), m_sourcePath(inputPath), m_outputPath(outputPath), m_fileName(fileName),
+      m_settings(settings), m_manager(manager)
 {
     setAutoDelete(true); // 任务完成后自动删除
 }
 
+void TranscodeTask::setChunk(const QSharedPointer<ChunkedTranscodeJob> &job, int index)
+{
+    m_chunkJob = job;
+    m_chunkIndex = index;
+}
+
 void TranscodeTask::run()
 {
-    qDebug() << QString::fromLocal8Bit("开始转码: %1").arg(m_fileName);
+    // 管理器已停止时不再启动新的ffmpeg
+    if (isCancelled())
+    {
+        return;
+    }
+
+    qDebug() << QString::fromLocal8Bit("开始转码: %1").arg(m_chunkJob ? QString("%1 #%2").arg(m_fileName).arg(m_chunkIndex) : m_fileName);
+
+    // 通知管理器任务开始（分段任务由分段作业统一通知）
+    if (m_manager && !m_chunkJob)
+    {
+        m_manager->onTaskStarted(m_fileName, m_sourcePath);
+    }
+
+    // 源时长用于将ffmpeg输出的时间换算成百分比，分段进度由分段作业按总时长换算
+    if (!m_mediaInfo.isValid() && !m_chunkJob)
+    {
+        m_mediaInfo = ProbeCache::instance()->mediaInfo(m_inputPath);
+    }
+    double durationSec = m_mediaInfo.durationSec;
+
+    QElapsedTimer wallTimer;
+    wallTimer.start();
+
+    // 暂存模式：源文件复制到本地，编码输出也写在本地，成功后一次顺序复制回目标目录
+    // 分段任务的分段本身已在分段作业的工作目录中
+    QString inputPath = m_inputPath;
+    QString outputPath = m_outputPath;
+    ScratchStaging staging(m_chunkJob ? QString() : m_scratchDirectory);
+    auto cancelled = [this]()
+    { return isCancelled(); };
+    if (staging.isEnabled())
+    {
+        if (staging.stageInput(inputPath, cancelled))
+        {
+            m_inputPath = staging.localInput();
+            m_outputPath = staging.localOutput(outputPath);
+        }
+        else if (!isCancelled())
+        {
+            qDebug() << QString::fromLocal8Bit("暂存失败，直接读写原路径: %1 (%2)").arg(m_fileName, staging.errorString());
+        }
+    }
+
+    // 进程内引擎不支持的源文件（如带旋转）仍交给ffmpeg进程
+    bool success = false;
+    bool fallback = true;
+    if (m_settings.engine == "libav" && LibavEngine::isAvailable() && m_settings.renditions.isEmpty())
+    {
+        success = runInProcess(durationSec, fallback);
+    }
+    if (fallback && !isCancelled())
+    {
+        success = runProcess(durationSec);
+    }
+
+    if (m_outputPath != outputPath)
+    {
+        QStringList localOutputs = {m_outputPath};
+        QStringList targetOutputs = {outputPath};
+        for (const Rendition &rendition : m_settings.renditions)
+        {
+            localOutputs << TranscodeTaskManager::renditionOutputPath(m_outputPath, rendition);
+            targetOutputs << TranscodeTaskManager::renditionOutputPath(outputPath, rendition);
+        }
+        m_inputPath = inputPath;
+        m_outputPath = outputPath;
 
-    // 通知管理器任务开始
-    if (m_manager)
+        // 复制到目标目录的 _temp 文件，由管理器照常重命名
+        for (int i = 0; i < localOutputs.size(); ++i)
+        {
+            if (success)
+            {
+                success = staging.publish(localOutputs[i], targetOutputs[i], cancelled);
+                if (!success)
+                {
+                    qDebug() << staging.errorString();
+                }
+            }
+            else
+            {
+                QFile::remove(localOutputs[i]);
+            }
+        }
+    }
+
+    qDebug() << QString::fromLocal8Bit("转码%1: %2").arg(success ? QString::fromLocal8Bit("成功") : QString::fromLocal8Bit("失败")).arg(m_fileName);
+
+    JobStats stats;
+    stats.fileName = m_fileName;
+    stats.inputPath = m_inputPath;
+    stats.outputPath = m_outputPath;
+    stats.success = success;
+    stats.wallMs = wallTimer.elapsed();
+    stats.userMs = m_usage.userMs;
+    stats.systemMs = m_usage.systemMs;
+    stats.peakRssKb = m_usage.peakRssKb;
+    stats.inputBytes = QFileInfo(m_inputPath).size();
+    stats.outputBytes = success ? QFileInfo(m_outputPath).size() : 0;
+    stats.frames = m_frames;
+    stats.remux = m_remux;
+
+    // 调用管理器的回调函数
+    if (m_chunkJob)
     {
-        m_manager->onTaskStarted(m_fileName);
+        m_chunkJob->onSegmentFinished(m_chunkIndex, success, stats);
     }
+    else if (m_manager)
+    {
+        m_manager->onTaskCompleted(m_fileName, success, m_outputPath, stats);
+    }
+}
 
+bool TranscodeTask::runProcess(double durationSec)
+{
     QString command = buildFFmpegCommand(m_inputPath, m_outputPath);
     QProcess process;
 
     process.start(command);
-    bool success = process.waitForFinished(-1) &&
-                   process.exitCode() == 0 &&
-                   process.exitStatus() == QProcess::NormalExit;
+    return process.waitForStarted() && runWithProgress(process, durationSec) &&
+           process.exitCode() == 0 &&
+           process.exitStatus() == QProcess::NormalExit;
+}
 
-    qDebug() << QString::fromLocal8Bit("转码%1: %2").arg(success ? QString::fromLocal8Bit("成功") : QString::fromLocal8Bit("失败")).arg(m_fileName);
+bool TranscodeTask::runInProcess(double durationSec, bool &fallback)
+{
+    // 每个工作线程一个引擎，缩放/重采样上下文和帧缓冲在该线程的任务之间复用
+    static thread_local LibavEngine engine;
 
-    // 调用管理器的回调函数
-    if (m_manager)
+    FFmpegUtils::TranscodeParams params = buildParams();
+    QElapsedTimer sinceReport;
+    sinceReport.start();
+
+    // 编码在本进程内进行，CPU时间和内存无法按任务区分，统计中只记录墙钟时间和帧数
+    bool success = engine.transcode(
+        m_inputPath, m_outputPath, params,
+        [this, durationSec, &sinceReport](const FFmpegUtils::ProgressInfo &info)
+        { reportProgress(info, durationSec, sinceReport); },
+        [this]()
+        { return isCancelled(); });
+
+    m_frames = engine.framesEncoded();
+    fallback = !success && engine.needsFallback();
+    if (fallback)
+    {
+        qDebug() << QString::fromLocal8Bit("进程内转码不支持，改用ffmpeg进程: %1 (%2)").arg(m_fileName, engine.errorString());
+    }
+    return success;
+}
+
+bool TranscodeTask::runWithProgress(QProcess &process, double durationSec)
+{
+    FFmpegUtils::ProgressInfo info;
+    QByteArray pending;
+    QElapsedTimer sinceReport;
+    sinceReport.start();
+    ProcessStats::Tracker tracker(process.processId());
+
+    while (process.state() != QProcess::NotRunning)
+    {
+        if (isCancelled())
+        {
+            terminateProcess(process);
+            m_usage = tracker.finish();
+            return false;
+        }
+
+        process.waitForReadyRead(ProgressPollMs);
+        pending += process.readAllStandardOutput();
+        tracker.poll();
+
+        int newline;
+        while ((newline = pending.indexOf('\n')) != -1)
+        {
+            QString line = QString::fromUtf8(pending.left(newline));
+            pending.remove(0, newline + 1);
+
+            if (FFmpegUtils::parseProgressLine(line, info))
+            {
+                // progress=end 时编码和文件尾都已写完，进程退出前补一次采样，不丢失最后一个轮询间隔的CPU时间
+                if (info.finished)
+                {
+                    tracker.poll();
+                }
+                reportProgress(info, durationSec, sinceReport);
+            }
+        }
+    }
+
+    m_usage = tracker.finish();
+    return process.exitStatus() == QProcess::NormalExit;
+}
+
+void TranscodeTask::reportProgress(const FFmpegUtils::ProgressInfo &info, double durationSec, QElapsedTimer &sinceReport)
+{
+    m_frames = qMax(m_frames, info.frame);
+
+    // 分段任务把进度交给分段作业汇总节流
+    if (m_chunkJob)
+    {
+        m_chunkJob->onSegmentProgress(m_chunkIndex, m_frames, info.outTimeUs, info.fps, info.speed);
+        return;
+    }
+
+    // 一个进度块结束，按时间节流后上报
+    int percent = 0;
+    if (durationSec > 0)
+    {
+        percent = qBound(0, static_cast<int>(info.outTimeUs / (durationSec * 10000.0)), 99);
+    }
+
+    // 即使百分比不变也定期上报，便于发现停滞的编码
+    if (m_manager && (sinceReport.elapsed() >= ProgressReportIntervalMs || info.finished))
+    {
+        m_manager->onTaskProgress(m_fileName, m_sourcePath, percent, info.fps, info.speed, m_frames);
+        sinceReport.restart();
+    }
+}
+
+void TranscodeTask::terminateProcess(QProcess &process)
+{
+    qDebug() << QString::fromLocal8Bit("终止转码: %1").arg(m_fileName);
+
+    FFmpegUtils::stopProcess(process, GracefulStopMs, TerminateWaitMs);
+
+    // 删除未完成的临时输出（包括多码率的附加输出）
+    QStringList outputs = {m_outputPath};
+    if (!m_chunkJob)
+    {
+        for (const Rendition &rendition : m_settings.renditions)
+        {
+            outputs << TranscodeTaskManager::renditionOutputPath(m_outputPath, rendition);
+        }
+    }
+    for (const QString &output : outputs)
     {
-        m_manager->onTaskCompleted(m_fileName, success, m_outputPath);
+        if (QFile::exists(output) && !QFile::remove(output))
+        {
+            qDebug() << QString::fromLocal8Bit("删除临时文件失败:") << output;
+        }
     }
 }
 
+bool TranscodeTask::isCancelled() const
+{
+    return m_manager && m_manager->isStopped();
+}
+
+FFmpegUtils::TranscodeParams TranscodeTask::buildParams()
+{
+    FFmpegUtils::TranscodeParams params = paramsFromSettings(m_settings);
+    params.progressOutput = true;
+    params.threads = m_threads;
+
+    // 按源文件限制分辨率和帧率，不为放大和补帧花编码时间
+    FFmpegUtils::capToSource(params, m_mediaInfo, m_settings.noUpscale, m_settings.noFrameRateIncrease);
+
+    // 分段只编码视频，音频和faststart在拼接时处理
+    if (m_chunkJob)
+    {
+        params.audioEnabled = false;
+        params.fastStart = false;
+    }
+    else if (m_settings.streamCopy && m_mediaInfo.isValid() && m_settings.renditions.isEmpty())
+    {
+        // 源流已符合目标参数时直接复制，只做重新封装
+        FFmpegUtils::StreamCompliance compliance = FFmpegUtils::checkCompliance(m_mediaInfo, params);
+        params.copyVideo = compliance.video;
+        params.copyAudio = compliance.audio;
+        m_remux = compliance.video;
+        if (compliance.video || compliance.audio)
+        {
+            qDebug() << QString::fromLocal8Bit("流复制: %1 视频=%2 音频=%3").arg(m_fileName).arg(compliance.video).arg(compliance.audio);
+        }
+    }
+
+    return params;
+}
+
 QString TranscodeTask::buildFFmpegCommand(const QString &inputPath, const QString &outputPath)
+{
+    FFmpegUtils::TranscodeParams params = buildParams();
+    if (m_chunkJob || m_settings.renditions.isEmpty())
+    {
+        return FFmpegUtils::buildTranscodeCommand(inputPath, outputPath, params);
+    }
+
+    // 多码率：主输出和各附加输出共用一次解码
+    QList<FFmpegUtils::RenditionOutput> outputs;
+    FFmpegUtils::RenditionOutput primary;
+    primary.path = outputPath;
+    primary.size = params.customResolution;
+    outputs << primary;
+
+    for (const Rendition &rendition : m_settings.renditions)
+    {
+        FFmpegUtils::RenditionOutput output;
+        output.path = TranscodeTaskManager::renditionOutputPath(outputPath, rendition);
+        output.size = TranscodeTaskManager::parseResolution(rendition.resolution);
+        if (m_settings.noUpscale && m_mediaInfo.width > 0 && m_mediaInfo.height > 0)
+        {
+            output.size = FFmpegUtils::capResolution(QSize(m_mediaInfo.width, m_mediaInfo.height), output.size, params.scaleMode);
+        }
+        output.crf = rendition.crf;
+        output.maxBitrateKbps = rendition.maxBitrateKbps;
+        outputs << output;
+    }
+    return FFmpegUtils::buildRenditionCommand(inputPath, outputs, params);
+}
+
+FFmpegUtils::TranscodeParams TranscodeTask::paramsFromSettings(const TranscodeSettings &settings)
 {
     FFmpegUtils::TranscodeParams params;
 
-    params.crf = m_settings.crf;
-    params.frameRate = m_settings.framerate;
-    params.colorSpace = m_settings.colorspace;
-    params.pixelFormat = m_settings.pixelFormat;
-    params.profile = m_settings.profile;
-    params.fastStart = m_settings.faststart;
+    params.crf = settings.crf;
+    params.frameRate = settings.framerate;
+    params.colorSpace = settings.colorspace;
+    params.pixelFormat = settings.pixelFormat;
+    params.profile = settings.profile;
+    params.fastStart = settings.faststart;
     params.audioBitrate = 128;
+    params.scaleMode = FFmpegUtils::scaleModeFromString(settings.scaleMode);
+    params.scaler = FFmpegUtils::scaleAlgorithmFromString(settings.scaleAlgorithm);
 
     // 设置编码器
-    if (m_settings.codec == "libx264")
+    if (settings.codec == "libx264")
     {
         params.videoCodec = FFmpegUtils::H264;
     }
-    else if (m_settings.codec == "libx265")
+    else if (settings.codec == "libx265")
     {
         params.videoCodec = FFmpegUtils::H265;
     }
@@ -66,7 +367,7 @@ QString TranscodeTask::buildFFmpegCommand(const QString &inputPath, const QStrin
     }
 
     // 解析分辨率
-    QStringList resParts = m_settings.resolution.split('x');
+    QStringList resParts = settings.resolution.split('x');
     if (resParts.size() == 2)
     {
         int width = resParts[0].toInt();
@@ -81,39 +382,39 @@ QString TranscodeTask::buildFFmpegCommand(const QString &inputPath, const QStrin
     }
 
     // 设置预设
-    if (m_settings.preset == "ultrafast")
+    if (settings.preset == "ultrafast")
     {
         params.preset = FFmpegUtils::ULTRA_FAST;
     }
-    else if (m_settings.preset == "superfast")
+    else if (settings.preset == "superfast")
     {
         params.preset = FFmpegUtils::SUPER_FAST;
     }
-    else if (m_settings.preset == "veryfast")
+    else if (settings.preset == "veryfast")
     {
         params.preset = FFmpegUtils::VERY_FAST;
     }
-    else if (m_settings.preset == "faster")
+    else if (settings.preset == "faster")
     {
         params.preset = FFmpegUtils::FASTER;
     }
-    else if (m_settings.preset == "fast")
+    else if (settings.preset == "fast")
     {
         params.preset = FFmpegUtils::FAST;
     }
-    else if (m_settings.preset == "medium")
+    else if (settings.preset == "medium")
     {
         params.preset = FFmpegUtils::MEDIUM;
     }
-    else if (m_settings.preset == "slow")
+    else if (settings.preset == "slow")
     {
         params.preset = FFmpegUtils::SLOW;
     }
-    else if (m_settings.preset == "slower")
+    else if (settings.preset == "slower")
     {
         params.preset = FFmpegUtils::SLOWER;
     }
-    else if (m_settings.preset == "veryslow")
+    else if (settings.preset == "veryslow")
     {
         params.preset = FFmpegUtils::VERY_SLOW;
     }
@@ -122,5 +423,5 @@ QString TranscodeTask::buildFFmpegCommand(const QString &inputPath, const QStrin
         params.preset = FFmpegUtils::MEDIUM;
     }
 
-    return FFmpegUtils::buildTranscodeCommand(inputPath, outputPath, params);
+    return params;
 }
@@ -4,10 +4,15 @@
 #include <QRunnable>
 #include <QString>
 #include <QProcess>
+#include <QElapsedTimer>
+#include <QSharedPointer>
 #include <configmanager.h>
+#include "utils/ffmpegutils.h"
+#include "utils/processstats.h"
 
 // 前置声明
 class TranscodeTaskManager;
+class ChunkedTranscodeJob;
 
 /**
  * 单个转码任务类
@@ -22,13 +27,61 @@ public:
 
     void run() override;
 
+    // 由调度器分配的编码线程数（0=不限制）
+    void setThreadCount(int threads) { m_threads = threads; }
+
+    // 管理器预先探测的媒体信息，避免重复调用ffprobe
+    void setMediaInfo(const FFmpegUtils::MediaInfo &info) { m_mediaInfo = info; }
+
+    // 在本地暂存目录中读写，完成后把输出复制到目标路径（空=直接读写原路径）
+    void setScratchDirectory(const QString &directory) { m_scratchDirectory = directory; }
+
+    // 作为分段转码的第index段运行：只编码视频，进度和结果交给分段作业汇总
+    void setChunk(const QSharedPointer<ChunkedTranscodeJob> &job, int index);
+
+    // 把界面上的转码设置映射为ffmpeg参数
+    static FFmpegUtils::TranscodeParams paramsFromSettings(const TranscodeSettings &settings);
+
 private:
     QString m_inputPath;
+    QString m_sourcePath; // 源文件原路径，暂存时m_inputPath临时指向本地副本，进度仍按原路径上报
     QString m_outputPath;
     QString m_fileName;
     TranscodeSettings m_settings;
     TranscodeTaskManager *m_manager;
+    int m_threads = 0;
+    FFmpegUtils::MediaInfo m_mediaInfo;
+    QSharedPointer<ChunkedTranscodeJob> m_chunkJob;
+    int m_chunkIndex = -1;
+    QString m_scratchDirectory;
+
+    // 资源统计，随进度轮询更新，进程退出后取最终值
+    ProcessStats::Usage m_usage;
+    qint64 m_frames = 0;
+    bool m_remux = false;
+
+    static const int ProgressPollMs = 500;            // 读取进度输出的轮询间隔
+    static const int ProgressReportIntervalMs = 1000; // 进度上报的最小间隔
+
+    static const int GracefulStopMs = 2000;  // 发送q后等待ffmpeg自行退出的时间
+    static const int TerminateWaitMs = 2000; // terminate/kill后等待进程退出的时间
+
+    // 启动ffmpeg进程转码
+    bool runProcess(double durationSec);
+
+    // 使用进程内引擎转码，引擎不支持该源文件时 fallback 置为true
+    bool runInProcess(double durationSec, bool &fallback);
+
+    // 读取ffmpeg的进度输出直到进程结束，并节流上报给管理器
+    bool runWithProgress(QProcess &process, double durationSec);
+
+    // 上报一个进度块，分段任务交给分段作业汇总
+    void reportProgress(const FFmpegUtils::ProgressInfo &info, double durationSec, QElapsedTimer &sinceReport);
 
+    // 依次尝试 q、SIGTERM、SIGKILL 结束ffmpeg，并删除未完成的输出
+    void terminateProcess(QProcess &process);
+    bool isCancelled() const;
+    FFmpegUtils::TranscodeParams buildParams();
     QString buildFFmpegCommand(const QString &inputPath, const QString &outputPath);
 };
 
@@ -1,31 +1,38 @@
 ﻿#include "transcodetaskmanager.h"
 #include "transcodetask.h"
+#include "chunkedtranscodejob.h"
+#include "calibration.h"
+#include "probecache.h"
+#include "utils/cpuscheduler.h"
+#include "utils/metricsserver.h"
+#include "utils/scratchstaging.h"
 #include <QDebug>
+#include <QDateTime>
 #include <QDir>
 #include <QFileInfo>
 #include <QStandardPaths>
 #include <QThread>
-#include <QThreadPool>
+#include <algorithm>
 
 TranscodeTaskManager::TranscodeTaskManager(const QMap<QString, QStringList> &files, QObject *parent)
     : QObject(parent), m_filesToTranscode(files)
 {
     m_targetDirectory = QStandardPaths::writableLocation(QStandardPaths::DesktopLocation) + "/TranscodeOutput";
+    m_journalPath = TranscodeJournal::defaultPath();
 
-    m_threadPool = QThreadPool::globalInstance();
+    qRegisterMetaType<JobStats>("JobStats");
 
     m_totalFiles = 0;
     m_completedFiles = 0;
     m_failedFiles = 0;
     m_stopped = 0;
+    m_threadsPerJob = 0;
 }
 
 TranscodeTaskManager::~TranscodeTaskManager()
 {
-    if (m_threadPool)
-    {
-        m_threadPool->waitForDone();
-    }
+    // 执行器析构时等待运行中的任务结束
+    m_executor.waitForDone();
 }
 
 void TranscodeTaskManager::setTargetDirectory(const QString &targetDir)
@@ -62,82 +69,650 @@ void TranscodeTaskManager::start()
         return;
     }
 
-    // 设置线程池大小
+    // 报告写在输出目录下，每个批次一份
+    m_reportBasePath = QDir(m_targetDirectory).absoluteFilePath(
+        "transcode_report_" + QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss"));
+
+    // 按CPU预算决定并发任务数和每任务线程数
     ConfigManager *config = ConfigManager::instance();
     SystemSettings systemSettings = config->getSystemSettings();
-    int maxConcurrent = systemSettings.threadCount;
-    if (maxConcurrent == 0)
+    CpuScheduler::Plan plan = CpuScheduler::plan(CpuScheduler::availableCores(),
+                                                 systemSettings.threadCount,
+                                                 systemSettings.threadsPerJob,
+                                                 CpuScheduler::policyFromString(systemSettings.schedulingPolicy));
+    // 设定了吞吐目标且本机已标定时，由成本模型决定预设和并发数
+    if (systemSettings.throughputTargetMinutes > 0)
     {
-        maxConcurrent = qMax(1, QThread::idealThreadCount() - 1);
+        Calibration::Choice choice = Calibration::choose(systemSettings.calibration, m_settings, systemSettings.threadsPerJob,
+                                                         systemSettings.throughputTargetMinutes,
+                                                         systemSettings.throughputMode);
+        if (choice.valid)
+        {
+            m_settings.preset = choice.preset;
+            plan = CpuScheduler::plan(CpuScheduler::availableCores(), choice.jobs, systemSettings.threadsPerJob,
+                                      CpuScheduler::policyFromString(systemSettings.schedulingPolicy));
+            qDebug() << QString::fromLocal8Bit("按吞吐目标 %1 分钟/小时选择: %2 × %3 个任务（%4x，%5）")
+                            .arg(systemSettings.throughputTargetMinutes)
+                            .arg(choice.preset)
+                            .arg(choice.jobs)
+                            .arg(choice.realtimeFactor, 0, 'f', 2)
+                            .arg(choice.achievable ? QString::fromLocal8Bit("可达到") : QString::fromLocal8Bit("无法达到，使用最快配置"));
+        }
+        else
+        {
+            qDebug() << QString::fromLocal8Bit("没有适用于 %1、每任务线程数 %2 的标定结果，忽略吞吐目标").arg(m_settings.codec).arg(systemSettings.threadsPerJob);
+        }
     }
-    m_threadPool->setMaxThreadCount(maxConcurrent);
 
-    for (auto it = m_filesToTranscode.begin(); it != m_filesToTranscode.end(); ++it)
+    int maxConcurrent = plan.jobs;
+    m_maxConcurrent = maxConcurrent;
+    m_threadsPerJob = plan.threadsPerJob;
+    m_executor.setMaxConcurrent(maxConcurrent);
+    m_executor.setLaneLimit(TranscodeExecutor::Urgent, systemSettings.urgentLaneJobs);
+    m_executor.setLaneLimit(TranscodeExecutor::Normal, systemSettings.normalLaneJobs);
+    m_executor.setLaneLimit(TranscodeExecutor::Background, systemSettings.backgroundLaneJobs);
+
+    if (systemSettings.metricsEnabled)
     {
-        QString sourceDir = it.key();
-        QStringList files = it.value();
+        startMetricsServer(systemSettings.metricsPort);
+    }
 
-        QDir sourceQDir(sourceDir);
-        QString dramaName = sourceQDir.dirName(); // 获取最后一级目录名
+    // 源和输出在网络存储上时先在本地暂存目录中处理，目录不可用时直接读写原路径
+    if (systemSettings.scratchStaging)
+    {
+        m_scratchDirectory = ScratchStaging::resolveDirectory(systemSettings.scratchDirectory);
+    }
 
-        // 目标目录/
-        // └── 彩礼加了8万8
-        //    ├── 第1集_temp.mp4
-        //    ├── 第2集_temp.mp4
-        //    └── 第3集_temp.mp4
+    // 启动文件前按估计的输出大小预留磁盘空间，预留后会低于下限时暂停启动新文件，直到空间释放；
+    // 同一设备上同时读写的任务数另有上限，与CPU并发数无关
+    m_diskGuard.setFloorBytes(qint64(systemSettings.minFreeSpaceMb) * 1024 * 1024);
+    m_ioLimiter.setLimits(systemSettings.readersPerDevice, systemSettings.writersPerDevice);
+    if (m_diskGuard.floorBytes() > 0 || m_ioLimiter.isEnabled())
+    {
+        m_executor.setAdmissionCheck([this](QRunnable *task)
+                                     { return admitTask(task); },
+                                     [this](QRunnable *task)
+                                     { releaseTask(task); });
+    }
+    if (m_diskGuard.floorBytes() > 0)
+    {
+        m_admissionTimer = new QTimer(this);
+        connect(m_admissionTimer, &QTimer::timeout, this, &TranscodeTaskManager::retryAdmission);
+        m_admissionTimer->start(AdmissionRetryMs);
+    }
 
-        QString dramaTargetDir = QDir(m_targetDirectory).absoluteFilePath(dramaName);
-        QDir().mkpath(dramaTargetDir);
+    // 先探测所有文件的时长和分辨率，再按排序策略提交
+    QList<PendingJob> jobs = collectJobs();
+    if (m_stopped.loadAcquire())
+    {
+        return; // 探测期间被停止
+    }
+    sortJobs(jobs, systemSettings.jobOrder);
 
-        for (const QString &fileName : files)
+    // 记录本批次，程序中断后下次启动可继续未完成的文件
+    if (systemSettings.autoSaveProgress && m_journal.open(m_journalPath, m_targetDirectory, m_settings, m_scratchDirectory))
+    {
+        for (const PendingJob &job : jobs)
         {
-            QString inputPath = QDir(sourceDir).absoluteFilePath(fileName);
+            m_journal.recordQueued(job.inputPath, job.tempOutputPath);
+        }
+        m_journal.sync();
+    }
+
+    // 先确定总数再提交，避免任务提前完成时误判为全部完成
+    m_totalFiles = jobs.size();
+    for (const PendingJob &job : jobs)
+    {
+        submitJob(job);
+    }
+
+    if (systemSettings.adaptiveConcurrency && (m_totalFiles.loadAcquire() > 0 || m_continuous))
+    {
+        startConcurrencyController(systemSettings, maxConcurrent);
+    }
+
+    qDebug() << QString::fromLocal8Bit("提交了 %1 个任务到线程池，最大并发: %2，每任务线程: %3，排序: %4")
+                    .arg(m_totalFiles.loadAcquire())
+                    .arg(maxConcurrent)
+                    .arg(m_threadsPerJob)
+                    .arg(systemSettings.jobOrder);
+
+    // 如果没有文件需要转码，立即发射完成信号（持续模式下等待新文件）
+    if (m_totalFiles.loadAcquire() == 0 && !m_continuous)
+    {
+        qDebug() << QString::fromLocal8Bit("没有文件需要转码，直接完成");
+        m_journal.discard();
+        emit finished();
+        return;
+    }
+}
+
+void TranscodeTaskManager::startConcurrencyController(const SystemSettings &systemSettings, int initialJobs)
+{
+    // 默认上限按每任务线程数折算，每任务多线程时并发数达到核数只会让任务互相争抢；
+    // 再留出一个任务的余量，爬山法才能向上试探（I/O等待多时超订有益，无益时会退回）
+    int cores = CpuScheduler::availableCores();
+    int maxJobs = systemSettings.maxConcurrentJobs > 0 ? systemSettings.maxConcurrentJobs
+                                                       : qMax(initialJobs, cores / qMax(1, m_threadsPerJob)) + 1;
+    m_controller.reset(new ConcurrencyController(initialJobs, systemSettings.minConcurrentJobs, maxJobs, cores));
+
+    // 定时器属于管理器所在的工作线程，在该线程的事件循环中采样
+    m_controllerTimer = new QTimer(this);
+    connect(m_controllerTimer, &QTimer::timeout, this, &TranscodeTaskManager::adjustConcurrency);
+    m_controllerTimer->start(ControllerSampleMs);
+    {
+        QMutexLocker locker(&m_fpsMutex);
+        m_sampledFrames = m_framesEncoded;
+    }
+    m_sampleTimer.start();
+
+    qDebug() << QString::fromLocal8Bit("自适应并发: %1 ~ %2").arg(m_controller->minJobs()).arg(m_controller->maxJobs());
+}
+
+void TranscodeTaskManager::startMetricsServer(int port)
+{
+    // 在管理器线程中创建，随管理器一起销毁
+    m_metricsServer = new MetricsServer([this]() { return m_metrics.render(); }, this);
+    if (!m_metricsServer->listen(static_cast<quint16>(port)))
+    {
+        // 端口被占用不影响转码本身
+        qDebug() << QString::fromLocal8Bit("指标端口监听失败: %1 (%2)").arg(port).arg(m_metricsServer->errorString());
+        delete m_metricsServer;
+        m_metricsServer = nullptr;
+        return;
+    }
+    qDebug() << QString::fromLocal8Bit("指标服务: http://127.0.0.1:%1/metrics").arg(port);
+}
+
+void TranscodeTaskManager::adjustConcurrency()
+{
+    int remaining = m_totalFiles.loadAcquire() - m_completedFiles.loadAcquire() - m_failedFiles.loadAcquire();
+    if (m_stopped.loadAcquire() || (remaining <= 0 && !m_continuous))
+    {
+        m_controllerTimer->stop();
+        return;
+    }
+    if (remaining <= 0)
+    {
+        return; // 持续模式下暂时没有任务
+    }
 
-            QFileInfo fileInfo(fileName);
-            QString baseName = fileInfo.baseName();
-            QString finalOutputName = baseName + ".mp4";
-            QString tempOutputName = baseName + "_temp.mp4";
+    // 按采样间隔内编码的帧数计算总帧率；ffmpeg的fps是自进程启动以来的平均值，
+    // 调整并发后要很久才能反映出来
+    qint64 frames = 0;
+    {
+        QMutexLocker locker(&m_fpsMutex);
+        frames = m_framesEncoded;
+    }
+    qint64 elapsedMs = m_sampleTimer.restart();
+    double fps = elapsedMs > 0 ? (frames - m_sampledFrames) * 1000.0 / elapsedMs : 0.0;
+    m_sampledFrames = frames;
 
-            QString finalOutputPath = QDir(dramaTargetDir).absoluteFilePath(finalOutputName);
-            QString tempOutputPath = QDir(dramaTargetDir).absoluteFilePath(tempOutputName);
-            if (QFile::exists(finalOutputPath))
+    // 缩小并发不会中断运行中的任务，只是暂不启动新任务
+    int jobs = m_controller->addSample(m_controller->sampleSystem(fps), remaining);
+    if (jobs != m_executor.maxConcurrent())
+    {
+        m_executor.setMaxConcurrent(jobs);
+    }
+}
+
+QList<TranscodeTaskManager::PendingJob> TranscodeTaskManager::collectJobs()
+{
+    QList<PendingJob> jobs;
+
+    for (auto it = m_filesToTranscode.begin(); it != m_filesToTranscode.end(); ++it)
+    {
+        for (const QString &fileName : it.value())
+        {
+            if (m_stopped.loadAcquire())
             {
-                qDebug() << QString::fromLocal8Bit("文件已存在，跳过:") << finalOutputPath;
-                continue;
+                return jobs;
             }
 
-            if (QFile::exists(tempOutputPath))
+            PendingJob job;
+            if (prepareJob(it.key(), fileName, job))
             {
-                if (QFile::remove(tempOutputPath))
-                {
-                    qDebug() << QString::fromLocal8Bit("删除已存在的临时文件:") << tempOutputPath;
-                }
-                else
-                {
-                    qDebug() << QString::fromLocal8Bit("删除临时文件失败:") << tempOutputPath;
-                }
+                jobs.append(job);
             }
+        }
+    }
+
+    return jobs;
+}
+
+bool TranscodeTaskManager::prepareJob(const QString &sourceDir, const QString &fileName, PendingJob &job)
+{
+    QDir sourceQDir(sourceDir);
+    QString dramaName = sourceQDir.dirName(); // 获取最后一级目录名
+
+    // 目标目录/
+    // └── 彩礼加了8万8
+    //    ├── 第1集_temp.mp4
+    //    ├── 第2集_temp.mp4
+    //    └── 第3集_temp.mp4
+
+    QString dramaTargetDir = QDir(m_targetDirectory).absoluteFilePath(dramaName);
+    QDir().mkpath(dramaTargetDir);
+
+    QString inputPath = QDir(sourceDir).absoluteFilePath(fileName);
+
+    QFileInfo fileInfo(fileName);
+    QString baseName = fileInfo.baseName();
+    QString finalOutputName = baseName + ".mp4";
+    QString tempOutputName = baseName + "_temp.mp4";
 
-            TranscodeTask *task = new TranscodeTask(inputPath, tempOutputPath, fileName, m_settings, this);
-            m_threadPool->start(task);
-            m_totalFiles++;
+    QString finalOutputPath = QDir(dramaTargetDir).absoluteFilePath(finalOutputName);
+    QString tempOutputPath = QDir(dramaTargetDir).absoluteFilePath(tempOutputName);
+
+    // 附加输出与主输出一起生成，全部存在才跳过，缺任何一个都重新转码全部输出
+    QStringList finalPaths = {finalOutputPath};
+    QStringList tempPaths = {tempOutputPath};
+    for (const Rendition &rendition : m_settings.renditions)
+    {
+        finalPaths << renditionOutputPath(finalOutputPath, rendition);
+        tempPaths << renditionOutputPath(tempOutputPath, rendition);
+    }
+
+    bool allExist = std::all_of(finalPaths.begin(), finalPaths.end(), [](const QString &path)
+                                { return QFile::exists(path); });
+    if (allExist)
+    {
+        qDebug() << QString::fromLocal8Bit("文件已存在，跳过:") << finalOutputPath;
+        return false;
+    }
+
+    for (const QString &path : tempPaths)
+    {
+        if (!QFile::exists(path))
+        {
+            continue;
+        }
+        if (QFile::remove(path))
+        {
+            qDebug() << QString::fromLocal8Bit("删除已存在的临时文件:") << path;
+        }
+        else
+        {
+            qDebug() << QString::fromLocal8Bit("删除临时文件失败:") << path;
         }
     }
 
-    qDebug() << QString::fromLocal8Bit("提交了 %1 个任务到线程池，最大并发: %2")
-                    .arg(m_totalFiles.loadAcquire())
-                    .arg(maxConcurrent);
+    // 清理上次中断留下的分段目录
+    QStringList staleChunkDirs = {ChunkedTranscodeJob::workDirFor(tempOutputPath)};
+    if (!m_scratchDirectory.isEmpty())
+    {
+        staleChunkDirs << ChunkedTranscodeJob::workDirFor(ScratchStaging::localPathFor(m_scratchDirectory, tempOutputPath));
+    }
+    for (const QString &path : staleChunkDirs)
+    {
+        QDir staleChunks(path);
+        if (staleChunks.exists())
+        {
+            staleChunks.removeRecursively();
+        }
+    }
+
+    SystemSettings systemSettings = ConfigManager::instance()->getSystemSettings();
+
+    job.fileName = fileName;
+    job.inputPath = inputPath;
+    job.tempOutputPath = tempOutputPath;
+    job.mediaInfo = ProbeCache::instance()->mediaInfo(inputPath); // 未变化的文件不再运行ffprobe
+    FFmpegUtils::TranscodeParams params = TranscodeTask::paramsFromSettings(m_settings);
+    FFmpegUtils::capToSource(params, job.mediaInfo, m_settings.noUpscale, m_settings.noFrameRateIncrease);
+    job.estimatedWork = estimateWork(job.mediaInfo, params.customResolution);
+    qint64 outputBytes = estimateOutputBytes(job.mediaInfo, params.customResolution, params.audioBitrate);
 
-    // 如果没有文件需要转码，立即发射完成信号
-    if (m_totalFiles.loadAcquire() == 0)
+    // 附加输出共用解码，只增加按像素数折算的编码开销
+    QSize primarySize = params.customResolution;
+    for (const Rendition &rendition : m_settings.renditions)
+    {
+        QSize size = parseResolution(rendition.resolution);
+        if (m_settings.noUpscale && job.mediaInfo.width > 0 && job.mediaInfo.height > 0)
+        {
+            size = FFmpegUtils::capResolution(QSize(job.mediaInfo.width, job.mediaInfo.height), size, params.scaleMode);
+        }
+        job.estimatedWork += job.mediaInfo.durationSec * size.width() * size.height() / qMax(1, primarySize.width() * primarySize.height());
+        outputBytes += estimateOutputBytes(job.mediaInfo, size, params.audioBitrate, rendition.maxBitrateKbps);
+    }
+
+    // 可直接复制视频流的文件只需重新封装，几乎不占CPU，也无需分段；多码率输出必须解码，不能复制
+    bool remux = m_settings.streamCopy && m_settings.renditions.isEmpty() && job.mediaInfo.isValid() &&
+                 FFmpegUtils::checkCompliance(job.mediaInfo, params).video;
+    if (remux)
+    {
+        job.estimatedWork *= RemuxCostRatio;
+        outputBytes = job.mediaInfo.sizeBytes;
+    }
+
+    job.chunked = !remux && m_settings.renditions.isEmpty() && systemSettings.chunkedEncoding && m_maxConcurrent > 1 &&
+                  job.mediaInfo.hasVideo() &&
+                  job.estimatedWork > systemSettings.chunkThresholdSec &&
+                  segmentCountFor(job, m_maxConcurrent) > 1;
+
+    // 磁盘需求：输出目录放最终输出；暂存时本地放源文件副本和输出；
+    // 分段转码的工作目录放切出的分段和编码后的分段，暂存时拼接输出也在工作目录中。
+    // 同时登记各处实际写入的文件，运行中已写出的部分不再重复预留；文件系统在这里解析一次，准入检查时不再读取
+    if (m_diskGuard.floorBytes() == 0)
+    {
+        return true;
+    }
+    DiskSpaceGuard::addNeed(job.diskNeeds, dramaTargetDir, outputBytes, tempPaths);
+    if (job.chunked)
+    {
+        QString workDir = m_scratchDirectory.isEmpty() ? dramaTargetDir : m_scratchDirectory;
+        QString chunkDir = m_scratchDirectory.isEmpty() ? ChunkedTranscodeJob::workDirFor(tempOutputPath)
+                                                        : ChunkedTranscodeJob::workDirFor(ScratchStaging::localPathFor(m_scratchDirectory, tempOutputPath));
+        DiskSpaceGuard::addNeed(job.diskNeeds, workDir, job.mediaInfo.sizeBytes + outputBytes * (m_scratchDirectory.isEmpty() ? 1 : 2), {chunkDir});
+    }
+    else if (!m_scratchDirectory.isEmpty())
+    {
+        QStringList localPaths = {ScratchStaging::localPathFor(m_scratchDirectory, inputPath)};
+        for (const QString &path : tempPaths)
+        {
+            localPaths << ScratchStaging::localPathFor(m_scratchDirectory, path);
+        }
+        DiskSpaceGuard::addNeed(job.diskNeeds, m_scratchDirectory, job.mediaInfo.sizeBytes + outputBytes, localPaths);
+    }
+    return true;
+}
+
+void TranscodeTaskManager::submitJob(const PendingJob &job)
+{
+    m_metrics.jobQueued(job.inputPath);
+
+    if (job.chunked)
+    {
+        // 长视频切分后并行编码，分段数与并发数一致
+        int segments = segmentCountFor(job, m_maxConcurrent);
+        qDebug() << QString::fromLocal8Bit("分段转码: %1，%2 段").arg(job.fileName).arg(segments);
+        auto chunkJob = QSharedPointer<ChunkedTranscodeJob>::create(job.inputPath, job.tempOutputPath, job.fileName,
+                                                                    m_settings, job.mediaInfo, segments, this);
+        chunkJob->setScratchDirectory(m_scratchDirectory);
+        // 切分读取源文件、写入分段目录
+        Admission admission{job.fileName, job.diskNeeds, DeviceIoLimiter::Devices(), job.inputPath, job.tempOutputPath};
+        if (m_ioLimiter.isEnabled())
+        {
+            admission.devices = DeviceIoLimiter::devicesFor({job.inputPath}, {chunkJob->workDir()});
+        }
+        submitAdmitted(new ChunkSplitTask(chunkJob, m_threadsPerJob, job.lane), job.lane, 0, admission);
+        return;
+    }
+
+    TranscodeTask *task = new TranscodeTask(job.inputPath, job.tempOutputPath, job.fileName, m_settings, this);
+    task->setThreadCount(m_threadsPerJob);
+    task->setMediaInfo(job.mediaInfo);
+    task->setScratchDirectory(m_scratchDirectory);
+
+    // 暂存时同样读取源设备、写入输出设备，另外写入暂存目录所在设备
+    Admission admission{job.fileName, job.diskNeeds, DeviceIoLimiter::Devices(), job.inputPath, job.tempOutputPath};
+    if (m_ioLimiter.isEnabled())
+    {
+        QStringList writes = {job.tempOutputPath};
+        if (!m_scratchDirectory.isEmpty())
+        {
+            writes << m_scratchDirectory;
+        }
+        admission.devices = DeviceIoLimiter::devicesFor({job.inputPath}, writes);
+    }
+    submitAdmitted(task, job.lane, 0, admission);
+}
+
+void TranscodeTaskManager::submitAdmitted(QRunnable *task, TranscodeExecutor::Lane lane, int priority, const Admission &admission)
+{
+    bool reserve = !admission.fileName.isEmpty() && m_diskGuard.floorBytes() > 0;
+    if (reserve || !admission.devices.isEmpty())
+    {
+        QMutexLocker locker(&m_admissionMutex);
+        m_admissions.insert(task, admission);
+    }
+    m_executor.submit(task, lane, priority);
+}
+
+bool TranscodeTaskManager::admitTask(QRunnable *task)
+{
+    QMutexLocker locker(&m_admissionMutex);
+    auto it = m_admissions.find(task);
+    if (it == m_admissions.end())
+    {
+        return true;
+    }
+
+    // 先占用设备名额再预留空间，任一失败都归还已占用的部分
+    if (!m_ioLimiter.tryAcquire(it->devices))
+    {
+        return false;
+    }
+    if (!it->fileName.isEmpty() && m_diskGuard.floorBytes() > 0)
+    {
+        QString reason;
+        if (!m_diskGuard.tryReserve(it->outputPath, it->needs, &reason))
+        {
+            m_ioLimiter.release(it->devices);
+            it->rejectReason = reason;
+            m_diskRejected = true;
+            m_diskRejectReason = reason;
+            return false;
+        }
+    }
+
+    if (!it->devices.isEmpty())
+    {
+        m_ioHeld.insert(task, it->devices);
+    }
+    m_admissions.erase(it);
+    return true;
+}
+
+void TranscodeTaskManager::releaseTask(QRunnable *task)
+{
+    DeviceIoLimiter::Devices devices;
+    {
+        QMutexLocker locker(&m_admissionMutex);
+        devices = m_ioHeld.take(task);
+    }
+    m_ioLimiter.release(devices);
+}
+
+void TranscodeTaskManager::retryAdmission()
+{
+    if (m_stopped.loadAcquire())
+    {
+        return;
+    }
+
+    // 其它程序释放的空间不会触发调度，定时重试；槽位已满时不启动任务，无法判断是否因空间不足而暂停
+    bool hasFreeSlot = m_executor.runningCount() < m_executor.maxConcurrent();
+    {
+        QMutexLocker locker(&m_admissionMutex);
+        m_diskRejected = false;
+    }
+    m_executor.retryAdmission();
+
+    bool rejected;
+    QString reason;
+    {
+        QMutexLocker locker(&m_admissionMutex);
+        rejected = m_diskRejected;
+        reason = m_diskRejectReason;
+    }
+
+    // 没有运行中的任务、也没有文件占用预留时仍放不下的文件，只靠等待永远无法启动，按失败处理，批次才能结束
+    if (rejected && m_executor.runningCount() == 0 && !m_diskGuard.hasReservations())
+    {
+        failUnadmittable();
+        rejected = false;
+    }
+
+    if (!hasFreeSlot || rejected == m_admissionPaused)
+    {
+        return;
+    }
+
+    m_admissionPaused = rejected;
+    if (rejected)
+    {
+        qDebug() << QString::fromLocal8Bit("磁盘空间不足，暂停启动新文件: %1").arg(reason);
+    }
+    else
+    {
+        qDebug() << QString::fromLocal8Bit("磁盘空间已释放，继续启动新文件");
+    }
+    emit admissionPausedChanged(rejected, rejected ? reason : QString());
+}
+
+void TranscodeTaskManager::failUnadmittable()
+{
+    // 先在准入锁外收集，从执行器取出任务时会获取执行器锁（准入检查在执行器锁内获取准入锁）
+    QList<QRunnable *> tasks;
+    {
+        QMutexLocker locker(&m_admissionMutex);
+        for (auto it = m_admissions.constBegin(); it != m_admissions.constEnd(); ++it)
+        {
+            if (!it->fileName.isEmpty() && !it->rejectReason.isEmpty())
+            {
+                tasks.append(it.key());
+            }
+        }
+    }
+
+    for (QRunnable *task : tasks)
+    {
+        // 已被调度启动的任务不再处理
+        if (!m_executor.take(task))
+        {
+            continue;
+        }
+
+        Admission admission;
+        {
+            QMutexLocker locker(&m_admissionMutex);
+            admission = m_admissions.take(task);
+        }
+        if (task->autoDelete())
+        {
+            delete task;
+        }
+
+        qDebug() << QString::fromLocal8Bit("磁盘空间不足，无法转码: %1（%2）").arg(admission.fileName, admission.rejectReason);
+
+        JobStats stats;
+        stats.inputPath = admission.inputPath;
+        stats.outputPath = admission.outputPath;
+        stats.inputBytes = QFileInfo(admission.inputPath).size();
+        onTaskCompleted(admission.fileName, false, admission.outputPath, stats);
+    }
+}
+
+void TranscodeTaskManager::setJournalPath(const QString &path)
+{
+    m_journalPath = path;
+}
+
+void TranscodeTaskManager::setContinuous(bool continuous)
+{
+    m_continuous = continuous;
+}
+
+void TranscodeTaskManager::enqueueFile(const QString &sourceDir, const QString &fileName, bool backlog)
+{
+    if (m_stopped.loadAcquire())
+    {
+        return;
+    }
+
+    PendingJob job;
+    if (!prepareJob(sourceDir, fileName, job))
     {
-        qDebug() << QString::fromLocal8Bit("没有文件需要转码，直接完成");
-        emit finished();
         return;
     }
+
+    // 新到达的文件走紧急通道，启动时已存在的存量文件走后台通道
+    job.lane = backlog ? TranscodeExecutor::Background : TranscodeExecutor::Urgent;
+
+    {
+        // 与完成回调互斥，避免队列清空时删除刚重新打开的日志
+        QMutexLocker locker(&m_mutex);
+        SystemSettings systemSettings = ConfigManager::instance()->getSystemSettings();
+        if (systemSettings.autoSaveProgress && !m_journal.isOpen())
+        {
+            m_journal.open(m_journalPath, m_targetDirectory, m_settings, m_scratchDirectory);
+        }
+        m_journal.recordQueued(job.inputPath, job.tempOutputPath);
+        m_totalFiles.ref();
+    }
+
+    qDebug() << QString::fromLocal8Bit("加入队列: %1 (%2)").arg(job.inputPath).arg(TranscodeExecutor::laneToString(job.lane));
+    submitJob(job);
+}
+
+int TranscodeTaskManager::segmentCountFor(const PendingJob &job, int maxConcurrent) const
+{
+    int bySegmentLength = static_cast<int>(job.mediaInfo.durationSec / MinSegmentSec);
+    return qMin(maxConcurrent, bySegmentLength);
+}
+
+void TranscodeTaskManager::sortJobs(QList<PendingJob> &jobs, const QString &order)
+{
+    // 最长任务优先：大任务先开始，避免批次末尾只剩一个长任务拖慢整体完成时间
+    if (order == "longestFirst")
+    {
+        std::stable_sort(jobs.begin(), jobs.end(), [](const PendingJob &a, const PendingJob &b)
+                         { return a.estimatedWork > b.estimatedWork; });
+    }
+    else if (order == "shortestFirst")
+    {
+        std::stable_sort(jobs.begin(), jobs.end(), [](const PendingJob &a, const PendingJob &b)
+                         { return a.estimatedWork < b.estimatedWork; });
+    }
+    // "name"：保持目录和文件名顺序
+}
+
+qint64 TranscodeTaskManager::estimateOutputBytes(const FFmpegUtils::MediaInfo &info, const QSize &targetSize, int audioBitrateKbps, int maxBitrateKbps)
+{
+    if (!info.isValid())
+    {
+        return 0;
+    }
+
+    // CRF编码没有固定码率：按源视频码率和像素数比例估计，放大不按比例增加；设置了峰值码率时以其为上限
+    double videoBps = info.videoBitrate > 0 ? info.videoBitrate
+                                            : (info.bitrate > 0 ? info.bitrate : info.sizeBytes * 8.0 / info.durationSec);
+    double sourcePixels = qMax(1, info.width * info.height);
+    double pixelRatio = qMin(1.0, targetSize.width() * targetSize.height() / sourcePixels);
+    double bps = videoBps * pixelRatio;
+    if (maxBitrateKbps > 0)
+    {
+        bps = qMin(bps, maxBitrateKbps * 1000.0);
+    }
+    bps += audioBitrateKbps * 1000.0;
+    return static_cast<qint64>(info.durationSec * bps / 8.0 * OutputSizeMargin);
+}
+
+double TranscodeTaskManager::estimateWork(const FFmpegUtils::MediaInfo &info, const QSize &targetSize)
+{
+    if (!info.isValid())
+    {
+        return 0.0;
+    }
+
+    // 编码开销与输出帧数成正比，解码开销随源分辨率增长
+    double targetPixels = qMax(1, targetSize.width() * targetSize.height());
+    double sourcePixels = info.width * info.height;
+    return info.durationSec * (1.0 + DecodeCostRatio * sourcePixels / targetPixels);
+}
+
+QSize TranscodeTaskManager::parseResolution(const QString &resolution)
+{
+    QStringList parts = resolution.split('x');
+    if (parts.size() == 2 && parts[0].toInt() > 0 && parts[1].toInt() > 0)
+    {
+        return QSize(parts[0].toInt(), parts[1].toInt());
+    }
+    return QSize(720, 1280);
 }
 
-void TranscodeTaskManager::onTaskCompleted(const QString &fileName, bool success, const QString &outputPath)
+void TranscodeTaskManager::onTaskCompleted(const QString &fileName, bool success, const QString &outputPath, const JobStats &stats)
 {
     QMutexLocker locker(&m_mutex);
 
@@ -147,15 +722,24 @@ void TranscodeTaskManager::onTaskCompleted(const QString &fileName, bool success
         return;
     }
 
+    JobStats finalStats = stats;
+    finalStats.fileName = fileName;
+    finalStats.success = success;
+
     if (success)
     {
         m_completedFiles++;
 
-        // 重命名文件，去掉_temp后缀
+        // 重命名文件，去掉_temp后缀（多码率输出时缺少其它输出而重新转码，需覆盖已有文件）
         QString finalFilePath = outputPath;
         finalFilePath.replace("_temp", "");
 
+        if (!m_settings.renditions.isEmpty())
+        {
+            QFile::remove(finalFilePath);
+        }
         QFile::rename(outputPath, finalFilePath);
+        finalStats.outputPath = finalFilePath;
         emit fileProcessed(fileName, true);
     }
     else
@@ -165,6 +749,31 @@ void TranscodeTaskManager::onTaskCompleted(const QString &fileName, bool success
         qDebug() << QString::fromLocal8Bit("转码失败: %1").arg(fileName);
     }
 
+    {
+        QMutexLocker fpsLocker(&m_fpsMutex);
+        m_fileFrames.remove(stats.inputPath);
+    }
+
+    // 输出已落盘（或失败已删除），实际占用取代预留，任务结束后执行器重新调度；
+    // 不同剧集目录中常有同名文件，预留按临时输出路径区分
+    m_diskGuard.release(outputPath);
+
+    m_report.add(finalStats);
+    m_metrics.jobFinished(finalStats);
+    emit fileStatsUpdated(finalStats);
+
+    // 任一附加输出未能就位时，整个文件计为失败
+    bool renditionsOk = finishRenditions(fileName, success, outputPath, finalStats);
+    if (success && !renditionsOk)
+    {
+        m_completedFiles--;
+        m_failedFiles++;
+        qDebug() << QString::fromLocal8Bit("附加输出重命名失败: %1").arg(fileName);
+    }
+
+    // 重命名之后再记录，崩溃恢复时以最终文件是否存在为准
+    m_journal.recordFinished(outputPath, success && renditionsOk);
+
     // 更新进度
     int completed = m_completedFiles.loadAcquire();
     int failed = m_failedFiles.loadAcquire();
@@ -180,7 +789,29 @@ void TranscodeTaskManager::onTaskCompleted(const QString &fileName, bool success
     if (completed + failed >= total)
     {
         qDebug() << QString::fromLocal8Bit("所有任务完成！成功: %1，失败: %2").arg(completed).arg(failed);
-        emit finished();
+        m_journal.discard();
+
+        // 持续模式下每次队列清空都覆盖写出一次，报告包含迄今为止的全部文件
+        writeReport();
+
+        // 持续模式下队列清空后继续等待新文件
+        if (!m_continuous)
+        {
+            emit finished();
+        }
+    }
+}
+
+void TranscodeTaskManager::writeReport()
+{
+    if (m_report.isEmpty() || m_reportBasePath.isEmpty())
+    {
+        return;
+    }
+
+    if (m_report.write(m_reportBasePath))
+    {
+        qDebug() << QString::fromLocal8Bit("批次报告已写入: %1.json/.csv").arg(m_reportBasePath);
     }
 }
 
@@ -203,19 +834,171 @@ void TranscodeTaskManager::stop()
     qDebug() << QString::fromLocal8Bit("停止转码任务...");
     m_stopped.store(1);
 
-    if (m_threadPool)
+    // 用户主动停止的批次不再恢复
+    m_journal.discard();
+
+    {
+        // 已完成文件的统计仍然写出
+        QMutexLocker locker(&m_mutex);
+        writeReport();
+    }
+
+    m_executor.clear(); // 清空等待中的任务
     {
-        m_threadPool->clear(); // 清空等待中的任务
-        // 注意：正在运行的任务无法立即停止，但会在完成后被忽略
+        QMutexLocker locker(&m_admissionMutex);
+        m_admissions.clear();
     }
+    m_diskGuard.clear();
+    // 正在运行的任务检测到停止标志后会终止ffmpeg并删除临时文件
 
     emit finished(); // 发出完成信号，结束转码过程
 }
 
-void TranscodeTaskManager::onTaskStarted(const QString &fileName)
+void TranscodeTaskManager::onTaskStarted(const QString &fileName, const QString &inputPath)
 {
+    m_metrics.jobStarted(inputPath);
+
     // 发射当前文件变更信号，将文件状态标记为"转码中"
     emit currentFileChanged(fileName);
+    for (const Rendition &rendition : m_settings.renditions)
+    {
+        emit currentFileChanged(renditionKey(fileName, rendition));
+    }
+}
+
+void TranscodeTaskManager::submitTask(QRunnable *task, TranscodeExecutor::Lane lane, int priority,
+                                      const QStringList &readPaths, const QStringList &writePaths)
+{
+    // 不预留磁盘空间（已随所属文件预留），只占用设备名额
+    Admission admission;
+    if (m_ioLimiter.isEnabled())
+    {
+        admission.devices = DeviceIoLimiter::devicesFor(readPaths, writePaths);
+    }
+    submitAdmitted(task, lane, priority, admission);
+}
+
+QStringList TranscodeTaskManager::supportedExtensions()
+{
+    return {"mp4", "mkv", "avi", "mov"};
+}
+
+QMap<QString, QStringList> TranscodeTaskManager::collectVideoFiles(const QStringList &dirs)
+{
+    QStringList extensions = supportedExtensions();
+    QMap<QString, QStringList> result;
+    for (const QString &path : dirs)
+    {
+        QFileInfo info(path);
+
+        if (!info.isDir())
+        {
+            continue;
+        }
+
+        QDir dir(path);
+        QFileInfoList entries = dir.entryInfoList(QDir::Files | QDir::NoSymLinks | QDir::Readable, QDir::Name);
+        QStringList names;
+        for (const QFileInfo &entry : entries)
+        {
+            if (extensions.contains(entry.suffix().toLower()))
+                names.append(entry.fileName());
+        }
+        if (names.isEmpty())
+        {
+            continue;
+        }
+        result.insert(dir.absolutePath(), names);
+    }
+    return result;
+}
+
+void TranscodeTaskManager::onTaskProgress(const QString &fileName, const QString &inputPath, int percent, double fps,
+                                          double speed, qint64 frames)
+{
+    // 停止后不再上报进度
+    if (m_stopped.loadAcquire())
+    {
+        return;
+    }
+
+    {
+        // 不同剧集目录中常有同名文件，按源路径记录
+        QMutexLocker locker(&m_fpsMutex);
+        qint64 &reported = m_fileFrames[inputPath];
+        m_framesEncoded += qMax<qint64>(0, frames - reported);
+        reported = qMax(reported, frames);
+    }
+    m_metrics.jobProgress(inputPath, fps);
+
+    emit fileProgressUpdated(fileName, percent, fps, speed);
+
+    // 附加输出由同一进程编码，进度相同
+    for (const Rendition &rendition : m_settings.renditions)
+    {
+        emit fileProgressUpdated(renditionKey(fileName, rendition), percent, fps, speed);
+    }
+}
+
+QString TranscodeTaskManager::renditionKey(const QString &fileName, const Rendition &rendition)
+{
+    return QString("%1 [%2]").arg(fileName, rendition.resolution);
+}
+
+QString TranscodeTaskManager::renditionOutputPath(const QString &outputPath, const Rendition &rendition)
+{
+    QFileInfo info(outputPath);
+    QString baseName = info.completeBaseName();
+    QString suffix = "_" + rendition.resolution;
+
+    if (baseName.endsWith("_temp"))
+    {
+        baseName.insert(baseName.size() - 5, suffix);
+    }
+    else
+    {
+        baseName += suffix;
+    }
+    return info.dir().filePath(baseName + "." + info.suffix());
+}
+
+bool TranscodeTaskManager::finishRenditions(const QString &fileName, bool success, const QString &outputPath, const JobStats &stats)
+{
+    bool allRenamed = true;
+    for (const Rendition &rendition : m_settings.renditions)
+    {
+        QString key = renditionKey(fileName, rendition);
+        QString tempPath = renditionOutputPath(outputPath, rendition);
+        QString finalPath = tempPath;
+        finalPath.replace("_temp", "");
+
+        bool renamed = false;
+        if (success && QFile::exists(tempPath))
+        {
+            QFile::remove(finalPath);
+            renamed = QFile::rename(tempPath, finalPath);
+        }
+        else
+        {
+            QFile::remove(tempPath);
+        }
+
+        // CPU时间和峰值内存属于整个进程，已计入主输出
+        JobStats renditionStats = stats;
+        renditionStats.fileName = key;
+        renditionStats.success = renamed;
+        renditionStats.outputPath = renamed ? finalPath : tempPath;
+        renditionStats.outputBytes = renamed ? QFileInfo(finalPath).size() : 0;
+        renditionStats.userMs = 0;
+        renditionStats.systemMs = 0;
+        renditionStats.peakRssKb = 0;
+
+        m_report.add(renditionStats);
+        emit fileProcessed(key, renamed);
+        emit fileStatsUpdated(renditionStats);
+        allRenamed = allRenamed && renamed;
+    }
+    return allRenamed;
 }
 
 QString TranscodeTaskManager::generateOutputFileName(const QString &inputFileName, const QString &extension)
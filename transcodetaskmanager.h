@@ -6,11 +6,24 @@
 #include <QMap>
 #include <QProcess>
 #include <QMutex>
-#include <QThreadPool>
 #include <QRunnable>
 #include <QAtomicInt>
+#include <QScopedPointer>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QHash>
 #include <configmanager.h>
 #include "transcodetask.h"
+#include "transcodejournal.h"
+#include "transcodeexecutor.h"
+#include "transcodereport.h"
+#include "transcodemetrics.h"
+#include "utils/ffmpegutils.h"
+#include "utils/concurrencycontroller.h"
+#include "utils/diskspaceguard.h"
+#include "utils/deviceiolimiter.h"
+
+class MetricsServer;
 
 /**
  * 转码任务管理器
@@ -24,8 +37,32 @@ public:
     explicit TranscodeTaskManager(const QMap<QString, QStringList> &files, QObject *parent = nullptr);
     ~TranscodeTaskManager();
 
-    void onTaskCompleted(const QString &fileName, bool success, const QString &outputPath);
-    void onTaskStarted(const QString &fileName); // 任务开始时调用
+    void onTaskCompleted(const QString &fileName, bool success, const QString &outputPath, const JobStats &stats = JobStats());
+    void onTaskStarted(const QString &fileName, const QString &inputPath); // 任务开始时调用
+    void onTaskProgress(const QString &fileName, const QString &inputPath, int percent, double fps, double speed,
+                        qint64 frames); // 任务进度（已节流），frames为该文件累计编码的帧数
+
+    // 运行中的任务轮询此标志，停止后自行终止ffmpeg子进程
+    bool isStopped() const { return m_stopped.loadAcquire(); }
+
+    // 提交额外的任务（如分段转码的各个分段），readPaths/writePaths 所在设备受每设备并发读写上限约束
+    void submitTask(QRunnable *task, TranscodeExecutor::Lane lane, int priority = 0,
+                    const QStringList &readPaths = QStringList(), const QStringList &writePaths = QStringList());
+
+    // 支持转码的视频扩展名
+    static QStringList supportedExtensions();
+
+    // 列出各目录下支持的视频文件（不递归），返回 目录 -> 文件名列表，没有视频的目录被忽略
+    static QMap<QString, QStringList> collectVideoFiles(const QStringList &dirs);
+
+    // 附加输出在表格和进度信号中的名称，如 "第1集.mp4 [480x854]"
+    static QString renditionKey(const QString &fileName, const Rendition &rendition);
+
+    // 附加输出的文件路径：在主输出文件名的 _temp 之前插入分辨率，如 第1集_480x854_temp.mp4
+    static QString renditionOutputPath(const QString &outputPath, const Rendition &rendition);
+
+    // 解析 宽x高，无法识别时返回默认的720x1280
+    static QSize parseResolution(const QString &resolution);
 
 public slots:
     void start();
@@ -40,18 +77,31 @@ public slots:
     // 设置完整的转码设置
     void setTranscodeSettings(const TranscodeSettings &settings);
 
+    // 崩溃恢复日志的路径（默认TranscodeJournal::defaultPath()，需在start前设置）
+    void setJournalPath(const QString &path);
+
+    // 持续模式：队列清空后不发出finished，等待enqueueFile加入新文件（需在start前设置）
+    void setContinuous(bool continuous);
+
+    // 向运行中的批次追加一个文件，应通过排队连接在管理器线程中调用
+    // backlog为true表示启动时已存在的存量文件，走后台通道；否则走紧急通道
+    void enqueueFile(const QString &sourceDir, const QString &fileName, bool backlog = false);
+
 signals:
     void progressUpdated(int value);
     void finished();
     void fileProcessed(const QString &fileName, bool success);
     void currentFileChanged(const QString &fileName);
+    void fileProgressUpdated(const QString &fileName, int percent, double fps, double speed);
     void errorOccurred(const QString &errorMessage);
+    void fileStatsUpdated(const JobStats &stats); // 文件完成后的资源统计
+    void admissionPausedChanged(bool paused, const QString &reason); // 磁盘空间不足暂停/恢复启动新任务
 
 private:
     QMap<QString, QStringList> m_filesToTranscode;
     QString m_targetDirectory;
     TranscodeSettings m_settings;
-    QThreadPool *m_threadPool;
+    TranscodeExecutor m_executor; // 独立执行器，不占用全局线程池
     QMutex m_mutex;
 
     // 进度跟踪
@@ -60,7 +110,92 @@ private:
     QAtomicInt m_failedFiles;
     QAtomicInt m_stopped; // 停止标志
 
+    int m_threadsPerJob;     // 调度器分配给每个任务的线程数
+    int m_maxConcurrent = 1; // 调度器决定的初始并发数（决定分段数）
+    bool m_continuous = false;
+    QString m_scratchDirectory; // 本地暂存目录（空=不暂存）
+
+    TranscodeJournal m_journal; // 崩溃恢复日志（autoSaveProgress开启时写入）
+    QString m_journalPath;      // 日志路径，界面和无界面模式各用一个
+
+    // 批次性能报告，与完成回调共用m_mutex
+    TranscodeReport m_report;
+    QString m_reportBasePath;
+
+    // 运行指标，开启后通过本机HTTP端口供Prometheus抓取
+    TranscodeMetrics m_metrics;
+    MetricsServer *m_metricsServer = nullptr;
+
+    // 自适应并发
+    QScopedPointer<ConcurrencyController> m_controller;
+    QTimer *m_controllerTimer = nullptr;
+    QMutex m_fpsMutex;
+    QMap<QString, qint64> m_fileFrames; // 运行中文件（按源路径）最近上报的累计帧数
+    qint64 m_framesEncoded = 0;         // 所有文件累计编码的帧数
+    qint64 m_sampledFrames = 0;         // 上次采样时的m_framesEncoded
+    QElapsedTimer m_sampleTimer;        // 距上次采样的时间
+
+    static const int ControllerSampleMs = 5000; // 并发控制器的采样间隔
+
+    // 任务准入：文件的第一个任务启动前预留估计的输出空间（文件完成时释放），
+    // 每个任务启动前占用所读写设备的并发名额（任务结束时归还）
+    struct Admission
+    {
+        QString fileName;                 // 为空表示不预留磁盘空间（如分段）
+        DiskSpaceGuard::Needs needs;      // 需要预留的磁盘空间
+        DeviceIoLimiter::Devices devices; // 读写的设备
+        QString inputPath;                // 无法启动时按失败记录
+        QString outputPath;               // 临时输出路径，同时作为磁盘空间预留的名称
+        QString rejectReason;             // 最近一次未能预留空间的原因
+    };
+    DiskSpaceGuard m_diskGuard;
+    DeviceIoLimiter m_ioLimiter;
+    QMutex m_admissionMutex;
+    QHash<QRunnable *, Admission> m_admissions;            // 尚未启动的任务 -> 准入条件
+    QHash<QRunnable *, DeviceIoLimiter::Devices> m_ioHeld; // 运行中的任务 -> 占用的设备名额
+    bool m_diskRejected = false;                           // 最近一轮调度中有文件因磁盘空间未能启动
+    QString m_diskRejectReason;
+    bool m_admissionPaused = false; // 已通知的暂停状态，只在管理器线程中访问
+    QTimer *m_admissionTimer = nullptr;
+
+    static const int AdmissionRetryMs = 10000; // 暂停期间重新检查磁盘空间的间隔
+
+    // 待提交的任务
+    struct PendingJob
+    {
+        QString fileName;
+        QString inputPath;
+        QString tempOutputPath;
+        FFmpegUtils::MediaInfo mediaInfo;
+        double estimatedWork = 0.0;      // 估计工作量（按时长和分辨率折算的秒数）
+        bool chunked = false;            // 是否使用分段并行转码
+        DiskSpaceGuard::Needs diskNeeds; // 启动时需要预留的磁盘空间（文件系统 -> 需求）
+        TranscodeExecutor::Lane lane = TranscodeExecutor::Normal;
+    };
+
+    static constexpr double DecodeCostRatio = 0.2; // 解码一个源像素相对编码一个输出像素的开销
+    static const int MinSegmentSec = 30;            // 分段转码时每段的最短时长
+    static constexpr double RemuxCostRatio = 0.01;  // 直接复制视频流相对重新编码的开销
+    static constexpr double OutputSizeMargin = 1.2; // 输出大小估计的余量
+
     // 私有方法
+    void startConcurrencyController(const SystemSettings &systemSettings, int initialJobs);
+    void startMetricsServer(int port);
+    void adjustConcurrency();
+    void retryAdmission();
+    void failUnadmittable();
+    bool admitTask(QRunnable *task);
+    void releaseTask(QRunnable *task);
+    void submitAdmitted(QRunnable *task, TranscodeExecutor::Lane lane, int priority, const Admission &admission);
+    QList<PendingJob> collectJobs();
+    bool prepareJob(const QString &sourceDir, const QString &fileName, PendingJob &job);
+    void submitJob(const PendingJob &job);
+    int segmentCountFor(const PendingJob &job, int maxConcurrent) const;
+    static void sortJobs(QList<PendingJob> &jobs, const QString &order);
+    static double estimateWork(const FFmpegUtils::MediaInfo &info, const QSize &targetSize);
+    static qint64 estimateOutputBytes(const FFmpegUtils::MediaInfo &info, const QSize &targetSize, int audioBitrateKbps, int maxBitrateKbps = 0);
+    bool finishRenditions(const QString &fileName, bool success, const QString &outputPath, const JobStats &stats);
+    void writeReport();
     bool createTargetDirectory(const QString &dirPath);
     QString generateOutputFileName(const QString &inputFileName, const QString &extension = "mp4");
 };
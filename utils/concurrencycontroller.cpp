@@ -0,0 +1,246 @@
+﻿#include "concurrencycontroller.h"
+#include <QDebug>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <stdlib.h>
+#endif
+
+ConcurrencyController::ConcurrencyController(int initialJobs, int minJobs, int maxJobs, int cores)
+    : m_minJobs(qMax(1, minJobs)), m_maxJobs(qMax(qMax(1, minJobs), maxJobs)), m_cores(qMax(1, cores))
+{
+    m_jobs = qBound(m_minJobs, initialJobs, m_maxJobs);
+    m_settleLeft = SettleSamples;
+
+    // 初始化CPU时间基准，第一次采样才能算出利用率
+    sampleCpuUsage();
+}
+
+ConcurrencyController::Sample ConcurrencyController::sampleSystem(double fps)
+{
+    Sample sample;
+    sample.fps = fps;
+    sample.cpuUsage = sampleCpuUsage();
+
+    double load = loadAverage();
+    sample.loadPerCore = load < 0 ? -1.0 : load / m_cores;
+    return sample;
+}
+
+int ConcurrencyController::addSample(const Sample &sample, int remainingJobs)
+{
+    // 刚调整过并发，新进程还在启动，这段时间的帧率不具代表性
+    if (m_settleLeft > 0)
+    {
+        m_settleLeft--;
+        return m_jobs;
+    }
+
+    m_fpsSum += sample.fps;
+    if (sample.cpuUsage >= 0)
+    {
+        m_cpuSum += sample.cpuUsage;
+        m_cpuCount++;
+    }
+    if (sample.loadPerCore >= 0)
+    {
+        m_loadSum += sample.loadPerCore;
+        m_loadCount++;
+    }
+
+    if (++m_windowCount < WindowSamples)
+    {
+        return m_jobs;
+    }
+
+    double fps = m_fpsSum / m_windowCount;
+    double cpu = m_cpuCount > 0 ? m_cpuSum / m_cpuCount : -1.0;
+    double load = m_loadCount > 0 ? m_loadSum / m_loadCount : -1.0;
+    m_windowCount = 0;
+    m_cpuCount = 0;
+    m_loadCount = 0;
+    m_fpsSum = 0.0;
+    m_cpuSum = 0.0;
+    m_loadSum = 0.0;
+
+    // 没有任务在输出帧（批次开头或末尾），不做判断
+    if (fps > 0)
+    {
+        decide(fps, cpu, load, remainingJobs);
+    }
+    return m_jobs;
+}
+
+void ConcurrencyController::decide(double fps, double cpu, double load, int remainingJobs)
+{
+    qDebug() << QString::fromLocal8Bit("并发控制: 并发=%1 帧率=%2 CPU=%3 每核负载=%4")
+                    .arg(m_jobs)
+                    .arg(fps, 0, 'f', 1)
+                    .arg(cpu, 0, 'f', 2)
+                    .arg(load, 0, 'f', 2);
+
+    // 宿主机过载：其他服务需要CPU，先让出一个并发
+    if (load > OverloadLoad && m_jobs > m_minJobs)
+    {
+        step(-1);
+        m_lastStep = 0;
+        m_baselineFps = -1.0;
+        m_holdLeft = HoldMeasurements;
+        return;
+    }
+
+    // 评估上一次试探的结果
+    if (m_lastStep != 0 && m_baselineFps > 0)
+    {
+        int last = m_lastStep;
+        double gain = (fps - m_baselineFps) / m_baselineFps;
+        m_lastStep = 0;
+
+        if (gain > GainThreshold)
+        {
+            // 试探有效，沿同一方向继续
+            m_baselineFps = fps;
+            if (last > 0 ? canGrow(remainingJobs) : m_jobs > m_minJobs)
+            {
+                step(last);
+            }
+            return;
+        }
+
+        if (gain < -GainThreshold || last > 0)
+        {
+            // 帧率下降，或扩容没有带来收益：回到原来的并发数
+            step(-last);
+            m_lastStep = 0;
+            m_probeDirection = -last;
+            m_holdLeft = HoldMeasurements;
+            return;
+        }
+
+        // 缩容后帧率基本不变：保留较少的并发，把CPU让给其他服务
+        m_baselineFps = fps;
+        m_holdLeft = HoldMeasurements;
+        return;
+    }
+
+    // 没有进行中的试探，刷新基线（宿主机负载会随时间变化）
+    m_baselineFps = fps;
+
+    if (m_holdLeft > 0)
+    {
+        m_holdLeft--;
+        return;
+    }
+
+    // CPU明显空闲时优先扩容，否则按上次成功的方向试探
+    int direction = (cpu >= 0 && cpu < IdleCpu) ? 1 : m_probeDirection;
+    if (direction > 0 && !canGrow(remainingJobs))
+    {
+        direction = m_jobs > m_minJobs ? -1 : 0;
+    }
+    else if (direction < 0 && m_jobs <= m_minJobs)
+    {
+        direction = canGrow(remainingJobs) ? 1 : 0;
+    }
+
+    if (direction != 0)
+    {
+        step(direction);
+    }
+}
+
+void ConcurrencyController::step(int direction)
+{
+    int jobs = qBound(m_minJobs, m_jobs + direction, m_maxJobs);
+    if (jobs == m_jobs)
+    {
+        return;
+    }
+
+    qDebug() << QString::fromLocal8Bit("并发控制: %1 -> %2").arg(m_jobs).arg(jobs);
+    m_jobs = jobs;
+    m_lastStep = direction;
+    m_settleLeft = SettleSamples;
+}
+
+bool ConcurrencyController::canGrow(int remainingJobs) const
+{
+    return m_jobs < m_maxJobs && remainingJobs > m_jobs;
+}
+
+double ConcurrencyController::sampleCpuUsage()
+{
+    qint64 busy = 0;
+    qint64 total = 0;
+    if (!readCpuTimes(busy, total))
+    {
+        return -1.0;
+    }
+
+    double usage = -1.0;
+    if (m_lastTotal >= 0 && total > m_lastTotal)
+    {
+        usage = qBound(0.0, double(busy - m_lastBusy) / double(total - m_lastTotal), 1.0);
+    }
+
+    m_lastBusy = busy;
+    m_lastTotal = total;
+    return usage;
+}
+
+double ConcurrencyController::loadAverage()
+{
+#ifdef Q_OS_UNIX
+    double load[1];
+    if (getloadavg(load, 1) == 1)
+    {
+        return load[0];
+    }
+#endif
+    return -1.0;
+}
+
+bool ConcurrencyController::readCpuTimes(qint64 &busy, qint64 &total)
+{
+#ifdef Q_OS_WIN
+    FILETIME idleTime, kernelTime, userTime;
+    if (!GetSystemTimes(&idleTime, &kernelTime, &userTime))
+    {
+        return false;
+    }
+
+    auto toInt64 = [](const FILETIME &ft)
+    { return (qint64(ft.dwHighDateTime) << 32) | ft.dwLowDateTime; };
+
+    // 内核时间包含空闲时间
+    total = toInt64(kernelTime) + toInt64(userTime);
+    busy = total - toInt64(idleTime);
+    return true;
+#else
+    QFile stat("/proc/stat");
+    if (!stat.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    // cpu  user nice system idle iowait irq softirq steal ...
+    QStringList fields = QString::fromLatin1(stat.readLine()).simplified().split(' ');
+    if (fields.size() < 5 || fields[0] != "cpu")
+    {
+        return false;
+    }
+
+    total = 0;
+    for (int i = 1; i < fields.size(); ++i)
+    {
+        total += fields[i].toLongLong();
+    }
+    qint64 idle = fields[4].toLongLong() + (fields.size() > 5 ? fields[5].toLongLong() : 0);
+    busy = total - idle;
+    return true;
+#endif
+}
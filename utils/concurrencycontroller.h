@@ -0,0 +1,84 @@
+﻿#ifndef CONCURRENCYCONTROLLER_H
+#define CONCURRENCYCONTROLLER_H
+
+#include <QtGlobal>
+
+/**
+ * 自适应并发控制器
+ * 批次运行期间周期性采样总编码帧率、CPU利用率和负载均值，
+ * 用爬山法在[min, max]范围内增减并发ffmpeg进程数，使总帧率最大；
+ * 宿主机被其他服务占用时主动让出并发
+ */
+class ConcurrencyController
+{
+public:
+    /**
+     * 一次采样
+     */
+    struct Sample
+    {
+        double fps = 0.0;          // 所有运行中任务的帧率之和
+        double cpuUsage = -1.0;    // 整机CPU利用率 0~1（<0 表示未知）
+        double loadPerCore = -1.0; // 1分钟负载均值 / 核心数（<0 表示未知）
+    };
+
+    ConcurrencyController(int initialJobs, int minJobs, int maxJobs, int cores);
+
+    /**
+     * 加入一次采样，必要时调整并发数
+     * @param sample 本次采样
+     * @param remainingJobs 尚未完成的任务数，没有排队任务时不再扩容
+     * @return 调整后的并发数
+     */
+    int addSample(const Sample &sample, int remainingJobs);
+
+    // 采样整机CPU利用率和负载，与给定的总帧率组成一次采样
+    Sample sampleSystem(double fps);
+
+    int concurrency() const { return m_jobs; }
+    int minJobs() const { return m_minJobs; }
+    int maxJobs() const { return m_maxJobs; }
+
+    // 1分钟负载均值（不支持的平台返回-1）
+    static double loadAverage();
+
+private:
+    int m_jobs;
+    int m_minJobs;
+    int m_maxJobs;
+    int m_cores;
+
+    // 当前测量窗口
+    int m_settleLeft; // 调整后还需丢弃的采样数（等待新进程启动）
+    int m_windowCount = 0;
+    double m_fpsSum = 0.0;
+    double m_cpuSum = 0.0;
+    double m_loadSum = 0.0;
+    int m_cpuCount = 0;
+    int m_loadCount = 0;
+
+    // 爬山状态
+    double m_baselineFps = -1.0; // 上一次接受的并发数下测得的帧率
+    int m_lastStep = 0;          // 上一次调整的方向（0=未调整）
+    int m_probeDirection = 1;    // 下一次试探的方向
+    int m_holdLeft = 0;          // 试探失败后保持不动的测量次数
+
+    // CPU时间采样
+    qint64 m_lastBusy = -1;
+    qint64 m_lastTotal = -1;
+
+    static const int SettleSamples = 2;           // 调整后丢弃的采样数
+    static const int WindowSamples = 3;           // 每次测量平均的采样数
+    static const int HoldMeasurements = 4;        // 试探失败后保持的测量次数
+    static constexpr double GainThreshold = 0.03; // 帧率变化超过3%才视为有效
+    static constexpr double IdleCpu = 0.85;       // 低于该CPU利用率说明还有空闲核心
+    static constexpr double OverloadLoad = 1.5;   // 每核负载超过该值说明宿主机过载
+
+    double sampleCpuUsage();
+    void decide(double fps, double cpu, double load, int remainingJobs);
+    void step(int direction);
+    bool canGrow(int remainingJobs) const;
+    static bool readCpuTimes(qint64 &busy, qint64 &total);
+};
+
+#endif // CONCURRENCYCONTROLLER_H
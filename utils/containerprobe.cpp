@@ -0,0 +1,1353 @@
+﻿#include "containerprobe.h"
+#include <QFile>
+#include <QList>
+#include <algorithm>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <utility>
+
+namespace
+{
+    const qint64 MaxMoovBytes = 64 * 1024 * 1024;    // moov超过此大小时改用ffprobe
+    const qint64 MaxElementBytes = 16 * 1024 * 1024; // MKV Info/Tracks元素上限
+
+    // Matroska元素ID（含长度标记位）
+    const quint64 EbmlHeaderId = 0x1A45DFA3;
+    const quint64 SegmentId = 0x18538067;
+    const quint64 InfoId = 0x1549A966;
+    const quint64 TracksId = 0x1654AE6B;
+    const quint64 ClusterId = 0x1F43B675;
+    const quint64 TimecodeScaleId = 0x2AD7B1;
+    const quint64 DurationId = 0x4489;
+    const quint64 TrackEntryId = 0xAE;
+    const quint64 TrackTypeId = 0x83;
+    const quint64 CodecIdId = 0x86;
+    const quint64 CodecPrivateId = 0x63A2;
+    const quint64 DefaultDurationId = 0x23E383;
+    const quint64 VideoId = 0xE0;
+    const quint64 ColourId = 0x55B0;
+    const quint64 MatrixCoefficientsId = 0x55B1;
+    const quint64 RangeId = 0x55B9;
+    const quint64 TransferCharacteristicsId = 0x55BA;
+    const quint64 PrimariesId = 0x55BB;
+
+    /**
+     * 从容器中读出的一路流
+     */
+    struct Stream
+    {
+        QString codec;          // ffprobe中的编码名称
+        QByteArray config;      // avcC/hvcC记录
+        double frameRate = 0.0; // 平均帧率
+        qint64 bitrate = 0;     // 比特率 (bps)，容器未给出时为0
+        int fullRange = -1;     // 容器标注的色彩范围，-1为未标注
+        int matrix = -1;        // 容器标注的矩阵系数，-1为未标注
+        int primaries = -1;     // 容器标注的色域，-1为未标注
+        int transfer = -1;      // 容器标注的传输特性，-1为未标注
+    };
+
+    /**
+     * MP4 box，begin/end为内容（不含头部）在缓冲区中的范围
+     */
+    struct Box
+    {
+        QByteArray type;
+        int begin = 0;
+        int end = 0;
+
+        bool isNull() const { return type.isEmpty(); }
+    };
+
+    /**
+     * EBML元素，begin/end为内容在缓冲区中的范围
+     */
+    struct Element
+    {
+        quint64 id = 0;
+        int begin = 0;
+        qint64 end = 0;
+        bool unknownSize = false;
+    };
+
+    // 大端读取，越界时返回0
+    quint64 readBE(const QByteArray &data, qint64 offset, int bytes)
+    {
+        if (offset < 0 || bytes > 8 || offset + bytes > data.size())
+        {
+            return 0;
+        }
+        quint64 value = 0;
+        for (int i = 0; i < bytes; ++i)
+        {
+            value = (value << 8) | quint8(data[int(offset) + i]);
+        }
+        return value;
+    }
+
+    /**
+     * 按位读取SPS，越界或指数哥伦布码过长时 ok() 为false
+     */
+    class BitReader
+    {
+    public:
+        explicit BitReader(const QByteArray &data) : m_data(data) {}
+
+        quint32 bits(int count)
+        {
+            quint32 value = 0;
+            for (int i = 0; i < count; ++i)
+            {
+                if (m_pos >= qint64(m_data.size()) * 8)
+                {
+                    m_ok = false;
+                    return 0;
+                }
+                value = (value << 1) | ((quint8(m_data[int(m_pos / 8)]) >> (7 - m_pos % 8)) & 1);
+                ++m_pos;
+            }
+            return value;
+        }
+
+        quint32 ue()
+        {
+            int zeros = 0;
+            while (bits(1) == 0)
+            {
+                if (!m_ok || ++zeros > 31)
+                {
+                    m_ok = false;
+                    return 0;
+                }
+            }
+            return zeros == 0 ? 0 : (1u << zeros) - 1 + bits(zeros);
+        }
+
+        qint32 se()
+        {
+            quint32 value = ue();
+            return (value & 1) ? qint32((value + 1) / 2) : -qint32(value / 2);
+        }
+
+        bool ok() const { return m_ok; }
+
+    private:
+        QByteArray m_data;
+        qint64 m_pos = 0;
+        bool m_ok = true;
+    };
+
+    // 去掉NAL中的防竞争字节（00 00 03）
+    QByteArray unescapeRbsp(const QByteArray &nal)
+    {
+        QByteArray rbsp;
+        rbsp.reserve(nal.size());
+        int zeros = 0;
+        for (char c : nal)
+        {
+            if (zeros >= 2 && quint8(c) == 3)
+            {
+                zeros = 0;
+                continue;
+            }
+            rbsp.append(c);
+            zeros = (c == 0) ? zeros + 1 : 0;
+        }
+        return rbsp;
+    }
+
+    // 跳过VUI中的 aspect_ratio_info 和 overscan_info，读取视频信号类型（H.264与HEVC相同）
+    void readVideoSignalType(BitReader &sps, int &fullRange, int &primaries, int &transfer, int &matrix)
+    {
+        if (sps.bits(1) && sps.bits(8) == 255) // aspect_ratio_idc == Extended_SAR
+        {
+            sps.bits(32);
+        }
+        if (sps.bits(1)) // overscan_info_present_flag
+        {
+            sps.bits(1);
+        }
+        if (sps.bits(1)) // video_signal_type_present_flag
+        {
+            sps.bits(3);
+            fullRange = int(sps.bits(1));
+            if (sps.bits(1)) // colour_description_present_flag
+            {
+                primaries = int(sps.bits(8));
+                transfer = int(sps.bits(8));
+                matrix = int(sps.bits(8));
+            }
+        }
+    }
+
+    /**
+     * 按ffprobe的名称填写色彩标注（ISO/IEC 23091-2 编码，容器、VUI和MKV相同）
+     * 未标注（2）或未知的取值留空，与ffprobe不输出这些字段一致
+     */
+    void describeColour(FFmpegUtils::MediaInfo &info, int fullRange, int primaries, int transfer, int matrix)
+    {
+        static const char *const primariesNames[] = {"", "bt709", "", "", "bt470m", "bt470bg", "smpte170m", "smpte240m",
+                                                     "film", "bt2020", "smpte428", "smpte431", "smpte432"};
+        static const char *const transferNames[] = {"", "bt709", "", "", "gamma22", "gamma28", "smpte170m", "smpte240m",
+                                                    "linear", "log100", "log316", "iec61966-2-4", "bt1361e",
+                                                    "iec61966-2-1", "bt2020-10", "bt2020-12", "smpte2084", "smpte428",
+                                                    "arib-std-b67"};
+        static const char *const matrixNames[] = {"gbr", "bt709", "", "", "fcc", "bt470bg", "smpte170m", "smpte240m",
+                                                  "ycgco", "bt2020nc", "bt2020c", "smpte2085", "chroma-derived-nc",
+                                                  "chroma-derived-c", "ictcp"};
+        auto name = [](const char *const *names, int count, int value)
+        { return (value >= 0 && value < count) ? QString(names[value]) : QString(); };
+
+        info.colorRange = fullRange < 0 ? QString() : (fullRange ? "pc" : "tv");
+        info.colorPrimaries = primaries == 22 ? QString("ebu3213") : name(primariesNames, int(std::size(primariesNames)), primaries);
+        info.colorTransfer = name(transferNames, int(std::size(transferNames)), transfer);
+        info.colorSpace = name(matrixNames, int(std::size(matrixNames)), matrix);
+    }
+
+    /**
+     * 按ffmpeg解码器的规则得到像素格式名
+     * H.264 8位YUV在全范围时为yuvj*，HEVC只有4:2:0有yuvj420p；RGB矩阵（gbrp）和灰度交给ffprobe
+     */
+    QString pixelFormatName(int chromaFormat, int bitDepth, int fullRange, int matrix, bool hevc)
+    {
+        static const char *const chroma[] = {"", "420", "422", "444"};
+        if (chromaFormat < 1 || chromaFormat > 3 || (chromaFormat == 3 && matrix == 0))
+        {
+            return QString();
+        }
+
+        if (bitDepth == 8)
+        {
+            bool jpeg = fullRange == 1 && (!hevc || chromaFormat == 1);
+            return QString("yuv%1%2p").arg(jpeg ? "j" : "").arg(chroma[chromaFormat]);
+        }
+        if (bitDepth == 9 || bitDepth == 10 || bitDepth == 12 || bitDepth == 14)
+        {
+            return QString("yuv%1p%2le").arg(chroma[chromaFormat]).arg(bitDepth);
+        }
+        return QString();
+    }
+
+    // 跳过H.264 SPS中的一个缩放矩阵
+    void skipAvcScalingList(BitReader &sps, int size)
+    {
+        int lastScale = 8;
+        int nextScale = 8;
+        for (int i = 0; i < size && sps.ok(); ++i)
+        {
+            if (nextScale != 0)
+            {
+                nextScale = (lastScale + sps.se() + 256) % 256;
+            }
+            lastScale = (nextScale == 0) ? lastScale : nextScale;
+        }
+    }
+
+    /**
+     * 解析avcC中的第一个SPS，得到profile、像素格式和裁剪后的分辨率
+     * 容器标注的色彩属性在SPS未给出时生效，与ffmpeg解码器一致
+     */
+    bool describeAvc(const Stream &stream, FFmpegUtils::MediaInfo &info)
+    {
+        const QByteArray &avcC = stream.config;
+        if (avcC.size() < 8 || quint8(avcC[0]) != 1 || (quint8(avcC[5]) & 0x1F) == 0)
+        {
+            return false;
+        }
+        int spsLength = int(readBE(avcC, 6, 2));
+        if (spsLength < 4 || 8 + spsLength > avcC.size())
+        {
+            return false;
+        }
+
+        BitReader sps(unescapeRbsp(avcC.mid(9, spsLength - 1))); // 跳过NAL头
+        int profileIdc = int(sps.bits(8));
+        int constraints = int(sps.bits(8));
+        sps.bits(8); // level_idc
+        sps.ue();    // seq_parameter_set_id
+
+        int chromaFormat = 1;
+        int bitDepth = 8;
+        bool separatePlanes = false;
+        static const int highProfiles[] = {100, 110, 122, 244, 44, 83, 86, 118, 128, 138, 139, 134, 135};
+        if (std::find(std::begin(highProfiles), std::end(highProfiles), profileIdc) != std::end(highProfiles))
+        {
+            chromaFormat = int(sps.ue());
+            if (chromaFormat == 3)
+            {
+                separatePlanes = sps.bits(1);
+            }
+            bitDepth = int(sps.ue()) + 8;
+            sps.ue();    // bit_depth_chroma_minus8
+            sps.bits(1); // qpprime_y_zero_transform_bypass_flag
+            if (sps.bits(1)) // seq_scaling_matrix_present_flag
+            {
+                int lists = (chromaFormat != 3) ? 8 : 12;
+                for (int i = 0; i < lists; ++i)
+                {
+                    if (sps.bits(1))
+                    {
+                        skipAvcScalingList(sps, i < 6 ? 16 : 64);
+                    }
+                }
+            }
+        }
+
+        sps.ue(); // log2_max_frame_num_minus4
+        quint32 pocType = sps.ue();
+        if (pocType == 0)
+        {
+            sps.ue(); // log2_max_pic_order_cnt_lsb_minus4
+        }
+        else if (pocType == 1)
+        {
+            sps.bits(1);
+            sps.se();
+            sps.se();
+            quint32 cycle = sps.ue();
+            if (cycle > 255)
+            {
+                return false;
+            }
+            for (quint32 i = 0; i < cycle; ++i)
+            {
+                sps.se();
+            }
+        }
+        sps.ue();    // max_num_ref_frames
+        sps.bits(1); // gaps_in_frame_num_value_allowed_flag
+
+        int widthMbs = int(sps.ue()) + 1;
+        int heightMapUnits = int(sps.ue()) + 1;
+        bool frameMbsOnly = sps.bits(1);
+        if (!frameMbsOnly)
+        {
+            sps.bits(1); // mb_adaptive_frame_field_flag
+        }
+        sps.bits(1); // direct_8x8_inference_flag
+
+        int cropLeft = 0, cropRight = 0, cropTop = 0, cropBottom = 0;
+        if (sps.bits(1))
+        {
+            cropLeft = int(sps.ue());
+            cropRight = int(sps.ue());
+            cropTop = int(sps.ue());
+            cropBottom = int(sps.ue());
+        }
+
+        int fullRange = stream.fullRange;
+        int matrix = stream.matrix;
+        int primaries = stream.primaries;
+        int transfer = stream.transfer;
+        if (sps.bits(1)) // vui_parameters_present_flag
+        {
+            readVideoSignalType(sps, fullRange, primaries, transfer, matrix);
+        }
+        if (!sps.ok())
+        {
+            return false;
+        }
+        describeColour(info, fullRange, primaries, transfer, matrix);
+
+        bool intra = constraints & 0x10;
+        switch (profileIdc)
+        {
+        case 66:
+            info.videoProfile = (constraints & 0x40) ? "Constrained Baseline" : "Baseline";
+            break;
+        case 77:
+            info.videoProfile = "Main";
+            break;
+        case 88:
+            info.videoProfile = "Extended";
+            break;
+        case 100:
+            info.videoProfile = "High";
+            break;
+        case 110:
+            info.videoProfile = intra ? "High 10 Intra" : "High 10";
+            break;
+        case 122:
+            info.videoProfile = intra ? "High 4:2:2 Intra" : "High 4:2:2";
+            break;
+        case 244:
+            info.videoProfile = intra ? "High 4:4:4 Intra" : "High 4:4:4 Predictive";
+            break;
+        default:
+            return false;
+        }
+
+        info.pixelFormat = pixelFormatName(separatePlanes ? 3 : chromaFormat, bitDepth, fullRange, matrix, false);
+
+        int cropUnitX = 1;
+        int cropUnitY = frameMbsOnly ? 1 : 2;
+        if (!separatePlanes && chromaFormat == 1)
+        {
+            cropUnitX = 2;
+            cropUnitY *= 2;
+        }
+        else if (!separatePlanes && chromaFormat == 2)
+        {
+            cropUnitX = 2;
+        }
+        info.width = widthMbs * 16 - cropUnitX * (cropLeft + cropRight);
+        info.height = (frameMbsOnly ? 1 : 2) * heightMapUnits * 16 - cropUnitY * (cropTop + cropBottom);
+
+        return !info.pixelFormat.isEmpty() && info.width > 0 && info.height > 0;
+    }
+
+    // 跳过HEVC profile_tier_level中通用部分之后的子层信息
+    void skipHevcSubLayers(BitReader &sps, int maxSubLayersMinus1)
+    {
+        bool profilePresent[8] = {};
+        bool levelPresent[8] = {};
+        for (int i = 0; i < maxSubLayersMinus1; ++i)
+        {
+            profilePresent[i] = sps.bits(1);
+            levelPresent[i] = sps.bits(1);
+        }
+        if (maxSubLayersMinus1 > 0)
+        {
+            sps.bits(2 * (8 - maxSubLayersMinus1));
+        }
+        for (int i = 0; i < maxSubLayersMinus1; ++i)
+        {
+            if (profilePresent[i])
+            {
+                sps.bits(32);
+                sps.bits(32);
+                sps.bits(24);
+            }
+            if (levelPresent[i])
+            {
+                sps.bits(8);
+            }
+        }
+    }
+
+    /**
+     * 解析hvcC中的SPS，得到profile、像素格式和去掉一致性窗口后的分辨率
+     * 色彩范围只在SPS的VUI中，需要解析到VUI为止
+     */
+    bool describeHevc(const Stream &stream, FFmpegUtils::MediaInfo &info)
+    {
+        const QByteArray &hvcC = stream.config;
+        if (hvcC.size() < 23 || quint8(hvcC[0]) != 1)
+        {
+            return false;
+        }
+
+        switch (quint8(hvcC[1]) & 0x1F)
+        {
+        case 1:
+            info.videoProfile = "Main";
+            break;
+        case 2:
+            info.videoProfile = "Main 10";
+            break;
+        case 3:
+            info.videoProfile = "Main Still Picture";
+            break;
+        case 4:
+            info.videoProfile = "Rext";
+            break;
+        default:
+            return false;
+        }
+
+        // 参数集数组：类型、NAL个数，每个NAL前有2字节长度
+        QByteArray nal;
+        int arrays = quint8(hvcC[22]);
+        int pos = 23;
+        for (int i = 0; i < arrays && nal.isEmpty(); ++i)
+        {
+            int type = int(readBE(hvcC, pos, 1)) & 0x3F;
+            int count = int(readBE(hvcC, pos + 1, 2));
+            pos += 3;
+            for (int j = 0; j < count; ++j)
+            {
+                int length = int(readBE(hvcC, pos, 2));
+                if (pos + 2 + length > hvcC.size())
+                {
+                    return false;
+                }
+                if (type == 33 && nal.isEmpty()) // SPS_NUT
+                {
+                    nal = hvcC.mid(pos + 2, length);
+                }
+                pos += 2 + length;
+            }
+        }
+        if (nal.size() < 4)
+        {
+            return false;
+        }
+
+        BitReader sps(unescapeRbsp(nal.mid(2))); // 跳过2字节NAL头
+        sps.bits(4); // sps_video_parameter_set_id
+        int maxSubLayersMinus1 = int(sps.bits(3));
+        sps.bits(1);  // sps_temporal_id_nesting_flag
+        sps.bits(32); // general_profile_space .. general_profile_compatibility_flags
+        sps.bits(32);
+        sps.bits(32); // 其余通用约束标志和 general_level_idc
+        skipHevcSubLayers(sps, maxSubLayersMinus1);
+
+        sps.ue(); // sps_seq_parameter_set_id
+        int chromaFormat = int(sps.ue());
+        bool separatePlanes = false;
+        if (chromaFormat == 3)
+        {
+            separatePlanes = sps.bits(1);
+        }
+        int width = int(sps.ue());
+        int height = int(sps.ue());
+        if (sps.bits(1)) // conformance_window_flag
+        {
+            int unitX = (chromaFormat == 1 || chromaFormat == 2) && !separatePlanes ? 2 : 1;
+            int unitY = chromaFormat == 1 && !separatePlanes ? 2 : 1;
+            int left = int(sps.ue());
+            int right = int(sps.ue());
+            int top = int(sps.ue());
+            int bottom = int(sps.ue());
+            width -= unitX * (left + right);
+            height -= unitY * (top + bottom);
+        }
+        int bitDepth = int(sps.ue()) + 8;
+        sps.ue(); // bit_depth_chroma_minus8
+        int pocLsbBits = int(sps.ue()) + 4;
+        bool subLayerOrdering = sps.bits(1);
+        for (int i = subLayerOrdering ? 0 : maxSubLayersMinus1; i <= maxSubLayersMinus1; ++i)
+        {
+            sps.ue();
+            sps.ue();
+            sps.ue();
+        }
+        for (int i = 0; i < 6; ++i) // 编码块、变换块尺寸和变换层级
+        {
+            sps.ue();
+        }
+        if (sps.bits(1) && sps.bits(1)) // scaling_list_enabled_flag, sps_scaling_list_data_present_flag
+        {
+            for (int sizeId = 0; sizeId < 4; ++sizeId)
+            {
+                for (int matrixId = 0; matrixId < 6; matrixId += (sizeId == 3) ? 3 : 1)
+                {
+                    if (!sps.bits(1)) // scaling_list_pred_mode_flag
+                    {
+                        sps.ue();
+                        continue;
+                    }
+                    int coefficients = std::min(64, 1 << (4 + (sizeId << 1)));
+                    if (sizeId > 1)
+                    {
+                        sps.se();
+                    }
+                    for (int k = 0; k < coefficients && sps.ok(); ++k)
+                    {
+                        sps.se();
+                    }
+                }
+            }
+        }
+        sps.bits(2); // amp_enabled_flag, sample_adaptive_offset_enabled_flag
+        if (sps.bits(1)) // pcm_enabled_flag
+        {
+            sps.bits(8);
+            sps.ue();
+            sps.ue();
+            sps.bits(1);
+        }
+
+        // 短期参考帧集，帧间预测的集合依赖前一个集合的差值个数
+        quint32 sets = sps.ue();
+        if (sets > 64)
+        {
+            return false;
+        }
+        QList<int> deltaPocs;
+        for (quint32 i = 0; i < sets && sps.ok(); ++i)
+        {
+            if (i != 0 && sps.bits(1)) // inter_ref_pic_set_prediction_flag
+            {
+                sps.bits(1); // delta_rps_sign
+                sps.ue();    // abs_delta_rps_minus1
+                int count = 0;
+                for (int j = 0; j <= deltaPocs.last() && sps.ok(); ++j)
+                {
+                    if (sps.bits(1) || sps.bits(1)) // used_by_curr_pic_flag, use_delta_flag
+                    {
+                        ++count;
+                    }
+                }
+                deltaPocs.append(count);
+            }
+            else
+            {
+                quint32 negative = sps.ue();
+                quint32 positive = sps.ue();
+                if (negative + positive > 32)
+                {
+                    return false;
+                }
+                for (quint32 j = 0; j < negative + positive; ++j)
+                {
+                    sps.ue();
+                    sps.bits(1);
+                }
+                deltaPocs.append(int(negative + positive));
+            }
+        }
+        if (sps.bits(1)) // long_term_ref_pics_present_flag
+        {
+            quint32 count = sps.ue();
+            if (count > 32)
+            {
+                return false;
+            }
+            for (quint32 i = 0; i < count; ++i)
+            {
+                sps.bits(pocLsbBits);
+                sps.bits(1);
+            }
+        }
+        sps.bits(2); // sps_temporal_mvp_enabled_flag, strong_intra_smoothing_enabled_flag
+
+        int fullRange = stream.fullRange;
+        int matrix = stream.matrix;
+        int primaries = stream.primaries;
+        int transfer = stream.transfer;
+        if (sps.bits(1)) // vui_parameters_present_flag
+        {
+            readVideoSignalType(sps, fullRange, primaries, transfer, matrix);
+        }
+        if (!sps.ok())
+        {
+            return false;
+        }
+        describeColour(info, fullRange, primaries, transfer, matrix);
+
+        info.pixelFormat = pixelFormatName(separatePlanes ? 3 : chromaFormat, bitDepth, fullRange, matrix, true);
+        info.width = width;
+        info.height = height;
+        return !info.pixelFormat.isEmpty() && width > 0 && height > 0;
+    }
+
+    // 填写视频流信息，编码参数以码流中的SPS为准
+    bool describeVideo(const Stream &stream, FFmpegUtils::MediaInfo &info)
+    {
+        info.videoCodec = stream.codec;
+        info.frameRate = stream.frameRate;
+        info.videoBitrate = stream.bitrate;
+        if (stream.frameRate <= 0)
+        {
+            return false;
+        }
+        if (stream.codec == "h264")
+        {
+            return describeAvc(stream, info);
+        }
+        if (stream.codec == "hevc")
+        {
+            return describeHevc(stream, info);
+        }
+        return false;
+    }
+
+    // ---------------------------------------------------------------- MP4/MOV
+
+    QList<Box> childBoxes(const QByteArray &data, int begin, int end)
+    {
+        QList<Box> boxes;
+        int pos = begin;
+        while (pos + 8 <= end)
+        {
+            quint64 size = readBE(data, pos, 4);
+            int header = 8;
+            if (size == 1)
+            {
+                size = readBE(data, pos + 8, 8);
+                header = 16;
+            }
+            else if (size == 0)
+            {
+                size = quint64(end - pos);
+            }
+            if (size < quint64(header) || size > quint64(end - pos))
+            {
+                break;
+            }
+
+            Box box;
+            box.type = data.mid(pos + 4, 4);
+            box.begin = pos + header;
+            box.end = pos + int(size);
+            boxes.append(box);
+            pos = box.end;
+        }
+        return boxes;
+    }
+
+    Box findBox(const QList<Box> &boxes, const char *type)
+    {
+        for (const Box &box : boxes)
+        {
+            if (box.type == type)
+            {
+                return box;
+            }
+        }
+        return Box();
+    }
+
+    // 按路径查找，如 {"mdia", "minf", "stbl"}
+    Box findPath(const QByteArray &data, const Box &parent, std::initializer_list<const char *> path)
+    {
+        Box box = parent;
+        for (const char *type : path)
+        {
+            box = findBox(childBoxes(data, box.begin, box.end), type);
+            if (box.isNull())
+            {
+                break;
+            }
+        }
+        return box;
+    }
+
+    // 读取esds中DecoderConfigDescriptor的objectTypeIndication，失败返回-1
+    int esdsObjectType(const QByteArray &data, const Box &esds)
+    {
+        int pos = esds.begin + 4; // version/flags
+        auto descriptor = [&](int tag) -> bool
+        {
+            if (pos >= esds.end || quint8(data[pos]) != tag)
+            {
+                return false;
+            }
+            ++pos;
+            for (int i = 0; i < 4 && pos < esds.end; ++i) // 长度每字节7位，最高位表示后续还有
+            {
+                if (!(quint8(data[pos++]) & 0x80))
+                {
+                    break;
+                }
+            }
+            return true;
+        };
+
+        if (!descriptor(0x03)) // ES_Descriptor
+        {
+            return -1;
+        }
+        int flags = int(readBE(data, pos + 2, 1));
+        pos += 3;
+        if (flags & 0x80)
+        {
+            pos += 2;
+        }
+        if (flags & 0x40)
+        {
+            pos += 1 + int(readBE(data, pos, 1));
+        }
+        if (flags & 0x20)
+        {
+            pos += 2;
+        }
+        if (!descriptor(0x04) || pos >= esds.end) // DecoderConfigDescriptor
+        {
+            return -1;
+        }
+        return quint8(data[pos]);
+    }
+
+    // 在 {容器中的标识, ffprobe中的编码名称} 表中查找
+    QString lookupCodec(std::initializer_list<std::pair<const char *, const char *>> table, const QByteArray &key)
+    {
+        for (const auto &entry : table)
+        {
+            if (key == entry.first)
+            {
+                return QString::fromLatin1(entry.second);
+            }
+        }
+        return QString();
+    }
+
+    QString mp4AudioCodec(const QByteArray &data, const QByteArray &format, int childBegin, int entryEnd)
+    {
+        if (format != "mp4a")
+        {
+            return lookupCodec({{".mp3", "mp3"}, {"ac-3", "ac3"}, {"ec-3", "eac3"}, {"Opus", "opus"}, {"fLaC", "flac"}, {"alac", "alac"}}, format);
+        }
+
+        // QuickTime中esds位于wave box内
+        Box entry;
+        entry.begin = childBegin;
+        entry.end = entryEnd;
+        Box esds = findBox(childBoxes(data, childBegin, entryEnd), "esds");
+        if (esds.isNull())
+        {
+            esds = findPath(data, entry, {"wave", "esds"});
+        }
+        if (esds.isNull())
+        {
+            return QString();
+        }
+
+        switch (esdsObjectType(data, esds))
+        {
+        case 0x40:
+        case 0x66:
+        case 0x67:
+        case 0x68:
+            return "aac";
+        case 0x69:
+        case 0x6B:
+            return "mp3";
+        case 0xA5:
+            return "ac3";
+        case 0xA6:
+            return "eac3";
+        default:
+            return QString();
+        }
+    }
+
+    /**
+     * 解析一个trak，handler为 "vide"/"soun" 之外时返回空handler
+     * 帧率和码率按ffmpeg mov解复用器的方式由 stts/stsz 计算
+     */
+    bool parseTrak(const QByteArray &moov, const Box &trak, QByteArray &handler, Stream &stream)
+    {
+        Box mdia = findPath(moov, trak, {"mdia"});
+        QList<Box> mdiaChildren = childBoxes(moov, mdia.begin, mdia.end);
+        Box mdhd = findBox(mdiaChildren, "mdhd");
+        Box hdlr = findBox(mdiaChildren, "hdlr");
+        if (mdhd.isNull() || hdlr.isNull())
+        {
+            return false;
+        }
+        handler = moov.mid(hdlr.begin + 8, 4);
+        if (handler != "vide" && handler != "soun")
+        {
+            handler.clear();
+            return true;
+        }
+
+        bool v1 = readBE(moov, mdhd.begin, 1) == 1;
+        quint64 timescale = readBE(moov, mdhd.begin + (v1 ? 20 : 12), 4);
+        quint64 mediaDuration = readBE(moov, mdhd.begin + (v1 ? 24 : 16), v1 ? 8 : 4);
+
+        Box stbl = findPath(moov, mdia, {"minf", "stbl"});
+        QList<Box> stblChildren = childBoxes(moov, stbl.begin, stbl.end);
+        Box stsd = findBox(stblChildren, "stsd");
+        Box stts = findBox(stblChildren, "stts");
+        Box stsz = findBox(stblChildren, "stsz");
+        if (timescale == 0 || stsd.isNull() || stts.isNull() || stsz.isNull())
+        {
+            return false;
+        }
+
+        // stts：总帧数和总时长，最后一项单帧时长异常时按平均值计（同ffmpeg）
+        quint64 entries = readBE(moov, stts.begin + 4, 4);
+        if (stts.begin + 8 + entries * 8 > quint64(stts.end))
+        {
+            return false;
+        }
+        quint64 samples = 0;
+        quint64 duration = 0;
+        for (quint64 i = 0; i < entries; ++i)
+        {
+            quint64 count = readBE(moov, stts.begin + 8 + i * 8, 4);
+            quint64 delta = readBE(moov, stts.begin + 12 + i * 8, 4);
+            if (i + 1 == entries && i > 0 && count == 1 && samples > 100 && delta / 10 > duration / samples)
+            {
+                delta = duration / samples;
+            }
+            samples += count;
+            duration += count * delta;
+        }
+
+        // stsz：样本总字节数
+        quint64 sampleSize = readBE(moov, stsz.begin + 4, 4);
+        quint64 sampleCount = readBE(moov, stsz.begin + 8, 4);
+        quint64 dataSize = sampleSize * sampleCount;
+        if (sampleSize == 0)
+        {
+            if (stsz.begin + 12 + sampleCount * 4 > quint64(stsz.end))
+            {
+                return false;
+            }
+            for (quint64 i = 0; i < sampleCount; ++i)
+            {
+                dataSize += readBE(moov, stsz.begin + 12 + i * 4, 4);
+            }
+        }
+
+        if (samples == 0 || duration == 0)
+        {
+            return false;
+        }
+        quint64 bitrateDuration = (mediaDuration > 0) ? std::min(mediaDuration, duration) : duration;
+        stream.frameRate = double(samples) * timescale / duration;
+        stream.bitrate = qint64(double(dataSize) * 8 * timescale / bitrateDuration);
+
+        // stsd：第一个样本描述
+        int entry = stsd.begin + 8;
+        int entrySize = int(readBE(moov, entry, 4));
+        if (entrySize < 16 || entry + entrySize > stsd.end)
+        {
+            return false;
+        }
+        QByteArray format = moov.mid(entry + 4, 4);
+        int payload = entry + 8;
+        int entryEnd = entry + entrySize;
+
+        if (handler == "soun")
+        {
+            int version = int(readBE(moov, payload + 8, 2));
+            int children = payload + 28 + (version == 1 ? 16 : version == 2 ? 36 : 0);
+            stream.codec = mp4AudioCodec(moov, format, children, entryEnd);
+            return !stream.codec.isEmpty();
+        }
+
+        QByteArray configType;
+        if (format == "avc1" || format == "avc3")
+        {
+            stream.codec = "h264";
+            configType = "avcC";
+        }
+        else if (format == "hvc1" || format == "hev1")
+        {
+            stream.codec = "hevc";
+            configType = "hvcC";
+        }
+        else
+        {
+            return false;
+        }
+
+        // 视觉样本描述头部固定78字节，之后是avcC/hvcC、colr等子box
+        QList<Box> children = childBoxes(moov, payload + 78, entryEnd);
+        Box config = findBox(children, configType.constData());
+        if (config.isNull())
+        {
+            return false;
+        }
+        stream.config = moov.mid(config.begin, config.end - config.begin);
+
+        Box colr = findBox(children, "colr");
+        if (!colr.isNull())
+        {
+            QByteArray colourType = moov.mid(colr.begin, 4);
+            if (colourType == "nclx" || colourType == "nclc")
+            {
+                stream.primaries = int(readBE(moov, colr.begin + 4, 2));
+                stream.transfer = int(readBE(moov, colr.begin + 6, 2));
+                stream.matrix = int(readBE(moov, colr.begin + 8, 2));
+            }
+            if (colourType == "nclx")
+            {
+                stream.fullRange = int(readBE(moov, colr.begin + 10, 1) >> 7);
+            }
+        }
+        return true;
+    }
+
+    bool probeMp4(QFile &file, FFmpegUtils::MediaInfo &info)
+    {
+        // 顶层box逐个跳过直到moov，moov在文件末尾（未faststart）时也只读这一段
+        QByteArray moov;
+        qint64 fileSize = file.size();
+        qint64 pos = 0;
+        while (pos + 8 <= fileSize)
+        {
+            if (!file.seek(pos))
+            {
+                return false;
+            }
+            QByteArray header = file.read(16);
+            quint64 size = readBE(header, 0, 4);
+            int headerSize = 8;
+            if (size == 1)
+            {
+                size = readBE(header, 8, 8);
+                headerSize = 16;
+            }
+            else if (size == 0)
+            {
+                size = quint64(fileSize - pos);
+            }
+            if (size < quint64(headerSize) || size > quint64(fileSize - pos))
+            {
+                return false;
+            }
+
+            if (header.mid(4, 4) == "moov")
+            {
+                if (size > quint64(MaxMoovBytes) || !file.seek(pos + headerSize))
+                {
+                    return false;
+                }
+                moov = file.read(qint64(size) - headerSize);
+                if (moov.size() != qint64(size) - headerSize)
+                {
+                    return false;
+                }
+                break;
+            }
+            pos += qint64(size);
+        }
+
+        // 分片MP4的样本表在moof中，交给ffprobe
+        QList<Box> boxes = childBoxes(moov, 0, moov.size());
+        Box mvhd = findBox(boxes, "mvhd");
+        if (mvhd.isNull() || !findBox(boxes, "mvex").isNull())
+        {
+            return false;
+        }
+        bool v1 = readBE(moov, mvhd.begin, 1) == 1;
+        quint64 timescale = readBE(moov, mvhd.begin + (v1 ? 20 : 12), 4);
+        quint64 duration = readBE(moov, mvhd.begin + (v1 ? 24 : 16), v1 ? 8 : 4);
+        if (timescale == 0 || duration == 0)
+        {
+            return false;
+        }
+        info.durationSec = double(duration) / timescale;
+
+        // 与ffprobe相同，取第一路视频和第一路音频
+        bool haveVideo = false;
+        bool haveAudio = false;
+        for (const Box &box : boxes)
+        {
+            if (box.type != "trak")
+            {
+                continue;
+            }
+            QByteArray handler;
+            Stream stream;
+            if (!parseTrak(moov, box, handler, stream))
+            {
+                // 同类型的流已选定时，后面轨道解析失败不影响结果
+                if ((handler == "vide" && haveVideo) || (handler == "soun" && haveAudio))
+                {
+                    continue;
+                }
+                return false;
+            }
+            if (handler == "vide" && !haveVideo)
+            {
+                if (!describeVideo(stream, info))
+                {
+                    return false;
+                }
+                haveVideo = true;
+            }
+            else if (handler == "soun" && !haveAudio)
+            {
+                info.audioCodec = stream.codec;
+                info.audioBitrate = stream.bitrate;
+                haveAudio = true;
+            }
+        }
+        return haveVideo;
+    }
+
+    // ---------------------------------------------------------------- Matroska
+
+    // 解析EBML变长整数，keepMarker为true时保留长度标记位（元素ID），返回占用的字节数，失败返回0
+    int readVint(const QByteArray &data, int pos, bool keepMarker, quint64 &value)
+    {
+        if (pos < 0 || pos >= data.size())
+        {
+            return 0;
+        }
+        quint8 first = quint8(data[pos]);
+        int length = 1;
+        while (length <= 8 && !(first & (0x80 >> (length - 1))))
+        {
+            ++length;
+        }
+        if (length > 8 || pos + length > data.size())
+        {
+            return 0;
+        }
+        value = keepMarker ? first : (first & (0xFF >> length));
+        for (int i = 1; i < length; ++i)
+        {
+            value = (value << 8) | quint8(data[pos + i]);
+        }
+        return length;
+    }
+
+    bool readElement(const QByteArray &data, int pos, Element &element)
+    {
+        quint64 size = 0;
+        int idLength = readVint(data, pos, true, element.id);
+        int sizeLength = idLength ? readVint(data, pos + idLength, false, size) : 0;
+        if (sizeLength == 0)
+        {
+            return false;
+        }
+        element.begin = pos + idLength + sizeLength;
+        element.unknownSize = size == (quint64(1) << (7 * sizeLength)) - 1;
+        element.end = element.begin + qint64(size);
+        return true;
+    }
+
+    QList<Element> childElements(const QByteArray &data, int begin, int end)
+    {
+        QList<Element> elements;
+        int pos = begin;
+        Element element;
+        while (pos < end && readElement(data, pos, element) && !element.unknownSize && element.end <= end)
+        {
+            elements.append(element);
+            pos = int(element.end);
+        }
+        return elements;
+    }
+
+    quint64 elementUInt(const QByteArray &data, const Element &element)
+    {
+        return readBE(data, element.begin, int(element.end - element.begin));
+    }
+
+    double elementFloat(const QByteArray &data, const Element &element)
+    {
+        if (element.end - element.begin == 4)
+        {
+            quint32 bits = quint32(readBE(data, element.begin, 4));
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+        if (element.end - element.begin == 8)
+        {
+            quint64 bits = readBE(data, element.begin, 8);
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+        return 0.0;
+    }
+
+    /**
+     * 解析Tracks，帧率取自DefaultDuration（同ffmpeg matroska解复用器）
+     * Matroska不记录每路流的大小，码率与ffprobe一样留空
+     */
+    bool parseTracks(const QByteArray &tracks, FFmpegUtils::MediaInfo &info)
+    {
+        bool haveVideo = false;
+        bool haveAudio = false;
+        for (const Element &entry : childElements(tracks, 0, tracks.size()))
+        {
+            if (entry.id != TrackEntryId)
+            {
+                continue;
+            }
+
+            quint64 type = 0;
+            QByteArray codecId;
+            quint64 defaultDuration = 0;
+            Stream stream;
+            for (const Element &field : childElements(tracks, entry.begin, int(entry.end)))
+            {
+                if (field.id == TrackTypeId)
+                {
+                    type = elementUInt(tracks, field);
+                }
+                else if (field.id == CodecIdId)
+                {
+                    codecId = tracks.mid(field.begin, int(field.end - field.begin));
+                    int nul = codecId.indexOf('\0');
+                    if (nul >= 0)
+                    {
+                        codecId.truncate(nul);
+                    }
+                }
+                else if (field.id == CodecPrivateId)
+                {
+                    stream.config = tracks.mid(field.begin, int(field.end - field.begin));
+                }
+                else if (field.id == DefaultDurationId)
+                {
+                    defaultDuration = elementUInt(tracks, field);
+                }
+                else if (field.id == VideoId)
+                {
+                    for (const Element &video : childElements(tracks, field.begin, int(field.end)))
+                    {
+                        if (video.id != ColourId)
+                        {
+                            continue;
+                        }
+                        for (const Element &colour : childElements(tracks, video.begin, int(video.end)))
+                        {
+                            if (colour.id == MatrixCoefficientsId)
+                            {
+                                stream.matrix = int(elementUInt(tracks, colour));
+                            }
+                            else if (colour.id == PrimariesId)
+                            {
+                                stream.primaries = int(elementUInt(tracks, colour));
+                            }
+                            else if (colour.id == TransferCharacteristicsId)
+                            {
+                                stream.transfer = int(elementUInt(tracks, colour));
+                            }
+                            else if (colour.id == RangeId && elementUInt(tracks, colour) != 0)
+                            {
+                                stream.fullRange = elementUInt(tracks, colour) == 2 ? 1 : 0; // 1=广播范围 2=全范围 0=未指定
+                            }
+                        }
+                    }
+                }
+            }
+
+            if (type == 1 && !haveVideo)
+            {
+                stream.codec = lookupCodec({{"V_MPEG4/ISO/AVC", "h264"}, {"V_MPEGH/ISO/HEVC", "hevc"}}, codecId);
+                if (defaultDuration > 0)
+                {
+                    stream.frameRate = 1e9 / double(defaultDuration);
+                }
+                if (!describeVideo(stream, info))
+                {
+                    return false;
+                }
+                haveVideo = true;
+            }
+            else if (type == 2 && !haveAudio)
+            {
+                // A_AAC 可能带有 /MPEG4/LC 等后缀
+                info.audioCodec = codecId.startsWith("A_AAC/") ? QString("aac")
+                                                               : lookupCodec({{"A_AAC", "aac"}, {"A_MPEG/L3", "mp3"}, {"A_AC3", "ac3"}, {"A_EAC3", "eac3"}, {"A_OPUS", "opus"}, {"A_FLAC", "flac"}, {"A_VORBIS", "vorbis"}}, codecId);
+                if (info.audioCodec.isEmpty())
+                {
+                    return false;
+                }
+                haveAudio = true;
+            }
+        }
+        return haveVideo;
+    }
+
+    bool probeMatroska(QFile &file, FFmpegUtils::MediaInfo &info)
+    {
+        // EBML头之后是Segment，Info和Tracks通常位于第一个Cluster之前
+        Element header;
+        if (!readElement(file.read(16), 0, header) || header.id != EbmlHeaderId || header.unknownSize)
+        {
+            return false;
+        }
+        qint64 segmentPos = header.end;
+        Element segment;
+        if (!file.seek(segmentPos) || !readElement(file.read(16), 0, segment) || segment.id != SegmentId)
+        {
+            return false;
+        }
+
+        qint64 pos = segmentPos + segment.begin;
+        qint64 end = segment.unknownSize ? file.size() : std::min(file.size(), segmentPos + segment.end);
+        QByteArray infoData;
+        QByteArray tracksData;
+        while (pos < end && (infoData.isEmpty() || tracksData.isEmpty()))
+        {
+            Element element;
+            if (!file.seek(pos) || !readElement(file.read(16), 0, element))
+            {
+                return false;
+            }
+            if (element.id == ClusterId || element.unknownSize)
+            {
+                break;
+            }
+
+            qint64 size = element.end - element.begin;
+            if (element.id == InfoId || element.id == TracksId)
+            {
+                if (size > MaxElementBytes || !file.seek(pos + element.begin))
+                {
+                    return false;
+                }
+                QByteArray &data = (element.id == InfoId) ? infoData : tracksData;
+                data = file.read(size);
+                if (data.size() != size)
+                {
+                    return false;
+                }
+            }
+            pos += element.begin + size;
+        }
+        if (infoData.isEmpty() || tracksData.isEmpty())
+        {
+            return false;
+        }
+
+        quint64 timecodeScale = 1000000;
+        double duration = 0.0;
+        for (const Element &element : childElements(infoData, 0, infoData.size()))
+        {
+            if (element.id == TimecodeScaleId)
+            {
+                timecodeScale = elementUInt(infoData, element);
+            }
+            else if (element.id == DurationId)
+            {
+                duration = elementFloat(infoData, element);
+            }
+        }
+        info.durationSec = duration * double(timecodeScale) / 1e9;
+        return info.durationSec > 0 && parseTracks(tracksData, info);
+    }
+
+    // 常见的MP4/MOV顶层box，用于识别文件类型
+    bool isMp4TopLevelBox(const QByteArray &type)
+    {
+        static const char *const types[] = {"ftyp", "moov", "mdat", "free", "skip", "wide", "pnot"};
+        for (const char *known : types)
+        {
+            if (type == known)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+bool ContainerProbe::probe(const QString &path, FFmpegUtils::MediaInfo &info)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    QByteArray head = file.peek(8);
+    if (head.size() < 8)
+    {
+        return false;
+    }
+
+    FFmpegUtils::MediaInfo result;
+    bool ok = false;
+    if (readBE(head, 0, 4) == EbmlHeaderId)
+    {
+        ok = probeMatroska(file, result);
+    }
+    else if (isMp4TopLevelBox(head.mid(4, 4)))
+    {
+        ok = probeMp4(file, result);
+    }
+    if (!ok || !result.isValid() || !result.hasVideo())
+    {
+        return false;
+    }
+
+    // 总码率与ffprobe相同，按文件大小和时长计算
+    result.sizeBytes = file.size();
+    result.bitrate = qint64(result.sizeBytes * 8 / result.durationSec);
+    info = result;
+    return true;
+}
@@ -0,0 +1,31 @@
+﻿#ifndef CONTAINERPROBE_H
+#define CONTAINERPROBE_H
+
+#include <QString>
+#include "ffmpegutils.h"
+
+/**
+ * 容器头解析
+ * 不启动ffprobe，直接读取MP4/MOV的moov box和MKV的Segment Info/Tracks元素，
+ * 得到调度和直接复制流判断所需的时长、编码、profile、像素格式、色彩标注、分辨率、帧率和码率。
+ * 字段取值与ffprobe的输出一致（如 h264 的 profile 名称、yuvj420p），可直接替代 probeMediaInfo。
+ *
+ * 只读取文件头部和moov，不扫描媒体数据；遇到分片MP4、未识别的编码、
+ * 缺少时长或帧率等无法确定的情况一律返回false，由调用方改用ffprobe。
+ */
+class ContainerProbe
+{
+public:
+    /**
+     * 解析容器头
+     * @param path 媒体文件路径
+     * @param info 成功时写入媒体信息
+     * @return true 如果所有字段都已确定
+     */
+    static bool probe(const QString &path, FFmpegUtils::MediaInfo &info);
+
+private:
+    ContainerProbe() = delete; // 工具类，禁止实例化
+};
+
+#endif // CONTAINERPROBE_H
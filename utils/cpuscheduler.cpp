@@ -0,0 +1,87 @@
+﻿#include "cpuscheduler.h"
+#include <QThread>
+#include <QtGlobal>
+
+CpuScheduler::Plan CpuScheduler::plan(int cores, int requestedJobs, int requestedThreads, Policy policy)
+{
+    if (cores <= 0)
+    {
+        cores = availableCores();
+    }
+
+    Plan result;
+
+    if (requestedJobs > 0 && requestedThreads > 0)
+    {
+        // 两者都由用户指定，按用户设置执行
+        result.jobs = requestedJobs;
+        result.threadsPerJob = requestedThreads;
+    }
+    else if (requestedJobs > 0)
+    {
+        // 固定并发数，核心平均分配给每个任务
+        result.jobs = requestedJobs;
+        result.threadsPerJob = qMax(1, cores / requestedJobs);
+    }
+    else if (requestedThreads > 0)
+    {
+        // 固定每任务线程数，用剩余预算决定并发数
+        result.threadsPerJob = qMin(requestedThreads, cores);
+        result.jobs = qMax(1, cores / result.threadsPerJob);
+    }
+    else
+    {
+        result.threadsPerJob = defaultThreadsPerJob(policy, cores);
+        result.jobs = qMax(1, cores / result.threadsPerJob);
+    }
+
+    return result;
+}
+
+CpuScheduler::Policy CpuScheduler::policyFromString(const QString &policy)
+{
+    if (policy == "throughput")
+    {
+        return Throughput;
+    }
+    else if (policy == "latency")
+    {
+        return Latency;
+    }
+    return Balanced;
+}
+
+QString CpuScheduler::policyToString(Policy policy)
+{
+    switch (policy)
+    {
+    case Throughput:
+        return "throughput";
+    case Latency:
+        return "latency";
+    case Balanced:
+    default:
+        return "balanced";
+    }
+}
+
+int CpuScheduler::availableCores()
+{
+    int cores = QThread::idealThreadCount();
+    return cores > 0 ? cores : 4;
+}
+
+int CpuScheduler::defaultThreadsPerJob(Policy policy, int cores)
+{
+    // x264/x265的线程扩展性有限，每进程少量线程配合多进程并发吞吐最高
+    switch (policy)
+    {
+    case Throughput:
+        return qMin(2, cores);
+    case Latency:
+        return cores;
+    case Balanced:
+    default:
+        return qMin(4, cores);
+    }
+}
@@ -0,0 +1,54 @@
+﻿#ifndef CPUSCHEDULER_H
+#define CPUSCHEDULER_H
+
+#include <QString>
+
+/**
+ * CPU预算调度器
+ * 把整机核心数视为预算，决定并发任务数 × 每任务编码线程数，
+ * 避免每个x264/x265进程都按全部核心开线程导致严重超额订阅
+ */
+class CpuScheduler
+{
+public:
+    // 调度策略
+    enum Policy
+    {
+        Throughput, // 吞吐优先：多任务、每任务少线程
+        Balanced,   // 均衡
+        Latency     // 单任务优先：少任务、每任务占满核心
+    };
+
+    /**
+     * 调度方案
+     */
+    struct Plan
+    {
+        int jobs = 1;          // 并发ffmpeg进程数
+        int threadsPerJob = 1; // 每个进程的编码线程数
+    };
+
+public:
+    CpuScheduler() = delete; // 工具类，禁止实例化
+
+    /**
+     * 根据核心预算计算调度方案
+     * @param cores 可用逻辑核心数（<=0 时自动检测）
+     * @param requestedJobs 用户指定的并发任务数（0=自动）
+     * @param requestedThreads 用户指定的每任务线程数（0=自动）
+     * @param policy 调度策略
+     * @return 调度方案
+     */
+    static Plan plan(int cores, int requestedJobs, int requestedThreads, Policy policy);
+
+    static Policy policyFromString(const QString &policy);
+    static QString policyToString(Policy policy);
+
+    // 当前机器的逻辑核心数
+    static int availableCores();
+
+private:
+    static int defaultThreadsPerJob(Policy policy, int cores);
+};
+
+#endif // CPUSCHEDULER_H
@@ -0,0 +1,125 @@
+﻿#include "deviceiolimiter.h"
+#include <QFile>
+#include <QFileInfo>
+
+#ifdef Q_OS_WIN
+#include <QStorageInfo>
+#else
+#include <sys/stat.h>
+#endif
+
+void DeviceIoLimiter::setLimits(int readersPerDevice, int writersPerDevice)
+{
+    QMutexLocker locker(&m_mutex);
+    m_readersPerDevice = qMax(0, readersPerDevice);
+    m_writersPerDevice = qMax(0, writersPerDevice);
+}
+
+bool DeviceIoLimiter::isEnabled() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_readersPerDevice > 0 || m_writersPerDevice > 0;
+}
+
+quint64 DeviceIoLimiter::deviceOf(const QString &path)
+{
+    // 输出文件启动时还不存在，向上找到第一个存在的目录
+    QFileInfo fileInfo(path);
+    while (!fileInfo.exists() && !fileInfo.isRoot())
+    {
+        fileInfo = QFileInfo(fileInfo.absolutePath());
+    }
+    if (!fileInfo.exists())
+    {
+        return 0;
+    }
+
+#ifdef Q_OS_WIN
+    // Windows没有st_dev，按卷区分
+    QStorageInfo storage(fileInfo.absoluteFilePath());
+    return storage.isValid() ? qHash(storage.device()) + 1 : 0;
+#else
+    struct stat st;
+    if (::stat(QFile::encodeName(fileInfo.absoluteFilePath()).constData(), &st) != 0)
+    {
+        return 0;
+    }
+    return static_cast<quint64>(st.st_dev);
+#endif
+}
+
+DeviceIoLimiter::Devices DeviceIoLimiter::devicesFor(const QStringList &readPaths, const QStringList &writePaths)
+{
+    Devices devices;
+    for (const QString &path : readPaths)
+    {
+        quint64 device = deviceOf(path);
+        if (device != 0)
+        {
+            devices.reads.insert(device);
+        }
+    }
+    for (const QString &path : writePaths)
+    {
+        quint64 device = deviceOf(path);
+        if (device != 0)
+        {
+            devices.writes.insert(device);
+        }
+    }
+    return devices;
+}
+
+bool DeviceIoLimiter::tryAcquire(const Devices &devices)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_readersPerDevice > 0)
+    {
+        for (quint64 device : devices.reads)
+        {
+            if (m_readers.value(device) >= m_readersPerDevice)
+            {
+                return false;
+            }
+        }
+    }
+    if (m_writersPerDevice > 0)
+    {
+        for (quint64 device : devices.writes)
+        {
+            if (m_writers.value(device) >= m_writersPerDevice)
+            {
+                return false;
+            }
+        }
+    }
+
+    for (quint64 device : devices.reads)
+    {
+        m_readers[device]++;
+    }
+    for (quint64 device : devices.writes)
+    {
+        m_writers[device]++;
+    }
+    return true;
+}
+
+void DeviceIoLimiter::release(const Devices &devices)
+{
+    QMutexLocker locker(&m_mutex);
+    for (quint64 device : devices.reads)
+    {
+        if (--m_readers[device] <= 0)
+        {
+            m_readers.remove(device);
+        }
+    }
+    for (quint64 device : devices.writes)
+    {
+        if (--m_writers[device] <= 0)
+        {
+            m_writers.remove(device);
+        }
+    }
+}
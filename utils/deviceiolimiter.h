@@ -0,0 +1,58 @@
+﻿#ifndef DEVICEIOLIMITER_H
+#define DEVICEIOLIMITER_H
+
+#include <QMap>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+/**
+ * 按块设备限制并发读写
+ * 机械硬盘上同时运行多个读取者会频繁寻道，吞吐量反而下降。
+ * 按文件所在设备（st_dev）分别统计正在读取和写入的任务数，
+ * 达到上限时拒绝新任务，与CPU并发上限相互独立；其它设备上的任务不受影响。
+ * 线程安全，可在任意线程中调用。
+ */
+class DeviceIoLimiter
+{
+public:
+    /**
+     * 一个任务读写的设备
+     */
+    struct Devices
+    {
+        QSet<quint64> reads;  // 读取的设备
+        QSet<quint64> writes; // 写入的设备
+
+        bool isEmpty() const { return reads.isEmpty() && writes.isEmpty(); }
+    };
+
+public:
+    DeviceIoLimiter() = default;
+
+    // 每个设备同时读取/写入的任务数上限（0=不限制）
+    void setLimits(int readersPerDevice, int writersPerDevice);
+    bool isEnabled() const;
+
+    // 文件或目录所在的设备号，文件尚不存在时取所在目录，无法确定时返回0（不参与限制）
+    static quint64 deviceOf(const QString &path);
+
+    // 按路径列表收集设备
+    static Devices devicesFor(const QStringList &readPaths, const QStringList &writePaths);
+
+    // 所有设备都未达到上限时占用并返回true，否则不占用任何名额
+    bool tryAcquire(const Devices &devices);
+
+    // 归还 tryAcquire 占用的名额
+    void release(const Devices &devices);
+
+private:
+    mutable QMutex m_mutex;
+    int m_readersPerDevice = 0;
+    int m_writersPerDevice = 0;
+    QMap<quint64, int> m_readers; // 设备 -> 正在读取的任务数
+    QMap<quint64, int> m_writers; // 设备 -> 正在写入的任务数
+};
+
+#endif // DEVICEIOLIMITER_H
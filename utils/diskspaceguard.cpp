@@ -0,0 +1,151 @@
+﻿#include "diskspaceguard.h"
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QStorageInfo>
+
+void DiskSpaceGuard::addNeed(Needs &needs, const QString &dir, qint64 bytes, const QStringList &paths)
+{
+    QStorageInfo storage(dir);
+    if (!storage.isValid() || !storage.isReady() || bytes <= 0)
+    {
+        return;
+    }
+
+    Need &need = needs[storage.rootPath()];
+    need.bytes += bytes;
+    need.paths += paths;
+}
+
+void DiskSpaceGuard::setFloorBytes(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_floorBytes = qMax<qint64>(0, bytes);
+}
+
+qint64 DiskSpaceGuard::floorBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_floorBytes;
+}
+
+bool DiskSpaceGuard::tryReserve(const QString &key, const Needs &needs, QString *reason)
+{
+    QMutexLocker locker(&m_mutex);
+
+    // 缓存过期后重新读取，其它程序释放的空间和运行中任务写出的进度随之更新
+    if (!m_cacheAge.isValid() || m_cacheAge.elapsed() >= FreeSpaceCacheMs)
+    {
+        m_available.clear();
+        m_cacheAge.start();
+    }
+
+    if (m_floorBytes > 0)
+    {
+        for (auto it = needs.constBegin(); it != needs.constEnd(); ++it)
+        {
+            qint64 available = availableLocked(it.key());
+            if (available - it->bytes < m_floorBytes)
+            {
+                if (reason)
+                {
+                    *reason = QString::fromLocal8Bit("%1 剩余 %2 MB，需要 %3 MB，下限 %4 MB")
+                                  .arg(it.key())
+                                  .arg(qMax<qint64>(0, available) / (1024 * 1024))
+                                  .arg(it->bytes / (1024 * 1024))
+                                  .arg(m_floorBytes / (1024 * 1024));
+                }
+                return false;
+            }
+        }
+    }
+
+    // 同名预留被替换，缓存作废；否则新任务尚未写出，整个预留都从缓存的剩余空间中扣除
+    if (m_reservations.contains(key))
+    {
+        m_available.clear();
+    }
+    else
+    {
+        for (auto it = needs.constBegin(); it != needs.constEnd(); ++it)
+        {
+            if (m_available.contains(it.key()))
+            {
+                m_available[it.key()] -= it->bytes;
+            }
+        }
+    }
+    m_reservations.insert(key, needs);
+    return true;
+}
+
+void DiskSpaceGuard::release(const QString &key)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_reservations.remove(key) > 0)
+    {
+        // 文件已落盘或删除，下次检查时重新读取
+        m_available.clear();
+    }
+}
+
+void DiskSpaceGuard::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_reservations.clear();
+    m_available.clear();
+}
+
+bool DiskSpaceGuard::hasReservations() const
+{
+    QMutexLocker locker(&m_mutex);
+    return !m_reservations.isEmpty();
+}
+
+qint64 DiskSpaceGuard::availableLocked(const QString &volume)
+{
+    auto cached = m_available.constFind(volume);
+    if (cached != m_available.constEnd())
+    {
+        return cached.value();
+    }
+
+    QStorageInfo storage(volume);
+    storage.refresh();
+    qint64 available = storage.bytesAvailable();
+
+    // 运行中任务只有尚未写出的部分还会占用空间
+    for (const Needs &reserved : m_reservations)
+    {
+        auto need = reserved.constFind(volume);
+        if (need != reserved.constEnd())
+        {
+            available -= qMax<qint64>(0, need->bytes - writtenBytes(need->paths));
+        }
+    }
+
+    m_available.insert(volume, available);
+    return available;
+}
+
+qint64 DiskSpaceGuard::writtenBytes(const QStringList &paths)
+{
+    qint64 bytes = 0;
+    for (const QString &path : paths)
+    {
+        QFileInfo info(path);
+        if (info.isDir())
+        {
+            QDirIterator it(path, QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+            while (it.hasNext())
+            {
+                it.next();
+                bytes += it.fileInfo().size();
+            }
+        }
+        else if (info.exists())
+        {
+            bytes += info.size();
+        }
+    }
+    return bytes;
+}
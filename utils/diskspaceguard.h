@@ -0,0 +1,83 @@
+﻿#ifndef DISKSPACEGUARD_H
+#define DISKSPACEGUARD_H
+
+#include <QElapsedTimer>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+/**
+ * 磁盘空间预留
+ * 任务启动前按估计的输出大小在各个文件系统上预留空间，
+ * 剩余空间减去所有预留中尚未写出的部分后低于下限时拒绝预留，调用方暂缓启动新任务。
+ * 运行中任务已写出的字节已经反映在剩余空间中，从其预留中扣除，不重复计算。
+ * 各文件系统的剩余空间在 FreeSpaceCacheMs 内只读取一次，同一轮调度检查多个排队任务时不重复读取。
+ * 线程安全，可在任意线程中调用。
+ */
+class DiskSpaceGuard
+{
+public:
+    /**
+     * 一个文件系统上的需求
+     */
+    struct Need
+    {
+        qint64 bytes = 0;  // 需要预留的字节数
+        QStringList paths; // 在该文件系统上写入的文件或目录，已写出的大小从预留中扣除
+    };
+
+    // 文件系统根目录 -> 需求，由 addNeed 填写
+    using Needs = QMap<QString, Need>;
+
+public:
+    DiskSpaceGuard() = default;
+
+    /**
+     * 把目录上的需求计入所在文件系统，在准备任务时调用，准入检查时不再解析路径
+     * @param needs 需求表
+     * @param dir 写入的目录，不存在或无法读取容量时忽略
+     * @param bytes 需要的字节数
+     * @param paths 任务写入的文件或目录（可以尚不存在）
+     */
+    static void addNeed(Needs &needs, const QString &dir, qint64 bytes, const QStringList &paths);
+
+    // 每个文件系统保留的剩余空间下限（0=不检查）
+    void setFloorBytes(qint64 bytes);
+    qint64 floorBytes() const;
+
+    /**
+     * 为key预留空间
+     * @param key 预留的名称（如临时输出路径，需唯一），release时使用
+     * @param needs 各文件系统需要的空间
+     * @param reason 失败时写入空间不足的文件系统和剩余空间
+     * @return true 如果所有文件系统都预留成功；失败时不预留任何空间
+     */
+    bool tryReserve(const QString &key, const Needs &needs, QString *reason = nullptr);
+
+    // 释放key的预留，不存在时忽略
+    void release(const QString &key);
+
+    // 释放全部预留
+    void clear();
+
+    // 是否还有未释放的预留
+    bool hasReservations() const;
+
+private:
+    mutable QMutex m_mutex;
+    qint64 m_floorBytes = 0;
+    QMap<QString, Needs> m_reservations; // key -> 文件系统根目录 -> 需求
+    QMap<QString, qint64> m_available;   // 文件系统根目录 -> 剩余空间减去尚未写出的预留（缓存）
+    QElapsedTimer m_cacheAge;            // 缓存的读取时间
+
+    static const int FreeSpaceCacheMs = 1000; // 剩余空间缓存的有效期
+
+    // 读取文件系统的剩余空间并扣除各预留尚未写出的部分，写入缓存
+    qint64 availableLocked(const QString &volume);
+
+    // 文件或目录（递归）当前的大小
+    static qint64 writtenBytes(const QStringList &paths);
+};
+
+#endif // DISKSPACEGUARD_H
@@ -2,28 +2,107 @@
 #include <QProcess>
 #include <QFileInfo>
 #include <QDebug>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
 
 QString FFmpegUtils::buildTranscodeCommand(const QString &srcPath,
                                            const QString &targetPath,
                                            const TranscodeParams &params)
 {
     QStringList args;
-    args << "ffmpeg" << "-i" << escapeFilePath(srcPath);
+    args << "ffmpeg";
+
+    // 进度输出到stdout，关闭stderr上的统计行
+    if (params.progressOutput)
+    {
+        args << "-progress" << "pipe:1" << "-nostats";
+    }
+
+    // 限制解码线程，默认会按全部核心开线程
+    if (params.threads > 0)
+    {
+        args << "-threads" << QString::number(params.threads);
+    }
+
+    args << "-i" << escapeFilePath(srcPath);
+
+    // 视频：符合目标参数时直接复制
+    if (params.copyVideo)
+    {
+        args << "-c:v" << "copy";
+    }
+    else
+    {
+        appendVideoEncodeArgs(args, params);
+    }
+
+    // 音频编码器设置
+    if (!params.audioEnabled)
+    {
+        args << "-an";
+    }
+    else if (params.copyAudio)
+    {
+        args << "-c:a" << "copy";
+    }
+    else
+    {
+        args << "-c:a" << audioCodecToString(params.audioCodec);
+
+        // 音频比特率
+        if (params.audioBitrate > 0)
+        {
+            args << "-b:a" << QString("%1k").arg(params.audioBitrate);
+        }
+    }
+
+    // FastStart优化
+    if (params.fastStart)
+    {
+        args << "-movflags" << "faststart";
+    }
+
+    // 输出文件
+    args << escapeFilePath(targetPath);
+
+    return args.join(" ");
+}
 
+void FFmpegUtils::appendVideoEncodeArgs(QStringList &args, const TranscodeParams &params, bool scale)
+{
     // 视频编码器设置
     args << "-c:v" << videoCodecToString(params.videoCodec);
 
-    // 分辨率设置
-    QSize resolution;
-    if (params.resolutionPreset == RESOLUTION_CUSTOM)
+    // 编码线程：libx265使用自己的线程池，需要通过pools单独限制
+    if (params.threads > 0)
     {
-        resolution = params.customResolution;
+        args << "-threads" << QString::number(params.threads);
+        args << "-filter_threads" << QString::number(params.threads);
+        if (params.videoCodec == H264)
+        {
+            args << "-x264-params" << QString("threads=%1").arg(params.threads);
+        }
+        else if (params.videoCodec == H265)
+        {
+            args << "-x265-params" << QString("pools=%1").arg(params.threads);
+        }
     }
-    else
+
+    // 分辨率设置：按缩放方式生成显式的缩放滤镜（多码率输出时由滤镜图缩放）
+    if (scale)
     {
-        resolution = resolutionPresetToSize(params.resolutionPreset);
+        QSize resolution;
+        if (params.resolutionPreset == RESOLUTION_CUSTOM)
+        {
+            resolution = params.customResolution;
+        }
+        else
+        {
+            resolution = resolutionPresetToSize(params.resolutionPreset);
+        }
+        args << "-vf" << buildScaleFilter(resolution, params.scaleMode, params.scaler);
     }
-    args << "-s" << QString("%1x%2").arg(resolution.width()).arg(resolution.height());
 
     // 帧率设置
     if (params.frameRate > 0)
@@ -58,37 +137,231 @@ QString FFmpegUtils::buildTranscodeCommand(const QString &srcPath,
     {
         args << "-profile:v" << params.profile;
     }
+}
 
-    // 音频编码器设置
-    args << "-c:a" << audioCodecToString(params.audioCodec);
+QString FFmpegUtils::buildSimpleTranscodeCommand(const QString &srcPath, const QString &targetPath)
+{
+    TranscodeParams params;
+    params.crf = 23;
+    params.frameRate = 30;
+    params.customResolution = QSize(720, 1280);
+    params.resolutionPreset = RESOLUTION_CUSTOM;
 
-    // 音频比特率
-    if (params.audioBitrate > 0)
+    return buildTranscodeCommand(srcPath, targetPath, params);
+}
+
+QString FFmpegUtils::buildRenditionCommand(const QString &srcPath,
+                                           const QList<RenditionOutput> &outputs,
+                                           const TranscodeParams &params)
+{
+    QStringList args;
+    args << "ffmpeg";
+
+    if (params.progressOutput)
     {
-        args << "-b:a" << QString("%1k").arg(params.audioBitrate);
+        args << "-progress" << "pipe:1" << "-nostats";
     }
 
-    // FastStart优化
-    if (params.fastStart)
+    if (params.threads > 0)
     {
-        args << "-movflags" << "faststart";
+        args << "-threads" << QString::number(params.threads);
+        args << "-filter_complex_threads" << QString::number(params.threads);
     }
 
-    // 输出文件
-    args << escapeFilePath(targetPath);
+    args << "-i" << escapeFilePath(srcPath);
+
+    // 解码一次，split后每一路单独缩放：[0:v]split=2[s0][s1];[s0]scale=720:1280...[v0];[s1]scale=480:854...[v1]
+    QStringList graph;
+    QString splitOutputs;
+    for (int i = 0; i < outputs.size(); ++i)
+    {
+        splitOutputs += QString("[s%1]").arg(i);
+        graph << QString("[s%1]%2[v%1]").arg(i).arg(buildScaleFilter(outputs[i].size, params.scaleMode, params.scaler));
+    }
+    graph.prepend(QString("[0:v]split=%1%2").arg(outputs.size()).arg(splitOutputs));
+    args << "-filter_complex" << graph.join(';');
+
+    for (int i = 0; i < outputs.size(); ++i)
+    {
+        const RenditionOutput &output = outputs[i];
+        TranscodeParams outputParams = params;
+        if (output.crf > 0)
+        {
+            outputParams.crf = output.crf;
+        }
+
+        args << "-map" << QString("[v%1]").arg(i);
+        appendVideoEncodeArgs(args, outputParams, false);
+
+        // 限制峰值码率，CRF仍决定平均质量
+        if (output.maxBitrateKbps > 0)
+        {
+            args << "-maxrate" << QString("%1k").arg(output.maxBitrateKbps);
+            args << "-bufsize" << QString("%1k").arg(output.maxBitrateKbps * 2);
+        }
+
+        if (params.audioEnabled)
+        {
+            args << "-map" << "0:a:0?";
+            args << "-c:a" << audioCodecToString(params.audioCodec);
+            if (params.audioBitrate > 0)
+            {
+                args << "-b:a" << QString("%1k").arg(params.audioBitrate);
+            }
+        }
+
+        if (params.fastStart)
+        {
+            args << "-movflags" << "faststart";
+        }
+
+        args << escapeFilePath(output.path);
+    }
 
     return args.join(" ");
 }
 
-QString FFmpegUtils::buildSimpleTranscodeCommand(const QString &srcPath, const QString &targetPath)
+QString FFmpegUtils::buildScaleFilter(const QSize &size, ScaleMode mode, ScaleAlgorithm scaler)
 {
-    TranscodeParams params;
-    params.crf = 23;
-    params.frameRate = 30;
-    params.customResolution = QSize(720, 1280);
-    params.resolutionPreset = RESOLUTION_CUSTOM;
+    QString w = QString::number(size.width());
+    QString h = QString::number(size.height());
+    QString flags = "flags=" + scaleAlgorithmToString(scaler);
 
-    return buildTranscodeCommand(srcPath, targetPath, params);
+    switch (mode)
+    {
+    case SCALE_STRETCH:
+        return QString("scale=%1:%2:%3").arg(w, h, flags);
+    case SCALE_FIT:
+        return QString("scale=%1:%2:force_original_aspect_ratio=decrease:force_divisible_by=2:%3,setsar=1").arg(w, h, flags);
+    case SCALE_FILL:
+        return QString("scale=%1:%2:force_original_aspect_ratio=increase:%3,crop=%1:%2,setsar=1").arg(w, h, flags);
+    case SCALE_PAD:
+    default:
+        return QString("scale=%1:%2:force_original_aspect_ratio=decrease:force_divisible_by=2:%3,pad=%1:%2:(ow-iw)/2:(oh-ih)/2,setsar=1").arg(w, h, flags);
+    }
+}
+
+FFmpegUtils::ScaleGeometry FFmpegUtils::scaleGeometry(const QSize &source, const QSize &target, ScaleMode mode)
+{
+    auto even = [](double value)
+    { return qMax(2, static_cast<int>(qRound(value)) & ~1); };
+
+    ScaleGeometry geometry;
+    geometry.frameSize = target;
+    geometry.sourceRect = QRect(QPoint(0, 0), source);
+    geometry.targetRect = QRect(QPoint(0, 0), target);
+    if (mode == SCALE_STRETCH || source.isEmpty() || target.isEmpty())
+    {
+        return geometry;
+    }
+
+    double scaleX = static_cast<double>(target.width()) / source.width();
+    double scaleY = static_cast<double>(target.height()) / source.height();
+
+    if (mode == SCALE_FILL)
+    {
+        // 按较大的比例铺满，源中超出目标比例的部分居中裁掉
+        double scale = qMax(scaleX, scaleY);
+        int cropWidth = qMin(source.width(), even(target.width() / scale));
+        int cropHeight = qMin(source.height(), even(target.height() / scale));
+        geometry.sourceRect = QRect(((source.width() - cropWidth) / 2) & ~1, ((source.height() - cropHeight) / 2) & ~1, cropWidth, cropHeight);
+        return geometry;
+    }
+
+    // fit/pad：按较小的比例缩放到目标框内
+    double scale = qMin(scaleX, scaleY);
+    int width = qMin(target.width(), even(source.width() * scale));
+    int height = qMin(target.height(), even(source.height() * scale));
+    if (mode == SCALE_FIT)
+    {
+        geometry.frameSize = QSize(width, height);
+        geometry.targetRect = QRect(0, 0, width, height);
+    }
+    else
+    {
+        geometry.targetRect = QRect(((target.width() - width) / 2) & ~1, ((target.height() - height) / 2) & ~1, width, height);
+    }
+    return geometry;
+}
+
+QSize FFmpegUtils::capResolution(const QSize &source, const QSize &target, ScaleMode mode)
+{
+    if (source.isEmpty() || target.isEmpty())
+    {
+        return target;
+    }
+
+    // 该缩放方式下源画面的放大倍数（fill按较大的比例铺满，其它按较小的比例放入）
+    double scaleX = static_cast<double>(target.width()) / source.width();
+    double scaleY = static_cast<double>(target.height()) / source.height();
+    double scale = (mode == SCALE_FILL) ? qMax(scaleX, scaleY) : qMin(scaleX, scaleY);
+    if (scale <= 1.0)
+    {
+        return target;
+    }
+
+    int width = qMax(2, static_cast<int>(target.width() / scale) & ~1);
+    int height = qMax(2, static_cast<int>(target.height() / scale) & ~1);
+    return QSize(width, height);
+}
+
+void FFmpegUtils::capToSource(TranscodeParams &params, const MediaInfo &info, bool noUpscale, bool noFrameRateIncrease)
+{
+    if (noUpscale && info.width > 0 && info.height > 0)
+    {
+        QSize target = (params.resolutionPreset == RESOLUTION_CUSTOM) ? params.customResolution
+                                                                       : resolutionPresetToSize(params.resolutionPreset);
+        QSize capped = capResolution(QSize(info.width, info.height), target, params.scaleMode);
+        if (capped != target)
+        {
+            params.resolutionPreset = RESOLUTION_CUSTOM;
+            params.customResolution = capped;
+        }
+    }
+
+    // 容差避免29.97这类帧率因探测误差被当作低于30
+    if (noFrameRateIncrease && info.frameRate > 0 && params.frameRate > 0 && info.frameRate < params.frameRate - 0.5)
+    {
+        params.frameRate = 0;
+    }
+}
+
+FFmpegUtils::ScaleMode FFmpegUtils::scaleModeFromString(const QString &name)
+{
+    if (name == "stretch")
+        return SCALE_STRETCH;
+    if (name == "fit")
+        return SCALE_FIT;
+    if (name == "fill")
+        return SCALE_FILL;
+    return SCALE_PAD;
+}
+
+FFmpegUtils::ScaleAlgorithm FFmpegUtils::scaleAlgorithmFromString(const QString &name)
+{
+    if (name == "fast_bilinear")
+        return SCALER_FAST_BILINEAR;
+    if (name == "bilinear")
+        return SCALER_BILINEAR;
+    if (name == "lanczos")
+        return SCALER_LANCZOS;
+    return SCALER_BICUBIC;
+}
+
+QString FFmpegUtils::scaleAlgorithmToString(ScaleAlgorithm scaler)
+{
+    switch (scaler)
+    {
+    case SCALER_FAST_BILINEAR:
+        return "fast_bilinear";
+    case SCALER_BILINEAR:
+        return "bilinear";
+    case SCALER_LANCZOS:
+        return "lanczos";
+    case SCALER_BICUBIC:
+    default:
+        return "bicubic";
+    }
 }
 
 QString FFmpegUtils::buildCompressCommand(const QString &srcPath,
@@ -108,6 +381,121 @@ QString FFmpegUtils::buildCompressCommand(const QString &srcPath,
     return args.join(" ");
 }
 
+QString FFmpegUtils::buildSegmentCommand(const QString &srcPath,
+                                         const QString &outputPattern,
+                                         double segmentSec)
+{
+    QStringList args;
+    args << "ffmpeg" << "-nostats" << "-i" << escapeFilePath(srcPath);
+    args << "-map" << "0:v:0" << "-an";
+    args << "-c" << "copy";
+    args << "-f" << "segment";
+    args << "-segment_time" << QString::number(segmentSec, 'f', 3);
+    args << "-reset_timestamps" << "1";
+    args << escapeFilePath(outputPattern);
+
+    return args.join(" ");
+}
+
+QString FFmpegUtils::buildConcatCommand(const QString &listPath,
+                                        const QString &audioSrcPath,
+                                        const QString &targetPath,
+                                        const TranscodeParams &params)
+{
+    QStringList args;
+    args << "ffmpeg" << "-nostats";
+    args << "-f" << "concat" << "-safe" << "0" << "-i" << escapeFilePath(listPath);
+    args << "-i" << escapeFilePath(audioSrcPath);
+
+    // 视频来自拼接后的分段，音频直接从源文件整体编码，避免分段边界处的音频间隙
+    args << "-map" << "0:v:0" << "-map" << "1:a:0?";
+    args << "-c:v" << "copy";
+    args << "-c:a" << audioCodecToString(params.audioCodec);
+    if (params.audioBitrate > 0)
+    {
+        args << "-b:a" << QString("%1k").arg(params.audioBitrate);
+    }
+
+    if (params.fastStart)
+    {
+        args << "-movflags" << "faststart";
+    }
+
+    args << escapeFilePath(targetPath);
+
+    return args.join(" ");
+}
+
+FFmpegUtils::StreamCompliance FFmpegUtils::checkCompliance(const MediaInfo &info, const TranscodeParams &params)
+{
+    StreamCompliance result;
+
+    // 视频：编码格式、分辨率、帧率、像素格式、档次和色彩标注都符合目标
+    if (info.hasVideo())
+    {
+        QString expectedCodec = (params.videoCodec == H265) ? "hevc" : (params.videoCodec == H264) ? "h264" : QString();
+        QSize resolution = (params.resolutionPreset == RESOLUTION_CUSTOM) ? params.customResolution
+                                                                          : resolutionPresetToSize(params.resolutionPreset);
+
+        bool codecOk = !expectedCodec.isEmpty() && info.videoCodec == expectedCodec;
+        bool sizeOk = info.width == resolution.width() && info.height == resolution.height();
+        bool rateOk = params.frameRate <= 0 || qAbs(info.frameRate - params.frameRate) < 0.01;
+        bool pixelOk = params.pixelFormat.isEmpty() || info.pixelFormat == params.pixelFormat;
+        bool profileOk = params.videoCodec != H264 || params.profile.isEmpty() ||
+                         (h264ProfileRank(info.videoProfile) > 0 &&
+                          h264ProfileRank(info.videoProfile) <= h264ProfileRank(params.profile));
+
+        // 重新编码时总是写入目标色彩标注（见 buildTranscodeCommand），标注不同或未标注的源直接复制会与其它输出不一致
+        bool colorOk = params.colorSpace.isEmpty() ||
+                       (info.colorSpace == params.colorSpace && info.colorPrimaries == params.colorSpace &&
+                        info.colorTransfer == params.colorSpace && info.colorRange == "tv");
+
+        result.video = codecOk && sizeOk && rateOk && pixelOk && profileOk && colorOk;
+    }
+
+    // 音频：编码格式一致且码率不高于目标（未知码率视为符合）
+    if (info.hasAudio())
+    {
+        bool codecOk = info.audioCodec == audioCodecToString(params.audioCodec) ||
+                       (params.audioCodec == MP3 && info.audioCodec == "mp3");
+        bool bitrateOk = params.audioBitrate <= 0 || info.audioBitrate <= 0 ||
+                         info.audioBitrate <= params.audioBitrate * 1000 * 11 / 10;
+
+        result.audio = codecOk && bitrateOk;
+    }
+
+    return result;
+}
+
+QString FFmpegUtils::buildSyntheticClipCommand(const QString &targetPath,
+                                               SyntheticPattern pattern,
+                                               const QSize &size,
+                                               int durationSec,
+                                               int frameRate)
+{
+    QString sizeArg = QString("%1x%2").arg(size.width()).arg(size.height());
+    QString source = (pattern == PATTERN_MANDELBROT)
+                         ? QString("mandelbrot=size=%1:rate=%2").arg(sizeArg).arg(frameRate)
+                         : QString("testsrc2=size=%1:rate=%2").arg(sizeArg).arg(frameRate);
+
+    QStringList args;
+    args << "ffmpeg" << "-y" << "-nostats";
+    args << "-f" << "lavfi" << "-i" << source;
+    args << "-f" << "lavfi" << "-i" << "sine=frequency=440:sample_rate=48000";
+    args << "-t" << QString::number(durationSec);
+    args << "-map" << "0:v:0" << "-map" << "1:a:0";
+    args << "-vf" << "noise=alls=12:allf=t:all_seed=20240101,format=yuv420p";
+
+    // 高质量单线程编码作为"源"，避免源本身的压缩损失影响测试结果
+    args << "-c:v" << "libx264" << "-preset" << "ultrafast" << "-crf" << "12" << "-threads" << "1";
+    args << "-c:a" << "aac" << "-b:a" << "128k";
+    args << "-fflags" << "+bitexact" << "-flags:v" << "+bitexact" << "-flags:a" << "+bitexact";
+    args << "-map_metadata" << "-1";
+    args << escapeFilePath(targetPath);
+
+    return args.join(" ");
+}
+
 bool FFmpegUtils::isFFmpegAvailable()
 {
     QProcess process;
@@ -117,6 +505,196 @@ bool FFmpegUtils::isFFmpegAvailable()
     return process.exitCode() == 0;
 }
 
+QString FFmpegUtils::ffmpegVersion()
+{
+    QProcess process;
+    process.start("ffmpeg", QStringList() << "-version");
+    if (!process.waitForFinished(3000) || process.exitCode() != 0)
+    {
+        return QString();
+    }
+
+    return QString::fromUtf8(process.readAllStandardOutput()).section('\n', 0, 0).trimmed();
+}
+
+FFmpegUtils::MediaInfo FFmpegUtils::probeMediaInfo(const QString &srcPath)
+{
+    QByteArray json = probeJson(srcPath);
+    return json.isEmpty() ? MediaInfo() : parseProbeOutput(json);
+}
+
+QStringList FFmpegUtils::probeArguments(const QString &srcPath)
+{
+    return QStringList() << "-v" << "error"
+                         << "-print_format" << "json"
+                         << "-show_format"
+                         << "-show_streams"
+                         << "-show_chapters"
+                         << srcPath;
+}
+
+QByteArray FFmpegUtils::probeJson(const QString &srcPath)
+{
+    QProcess process;
+    process.start("ffprobe", probeArguments(srcPath));
+    if (!process.waitForFinished(10000) || process.exitCode() != 0)
+    {
+        qDebug() << QString::fromLocal8Bit("探测媒体信息失败:") << srcPath;
+        return QByteArray();
+    }
+
+    return process.readAllStandardOutput();
+}
+
+FFmpegUtils::MediaInfo FFmpegUtils::parseProbeOutput(const QByteArray &json)
+{
+    MediaInfo info;
+
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(json, &error);
+    if (error.error != QJsonParseError::NoError || !doc.isObject())
+    {
+        return info;
+    }
+
+    QJsonObject root = doc.object();
+    QJsonObject format = root["format"].toObject();
+    info.durationSec = format["duration"].toString().toDouble();
+    info.sizeBytes = format["size"].toString().toLongLong();
+    info.bitrate = format["bit_rate"].toString().toLongLong();
+
+    const QJsonArray streams = root["streams"].toArray();
+    for (const QJsonValue &value : streams)
+    {
+        QJsonObject stream = value.toObject();
+        QString type = stream["codec_type"].toString();
+
+        if (type == "video" && !info.hasVideo())
+        {
+            // 跳过封面图（attached_pic）
+            if (stream["disposition"].toObject()["attached_pic"].toInt() == 1)
+            {
+                continue;
+            }
+
+            info.videoCodec = stream["codec_name"].toString();
+            info.videoProfile = stream["profile"].toString();
+            info.pixelFormat = stream["pix_fmt"].toString();
+            info.width = stream["width"].toInt();
+            info.height = stream["height"].toInt();
+            info.videoBitrate = stream["bit_rate"].toString().toLongLong();
+
+            // avg_frame_rate 形如 "30000/1001"
+            QStringList rate = stream["avg_frame_rate"].toString().split('/');
+            if (rate.size() == 2 && rate[1].toDouble() > 0)
+            {
+                info.frameRate = rate[0].toDouble() / rate[1].toDouble();
+            }
+
+            // 未标注的色彩属性ffprobe输出为unknown或不输出，统一为空
+            auto colorTag = [&stream](const char *key)
+            {
+                QString value = stream.value(QLatin1String(key)).toString();
+                return (value == "unknown" || value == "unspecified") ? QString() : value;
+            };
+            info.colorRange = colorTag("color_range");
+            info.colorSpace = colorTag("color_space");
+            info.colorPrimaries = colorTag("color_primaries");
+            info.colorTransfer = colorTag("color_transfer");
+
+            if (info.durationSec <= 0)
+            {
+                info.durationSec = stream["duration"].toString().toDouble();
+            }
+        }
+        else if (type == "audio" && !info.hasAudio())
+        {
+            info.audioCodec = stream["codec_name"].toString();
+            info.audioBitrate = stream["bit_rate"].toString().toLongLong();
+        }
+    }
+
+    return info;
+}
+
+bool FFmpegUtils::parseProgressLine(const QString &line, ProgressInfo &info)
+{
+    int eqPos = line.indexOf('=');
+    if (eqPos <= 0)
+    {
+        return false;
+    }
+
+    QString key = line.left(eqPos).trimmed();
+    QString value = line.mid(eqPos + 1).trimmed();
+
+    if (key == "frame")
+    {
+        info.frame = value.toLongLong();
+    }
+    else if (key == "fps")
+    {
+        info.fps = value.toDouble();
+    }
+    else if (key == "out_time_us" || key == "out_time_ms")
+    {
+        // 注意：ffmpeg的out_time_ms实际单位也是微秒
+        bool ok = false;
+        qint64 us = value.toLongLong(&ok);
+        if (ok && us >= 0)
+        {
+            info.outTimeUs = us;
+        }
+    }
+    else if (key == "out_time")
+    {
+        // HH:MM:SS.micro，仅在没有数值字段时作为后备
+        QStringList parts = value.split(':');
+        if (parts.size() == 3 && info.outTimeUs == 0)
+        {
+            double seconds = parts[0].toInt() * 3600.0 + parts[1].toInt() * 60.0 + parts[2].toDouble();
+            info.outTimeUs = static_cast<qint64>(seconds * 1000000.0);
+        }
+    }
+    else if (key == "speed")
+    {
+        // 形如 "1.85x"，未知时为 "N/A"
+        QString speed = value;
+        speed.remove('x');
+        info.speed = speed.toDouble();
+    }
+    else if (key == "progress")
+    {
+        info.finished = (value == "end");
+        return true;
+    }
+
+    return false;
+}
+
+void FFmpegUtils::stopProcess(QProcess &process, int gracefulMs, int waitMs)
+{
+    if (process.state() == QProcess::NotRunning)
+    {
+        return;
+    }
+
+    // 先发送q，让ffmpeg正常收尾退出
+    process.write("q\n");
+    process.closeWriteChannel();
+    if (process.waitForFinished(gracefulMs))
+    {
+        return;
+    }
+
+    process.terminate();
+    if (!process.waitForFinished(waitMs))
+    {
+        process.kill();
+        process.waitForFinished(waitMs);
+    }
+}
+
 QString FFmpegUtils::videoCodecToString(VideoCodec codec)
 {
     switch (codec)
@@ -197,6 +775,20 @@ QSize FFmpegUtils::resolutionPresetToSize(ResolutionPreset preset)
     }
 }
 
+int FFmpegUtils::h264ProfileRank(const QString &profile)
+{
+    // ffprobe输出如 "High"、"Constrained Baseline"，设置中为小写
+    QString name = profile.toLower();
+    name.remove("constrained ");
+    if (name == "baseline")
+        return 1;
+    if (name == "main")
+        return 2;
+    if (name == "high")
+        return 3;
+    return 0;
+}
+
 QString FFmpegUtils::escapeFilePath(const QString &path)
 {
     // 在Windows上，如果路径包含空格，需要用引号包围
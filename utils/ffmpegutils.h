@@ -4,6 +4,9 @@
 #include <QString>
 #include <QStringList>
 #include <QSize>
+#include <QRect>
+
+class QProcess;
 
 /**
  * FFmpeg工具类
@@ -55,6 +58,31 @@ public:
         RESOLUTION_CUSTOM // 自定义分辨率
     };
 
+    // 源与目标宽高比不同时的缩放方式
+    enum ScaleMode
+    {
+        SCALE_STRETCH, // 直接拉伸到目标尺寸（-s WxH）
+        SCALE_FIT,     // 保持比例缩放到目标框内，输出尺寸可能小于目标
+        SCALE_FILL,    // 保持比例铺满目标，居中裁掉多余部分
+        SCALE_PAD      // 保持比例缩放到目标框内，居中补黑边
+    };
+
+    // 缩放算法（swscale flags），越靠后质量越好、越耗CPU
+    enum ScaleAlgorithm
+    {
+        SCALER_FAST_BILINEAR, // fast_bilinear
+        SCALER_BILINEAR,      // bilinear
+        SCALER_BICUBIC,       // bicubic（ffmpeg默认）
+        SCALER_LANCZOS        // lanczos
+    };
+
+    // 合成测试画面（基准测试用）
+    enum SyntheticPattern
+    {
+        PATTERN_TESTSRC,   // lavfi testsrc2
+        PATTERN_MANDELBROT // lavfi mandelbrot
+    };
+
     /**
      * 转码参数结构体
      */
@@ -72,14 +100,90 @@ public:
         QString colorSpace;     // 色彩空间
         QString pixelFormat;    // 像素格式
         QString profile;        // H.264 profile
+        bool progressOutput;    // 通过 -progress pipe:1 输出机器可读的进度
+        int threads;            // 解码/编码线程数（0=由ffmpeg自动决定）
+        bool audioEnabled;      // 是否输出音频（分段编码时为false）
+        bool copyVideo;         // 视频流直接复制（-c:v copy）
+        bool copyAudio;         // 音频流直接复制（-c:a copy）
+        ScaleMode scaleMode;    // 缩放方式
+        ScaleAlgorithm scaler;  // 缩放算法
 
         // 构造函数提供默认值
         TranscodeParams()
-            : videoCodec(H264), audioCodec(AAC), preset(MEDIUM), crf(23), frameRate(30), resolutionPreset(RESOLUTION_720P), customResolution(QSize(720, 1280)), audioBitrate(128), fastStart(true), colorSpace("bt709"), pixelFormat("yuv420p"), profile("high")
+            : videoCodec(H264), audioCodec(AAC), preset(MEDIUM), crf(23), frameRate(30), resolutionPreset(RESOLUTION_720P), customResolution(QSize(720, 1280)), audioBitrate(128), fastStart(true), colorSpace("bt709"), pixelFormat("yuv420p"), profile("high"), progressOutput(false), threads(0), audioEnabled(true), copyVideo(false), copyAudio(false), scaleMode(SCALE_PAD), scaler(SCALER_BICUBIC)
         {
         }
     };
 
+    /**
+     * ffmpeg -progress 输出的进度信息
+     */
+    struct ProgressInfo
+    {
+        qint64 outTimeUs = 0;  // 已输出的媒体时长（微秒）
+        qint64 frame = 0;      // 已编码帧数
+        double fps = 0.0;      // 当前编码帧率
+        double speed = 0.0;    // 相对实时的倍速
+        bool finished = false; // progress=end
+    };
+
+    /**
+     * ffprobe探测到的媒体信息（取第一路视频流和第一路音频流）
+     */
+    struct MediaInfo
+    {
+        double durationSec = 0.0; // 时长（秒）
+        qint64 sizeBytes = 0;     // 文件大小
+        qint64 bitrate = 0;       // 总比特率 (bps)
+        QString videoCodec;       // 如 h264/hevc
+        QString videoProfile;     // 如 High/Main
+        QString pixelFormat;      // 如 yuv420p
+        QString colorRange;       // tv/pc，未标注时为空
+        QString colorSpace;       // 矩阵系数，如 bt709/bt470bg，未标注时为空
+        QString colorPrimaries;   // 色域，如 bt709/bt2020
+        QString colorTransfer;    // 传输特性，如 bt709/smpte2084
+        int width = 0;
+        int height = 0;
+        double frameRate = 0.0;  // 平均帧率
+        qint64 videoBitrate = 0; // 视频比特率 (bps)
+        QString audioCodec;      // 如 aac
+        qint64 audioBitrate = 0; // 音频比特率 (bps)
+
+        bool isValid() const { return durationSec > 0; }
+        bool hasVideo() const { return !videoCodec.isEmpty(); }
+        bool hasAudio() const { return !audioCodec.isEmpty(); }
+    };
+
+    /**
+     * 源流是否已符合目标参数（符合时可直接复制流）
+     */
+    struct StreamCompliance
+    {
+        bool video = false;
+        bool audio = false;
+    };
+
+    /**
+     * 按缩放方式算出的几何关系（进程内引擎使用，与scale/crop/pad滤镜的结果一致）
+     */
+    struct ScaleGeometry
+    {
+        QSize frameSize;  // 编码帧尺寸
+        QRect sourceRect; // 参与缩放的源区域（fill时为居中裁剪后的区域）
+        QRect targetRect; // 缩放结果在编码帧中的位置（pad时居中）
+    };
+
+    /**
+     * 多码率输出中的一路（共用一次解码）
+     */
+    struct RenditionOutput
+    {
+        QString path;           // 目标文件路径
+        QSize size;             // 输出分辨率
+        int crf = 0;            // 0表示使用 TranscodeParams::crf
+        int maxBitrateKbps = 0; // 峰值码率上限（-maxrate），0表示不限制
+    };
+
 public:
     FFmpegUtils() = delete; // 工具类，禁止实例化
 
@@ -102,6 +206,19 @@ public:
      */
     static QString buildSimpleTranscodeCommand(const QString &srcPath, const QString &targetPath);
 
+    /**
+     * 构建一次解码、输出多个分辨率的命令
+     * 视频经 -filter_complex split 分成多路后各自缩放编码，音频为每个输出分别编码；
+     * 不支持流复制
+     * @param srcPath 源文件路径
+     * @param outputs 各路输出
+     * @param params 公共转码参数（忽略其中的分辨率和流复制设置）
+     * @return ffmpeg命令
+     */
+    static QString buildRenditionCommand(const QString &srcPath,
+                                         const QList<RenditionOutput> &outputs,
+                                         const TranscodeParams &params = TranscodeParams());
+
     /**
      * 构建视频压缩命令
      * @param srcPath 源文件路径
@@ -113,19 +230,159 @@ public:
                                         const QString &targetPath,
                                         int crf = 23);
 
+    /**
+     * 构建按关键帧切分视频流的命令（流复制，不含音频）
+     * @param srcPath 源文件路径
+     * @param outputPattern 分段输出文件模板，如 seg_%03d.mkv
+     * @param segmentSec 目标分段时长（秒），实际在其后的第一个关键帧处切分
+     * @return ffmpeg命令
+     */
+    static QString buildSegmentCommand(const QString &srcPath,
+                                       const QString &outputPattern,
+                                       double segmentSec);
+
+    /**
+     * 构建无损拼接分段视频并重新混入源音频的命令
+     * @param listPath concat分段列表文件
+     * @param audioSrcPath 提供音频的源文件
+     * @param targetPath 目标文件路径
+     * @param params 转码参数（使用其中的音频和faststart设置）
+     * @return ffmpeg命令
+     */
+    static QString buildConcatCommand(const QString &listPath,
+                                      const QString &audioSrcPath,
+                                      const QString &targetPath,
+                                      const TranscodeParams &params = TranscodeParams());
+
+    /**
+     * 构建生成合成测试片段的命令
+     * 画面叠加固定种子的时域噪声，使编码复杂度接近实拍素材；
+     * 使用单线程和bitexact输出，同一参数在同一ffmpeg版本下生成的文件逐字节一致
+     * @param targetPath 目标文件路径
+     * @param pattern 测试画面
+     * @param size 分辨率
+     * @param durationSec 时长（秒）
+     * @param frameRate 帧率
+     * @return ffmpeg命令
+     */
+    static QString buildSyntheticClipCommand(const QString &targetPath,
+                                             SyntheticPattern pattern,
+                                             const QSize &size,
+                                             int durationSec,
+                                             int frameRate = 30);
+
     /**
      * 检查ffmpeg是否可用
      * @return true 如果ffmpeg可执行
      */
     static bool isFFmpegAvailable();
 
-private:
-    // 辅助方法
+    // ffmpeg -version 的第一行，不可用时返回空字符串
+    static QString ffmpegVersion();
+
+    /**
+     * 使用ffprobe获取媒体信息
+     * @param srcPath 源文件路径
+     * @return 媒体信息，失败时 isValid() 为false
+     */
+    static MediaInfo probeMediaInfo(const QString &srcPath);
+
+    // ffprobe参数：JSON格式输出容器、流和章节信息（探测缓存和视频信息对话框共用同一份输出）
+    static QStringList probeArguments(const QString &srcPath);
+
+    /**
+     * 运行ffprobe并返回JSON输出
+     * @param srcPath 源文件路径
+     * @return ffprobe的标准输出，失败时返回空
+     */
+    static QByteArray probeJson(const QString &srcPath);
+
+    /**
+     * 解析 ffprobe -print_format json -show_format -show_streams 的输出
+     * @param json ffprobe的标准输出
+     * @return 媒体信息
+     */
+    static MediaInfo parseProbeOutput(const QByteArray &json);
+
+    /**
+     * 比较探测到的流参数和目标参数
+     * @param info 源媒体信息
+     * @param params 目标转码参数
+     * @return 视频/音频是否可直接复制
+     */
+    static StreamCompliance checkCompliance(const MediaInfo &info, const TranscodeParams &params);
+
+    /**
+     * 结束ffmpeg进程：先发送q正常收尾，超时后依次terminate、kill
+     * 必须在创建process的线程中调用
+     * @param process ffmpeg进程
+     * @param gracefulMs 发送q后的等待时间
+     * @param waitMs terminate/kill后的等待时间
+     */
+    static void stopProcess(QProcess &process, int gracefulMs = 2000, int waitMs = 2000);
+
+    /**
+     * 构建缩放滤镜，如 scale=720:1280:force_original_aspect_ratio=decrease:flags=bicubic,pad=720:1280:(ow-iw)/2:(oh-ih)/2,setsar=1
+     * @param size 目标尺寸
+     * @param mode 缩放方式
+     * @param scaler 缩放算法
+     * @return 可用于 -vf 或 -filter_complex 的滤镜链
+     */
+    static QString buildScaleFilter(const QSize &size, ScaleMode mode, ScaleAlgorithm scaler);
+
+    /**
+     * 计算缩放几何关系，所有尺寸和偏移取偶数以适配4:2:0色度采样
+     * @param source 源尺寸
+     * @param target 目标尺寸
+     * @param mode 缩放方式
+     * @return 编码帧尺寸、源区域和目标区域
+     */
+    static ScaleGeometry scaleGeometry(const QSize &source, const QSize &target, ScaleMode mode);
+
+    /**
+     * 目标分辨率不超过源分辨率：缩放方式会放大源画面时，按同样的宽高比缩小目标框，
+     * 使源画面以1:1（限制边）放入，尺寸取偶数
+     * @param source 源尺寸
+     * @param target 目标尺寸
+     * @param mode 缩放方式
+     * @return 限制后的目标尺寸
+     */
+    static QSize capResolution(const QSize &source, const QSize &target, ScaleMode mode);
+
+    /**
+     * 按探测到的源流参数限制输出：不放大分辨率、不提高帧率
+     * 帧率低于目标时改为沿用源帧率（frameRate=0，不再补帧）
+     * @param params 转码参数，就地修改
+     * @param info 源媒体信息，无效时不做限制
+     * @param noUpscale 是否限制分辨率
+     * @param noFrameRateIncrease 是否限制帧率
+     */
+    static void capToSource(TranscodeParams &params, const MediaInfo &info, bool noUpscale, bool noFrameRateIncrease);
+
+    // 缩放方式/算法与配置中名称的转换，无法识别时返回默认值（pad/bicubic）
+    static ScaleMode scaleModeFromString(const QString &name);
+    static ScaleAlgorithm scaleAlgorithmFromString(const QString &name);
+    static QString scaleAlgorithmToString(ScaleAlgorithm scaler);
+
+    // 参数枚举与ffmpeg名称之间的转换，进程内引擎按同样的名称查找编码器
     static QString videoCodecToString(VideoCodec codec);
     static QString audioCodecToString(AudioCodec codec);
     static QString qualityPresetToString(QualityPreset preset);
     static QSize resolutionPresetToSize(ResolutionPreset preset);
+
+    /**
+     * 解析一行 -progress 输出（key=value）
+     * @param line 输出行
+     * @param info 累积的进度信息
+     * @return true 如果该行结束了一个进度块（progress=continue/end）
+     */
+    static bool parseProgressLine(const QString &line, ProgressInfo &info);
+
+private:
+    // 辅助方法
     static QString escapeFilePath(const QString &path);
+    static void appendVideoEncodeArgs(QStringList &args, const TranscodeParams &params, bool scale = true);
+    static int h264ProfileRank(const QString &profile);
 };
 
 #endif // FFMPEGUTILS_H
\ No newline at end of file
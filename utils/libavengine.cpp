@@ -0,0 +1,991 @@
+﻿#include "libavengine.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+
+#ifdef TRANSCODER_WITH_LIBAV
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/audio_fifo.h>
+#include <libavutil/display.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/opt.h>
+#include <libavutil/pixdesc.h>
+#include <libswresample/swresample.h>
+#include <libswscale/swscale.h>
+}
+
+#include <cmath>
+
+namespace
+{
+    // 按ffmpeg命令行 -colorspace/-color_primaries/-color_trc 的写法解析色彩标记
+    void colorTagsFromName(const QString &name, AVColorPrimaries &primaries, AVColorTransferCharacteristic &trc, AVColorSpace &space)
+    {
+        if (name == "bt601")
+        {
+            primaries = AVCOL_PRI_SMPTE170M;
+            trc = AVCOL_TRC_SMPTE170M;
+            space = AVCOL_SPC_SMPTE170M;
+        }
+        else if (name == "bt2020")
+        {
+            primaries = AVCOL_PRI_BT2020;
+            trc = AVCOL_TRC_BT2020_10;
+            space = AVCOL_SPC_BT2020_NCL;
+        }
+        else
+        {
+            QByteArray utf8 = name.toUtf8();
+            int value = av_color_primaries_from_name(utf8.constData());
+            primaries = value >= 0 ? static_cast<AVColorPrimaries>(value) : AVCOL_PRI_UNSPECIFIED;
+            value = av_color_transfer_from_name(utf8.constData());
+            trc = value >= 0 ? static_cast<AVColorTransferCharacteristic>(value) : AVCOL_TRC_UNSPECIFIED;
+            value = av_color_space_from_name(utf8.constData());
+            space = value >= 0 ? static_cast<AVColorSpace>(value) : AVCOL_SPC_UNSPECIFIED;
+        }
+    }
+
+    // 编码器支持的第一个采样格式
+    AVSampleFormat preferredSampleFormat(const AVCodecContext *context, const AVCodec *codec)
+    {
+        const AVSampleFormat *formats = nullptr;
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(61, 13, 100)
+        int count = 0;
+        avcodec_get_supported_config(context, codec, AV_CODEC_CONFIG_SAMPLE_FORMAT, 0,
+                                     reinterpret_cast<const void **>(&formats), &count);
+#else
+        Q_UNUSED(context);
+        formats = codec->sample_fmts;
+#endif
+        return (formats && formats[0] != AV_SAMPLE_FMT_NONE) ? formats[0] : AV_SAMPLE_FMT_FLTP;
+    }
+
+    // 视频流的显示矩阵（手机竖拍素材常带旋转）
+    const uint8_t *displayMatrix(const AVStream *stream)
+    {
+#if LIBAVFORMAT_VERSION_MAJOR >= 61
+        const AVPacketSideData *sideData = av_packet_side_data_get(stream->codecpar->coded_side_data,
+                                                                   stream->codecpar->nb_coded_side_data,
+                                                                   AV_PKT_DATA_DISPLAYMATRIX);
+        return sideData ? sideData->data : nullptr;
+#else
+        return av_stream_get_side_data(const_cast<AVStream *>(stream), AV_PKT_DATA_DISPLAYMATRIX, nullptr);
+#endif
+    }
+
+    int swsFlagsFor(FFmpegUtils::ScaleAlgorithm scaler)
+    {
+        switch (scaler)
+        {
+        case FFmpegUtils::SCALER_FAST_BILINEAR:
+            return SWS_FAST_BILINEAR;
+        case FFmpegUtils::SCALER_BILINEAR:
+            return SWS_BILINEAR;
+        case FFmpegUtils::SCALER_LANCZOS:
+            return SWS_LANCZOS;
+        case FFmpegUtils::SCALER_BICUBIC:
+        default:
+            return SWS_BICUBIC;
+        }
+    }
+
+    // 各平面中坐标(x, y)处的数据指针，用于把缩放结果写到pad后的画面中间
+    void offsetPlanes(const AVFrame *frame, int x, int y, uint8_t *planes[4])
+    {
+        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(static_cast<AVPixelFormat>(frame->format));
+        bool offsetDone[4] = {false, false, false, false};
+        for (int i = 0; i < 4; ++i)
+        {
+            planes[i] = frame->data[i];
+        }
+
+        for (int c = 0; c < desc->nb_components; ++c)
+        {
+            int plane = desc->comp[c].plane;
+            if (offsetDone[plane] || !frame->data[plane])
+            {
+                continue;
+            }
+            bool chroma = (c == 1 || c == 2) && !(desc->flags & AV_PIX_FMT_FLAG_RGB);
+            int planeX = chroma ? (x >> desc->log2_chroma_w) : x;
+            int planeY = chroma ? (y >> desc->log2_chroma_h) : y;
+            planes[plane] = frame->data[plane] + planeY * frame->linesize[plane] + planeX * desc->comp[c].step;
+            offsetDone[plane] = true;
+        }
+    }
+
+    // 保证帧缓冲的尺寸和格式，不变时直接复用
+    int ensureVideoBuffer(AVFrame *frame, int width, int height, AVPixelFormat format)
+    {
+        if (frame->buf[0] && frame->width == width && frame->height == height && frame->format == format)
+        {
+            return av_frame_make_writable(frame);
+        }
+
+        av_frame_unref(frame);
+        frame->width = width;
+        frame->height = height;
+        frame->format = format;
+        return av_frame_get_buffer(frame, 0);
+    }
+}
+
+/**
+ * 单次转码的状态，析构时释放本次打开的全部上下文
+ */
+struct LibavEngine::Session
+{
+    const FFmpegUtils::TranscodeParams *params = nullptr;
+    const LibavEngine::ProgressCallback *onProgress = nullptr;
+
+    AVFormatContext *input = nullptr;
+    AVFormatContext *output = nullptr;
+    int videoIn = -1; // 输入视频流索引
+    int audioIn = -1; // 输入音频流索引（不输出音频时为-1）
+
+    AVCodecContext *videoDecoder = nullptr;
+    AVCodecContext *audioDecoder = nullptr;
+    AVCodecContext *videoEncoder = nullptr;
+    AVCodecContext *audioEncoder = nullptr;
+    AVStream *videoOut = nullptr;
+    AVStream *audioOut = nullptr;
+
+    AVAudioFifo *audioFifo = nullptr; // 重采样后的音频按编码器帧长切分
+    AVFrame *audioFrame = nullptr;
+    int64_t audioPts = 0;
+
+    FFmpegUtils::ScaleGeometry geometry; // 缩放方式对应的裁剪/补边区域
+    QSize sourceSize;                    // 计算geometry时的源尺寸
+    int swsFlags = SWS_BICUBIC;
+
+    bool constantFrameRate = false;        // 按目标帧率丢帧/补帧（对应 -r）
+    int64_t originTs = AV_NOPTS_VALUE;     // 第一帧的时间戳，输出从0开始
+    int64_t lastInputTs = AV_NOPTS_VALUE;  // 上一帧的输入时间戳
+    int64_t nextVideoPts = 0;              // 编码器时间基下的下一帧
+    int64_t lastVideoPts = AV_NOPTS_VALUE; // 上一帧的输出时间戳
+
+    QElapsedTimer timer;
+    qint64 outTimeUs = 0;
+
+    ~Session()
+    {
+        avcodec_free_context(&videoDecoder);
+        avcodec_free_context(&audioDecoder);
+        avcodec_free_context(&videoEncoder);
+        avcodec_free_context(&audioEncoder);
+        av_frame_free(&audioFrame);
+        if (audioFifo)
+        {
+            av_audio_fifo_free(audioFifo);
+        }
+        avformat_close_input(&input);
+        if (output)
+        {
+            if (!(output->oformat->flags & AVFMT_NOFILE))
+            {
+                avio_closep(&output->pb);
+            }
+            avformat_free_context(output);
+        }
+    }
+};
+
+LibavEngine::LibavEngine()
+{
+    m_decoded = av_frame_alloc();
+    m_scaled = av_frame_alloc();
+    m_resampled = av_frame_alloc();
+    m_packet = av_packet_alloc();
+    m_encoded = av_packet_alloc();
+}
+
+LibavEngine::~LibavEngine()
+{
+    sws_freeContext(m_sws);
+    swr_free(&m_swr);
+    av_frame_free(&m_decoded);
+    av_frame_free(&m_scaled);
+    av_frame_free(&m_resampled);
+    av_packet_free(&m_packet);
+    av_packet_free(&m_encoded);
+}
+
+bool LibavEngine::isAvailable()
+{
+    return true;
+}
+
+QString LibavEngine::version()
+{
+    return QString("FFmpeg %1").arg(QString::fromUtf8(av_version_info()));
+}
+
+bool LibavEngine::transcode(const QString &srcPath,
+                            const QString &targetPath,
+                            const FFmpegUtils::TranscodeParams &params,
+                            const ProgressCallback &onProgress,
+                            const CancelCallback &isCancelled)
+{
+    m_error.clear();
+    m_frames = 0;
+    m_fallback = false;
+
+    bool success = false;
+    {
+        Session session;
+        session.params = &params;
+        session.onProgress = &onProgress;
+        session.timer.start();
+
+        success = openInput(session, srcPath) &&
+                  openOutput(session, targetPath) &&
+                  openVideoEncoder(session, params) &&
+                  openAudioEncoder(session, params) &&
+                  writeHeader(session, targetPath, params);
+
+        // 解复用 -> 解码 -> 缩放/重采样 -> 编码 -> 复用
+        while (success)
+        {
+            if (isCancelled && isCancelled())
+            {
+                success = fail(QString::fromLocal8Bit("转码已取消"));
+                break;
+            }
+
+            int ret = av_read_frame(session.input, m_packet);
+            if (ret == AVERROR_EOF)
+            {
+                break;
+            }
+            if (ret < 0)
+            {
+                success = fail(QString::fromLocal8Bit("读取输入失败"), ret);
+                break;
+            }
+
+            if (m_packet->stream_index == session.videoIn)
+            {
+                success = params.copyVideo ? copyPacket(session, m_packet) : decodeVideo(session, m_packet);
+            }
+            else if (m_packet->stream_index == session.audioIn)
+            {
+                success = params.copyAudio ? copyPacket(session, m_packet) : decodeAudio(session, m_packet);
+            }
+            av_packet_unref(m_packet);
+        }
+
+        // 依次冲刷解码器、重采样器和编码器中缓存的数据
+        if (success && !params.copyVideo)
+        {
+            success = decodeVideo(session, nullptr) && encodeVideoFrame(session, nullptr);
+        }
+        if (success && session.audioEncoder)
+        {
+            success = decodeAudio(session, nullptr) && drainAudioFifo(session, true) && encodeAudioFrame(session, nullptr);
+        }
+        if (success)
+        {
+            int ret = av_write_trailer(session.output);
+            success = ret >= 0 || fail(QString::fromLocal8Bit("写入文件尾失败"), ret);
+        }
+
+        av_packet_unref(m_packet);
+        av_frame_unref(m_decoded);
+        av_frame_unref(m_resampled);
+    }
+
+    // 会话析构后输出文件已关闭，失败时删除未完成的输出
+    if (!success && QFile::exists(targetPath) && !QFile::remove(targetPath))
+    {
+        qDebug() << QString::fromLocal8Bit("删除临时文件失败:") << targetPath;
+    }
+    return success;
+}
+
+bool LibavEngine::openInput(Session &session, const QString &srcPath)
+{
+    int ret = avformat_open_input(&session.input, srcPath.toUtf8().constData(), nullptr, nullptr);
+    if (ret < 0)
+    {
+        return fail(QString::fromLocal8Bit("无法打开输入文件"), ret);
+    }
+
+    ret = avformat_find_stream_info(session.input, nullptr);
+    if (ret < 0)
+    {
+        return fail(QString::fromLocal8Bit("无法读取流信息"), ret);
+    }
+
+    session.videoIn = av_find_best_stream(session.input, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (session.videoIn < 0)
+    {
+        return fail(QString::fromLocal8Bit("未找到视频流"));
+    }
+    if (session.params->audioEnabled)
+    {
+        session.audioIn = qMax(-1, av_find_best_stream(session.input, AVMEDIA_TYPE_AUDIO, -1, session.videoIn, nullptr, 0));
+    }
+
+    // 命令行ffmpeg会按显示矩阵自动旋转，这里不实现，交回进程处理
+    AVStream *videoStream = session.input->streams[session.videoIn];
+    const uint8_t *matrix = displayMatrix(videoStream);
+    if (!session.params->copyVideo && matrix)
+    {
+        double rotation = av_display_rotation_get(reinterpret_cast<const int32_t *>(matrix));
+        if (!std::isnan(rotation) && static_cast<int>(std::lround(rotation)) % 360 != 0)
+        {
+            m_fallback = true;
+            return fail(QString::fromLocal8Bit("源视频带旋转信息"));
+        }
+    }
+
+    // 需要重新编码的流才打开解码器
+    auto openDecoder = [this, &session](int streamIndex, AVCodecContext *&decoder) -> bool
+    {
+        AVStream *stream = session.input->streams[streamIndex];
+        const AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
+        if (!codec)
+        {
+            m_fallback = true;
+            return fail(QString::fromLocal8Bit("缺少解码器: %1").arg(avcodec_get_name(stream->codecpar->codec_id)));
+        }
+
+        decoder = avcodec_alloc_context3(codec);
+        int ret = avcodec_parameters_to_context(decoder, stream->codecpar);
+        if (ret < 0)
+        {
+            return fail(QString::fromLocal8Bit("复制解码参数失败"), ret);
+        }
+        decoder->pkt_timebase = stream->time_base;
+        decoder->thread_count = session.params->threads;
+
+        ret = avcodec_open2(decoder, codec, nullptr);
+        return ret >= 0 || fail(QString::fromLocal8Bit("无法打开解码器"), ret);
+    };
+
+    if (!session.params->copyVideo && !openDecoder(session.videoIn, session.videoDecoder))
+    {
+        return false;
+    }
+    if (session.audioIn >= 0 && !session.params->copyAudio && !openDecoder(session.audioIn, session.audioDecoder))
+    {
+        return false;
+    }
+    return true;
+}
+
+bool LibavEngine::openOutput(Session &session, const QString &targetPath)
+{
+    int ret = avformat_alloc_output_context2(&session.output, nullptr, nullptr, targetPath.toUtf8().constData());
+    if (ret < 0 || !session.output)
+    {
+        return fail(QString::fromLocal8Bit("无法识别输出格式"), ret);
+    }
+    return true;
+}
+
+bool LibavEngine::openVideoEncoder(Session &session, const FFmpegUtils::TranscodeParams &params)
+{
+    AVStream *inStream = session.input->streams[session.videoIn];
+    session.videoOut = avformat_new_stream(session.output, nullptr);
+    if (!session.videoOut)
+    {
+        return fail(QString::fromLocal8Bit("无法创建视频流"));
+    }
+
+    // 流复制：只搬运编码参数，时间基在写包时换算
+    if (params.copyVideo)
+    {
+        int ret = avcodec_parameters_copy(session.videoOut->codecpar, inStream->codecpar);
+        if (ret < 0)
+        {
+            return fail(QString::fromLocal8Bit("复制视频参数失败"), ret);
+        }
+        session.videoOut->codecpar->codec_tag = 0;
+        session.videoOut->time_base = inStream->time_base;
+        return true;
+    }
+
+    QByteArray codecName = FFmpegUtils::videoCodecToString(params.videoCodec).toUtf8();
+    const AVCodec *codec = avcodec_find_encoder_by_name(codecName.constData());
+    if (!codec)
+    {
+        m_fallback = true;
+        return fail(QString::fromLocal8Bit("缺少编码器: %1").arg(QString::fromUtf8(codecName)));
+    }
+
+    AVCodecContext *encoder = avcodec_alloc_context3(codec);
+    session.videoEncoder = encoder;
+
+    QSize size = (params.resolutionPreset == FFmpegUtils::RESOLUTION_CUSTOM) ? params.customResolution
+                                                                            : FFmpegUtils::resolutionPresetToSize(params.resolutionPreset);
+    QSize sourceSize(session.videoDecoder->width, session.videoDecoder->height);
+    session.geometry = FFmpegUtils::scaleGeometry(sourceSize, size, params.scaleMode);
+    session.sourceSize = sourceSize;
+    session.swsFlags = swsFlagsFor(params.scaler);
+    encoder->width = session.geometry.frameSize.width();
+    encoder->height = session.geometry.frameSize.height();
+
+    AVPixelFormat pixelFormat = params.pixelFormat.isEmpty() ? AV_PIX_FMT_NONE : av_get_pix_fmt(params.pixelFormat.toUtf8().constData());
+    encoder->pix_fmt = (pixelFormat != AV_PIX_FMT_NONE) ? pixelFormat : session.videoDecoder->pix_fmt;
+
+    // 拉伸时与scale滤镜相同，调整采样宽高比以保持显示比例；其它方式已保持比例，与setsar=1一致
+    if (params.scaleMode == FFmpegUtils::SCALE_STRETCH)
+    {
+        AVRational inputSar = av_guess_sample_aspect_ratio(session.input, inStream, nullptr);
+        if (inputSar.num <= 0 || inputSar.den <= 0)
+        {
+            inputSar = AVRational{1, 1};
+        }
+        encoder->sample_aspect_ratio = av_mul_q(AVRational{encoder->height * session.videoDecoder->width,
+                                                           encoder->width * session.videoDecoder->height},
+                                                inputSar);
+    }
+    else
+    {
+        encoder->sample_aspect_ratio = AVRational{1, 1};
+    }
+
+    // 指定帧率时输出恒定帧率，否则沿用源时间戳
+    session.constantFrameRate = params.frameRate > 0;
+    if (session.constantFrameRate)
+    {
+        encoder->framerate = AVRational{params.frameRate, 1};
+        encoder->time_base = av_inv_q(encoder->framerate);
+    }
+    else
+    {
+        encoder->framerate = av_guess_frame_rate(session.input, inStream, nullptr);
+        encoder->time_base = inStream->time_base;
+    }
+
+    if (!params.colorSpace.isEmpty())
+    {
+        colorTagsFromName(params.colorSpace, encoder->color_primaries, encoder->color_trc, encoder->colorspace);
+        encoder->color_range = AVCOL_RANGE_MPEG;
+    }
+
+    if (session.output->oformat->flags & AVFMT_GLOBALHEADER)
+    {
+        encoder->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+
+    // 与命令行参数一一对应，线程限制同样要传给x264/x265自己的线程池
+    AVDictionary *options = nullptr;
+    encoder->thread_count = params.threads;
+    if (params.videoCodec == FFmpegUtils::H264 || params.videoCodec == FFmpegUtils::H265)
+    {
+        av_dict_set_int(&options, "crf", params.crf, 0);
+        av_dict_set(&options, "preset", FFmpegUtils::qualityPresetToString(params.preset).toUtf8().constData(), 0);
+    }
+    if (params.threads > 0 && params.videoCodec == FFmpegUtils::H264)
+    {
+        av_dict_set(&options, "x264-params", QString("threads=%1").arg(params.threads).toUtf8().constData(), 0);
+    }
+    else if (params.threads > 0 && params.videoCodec == FFmpegUtils::H265)
+    {
+        av_dict_set(&options, "x265-params", QString("pools=%1").arg(params.threads).toUtf8().constData(), 0);
+    }
+    if (params.videoCodec == FFmpegUtils::H264 && !params.profile.isEmpty())
+    {
+        av_dict_set(&options, "profile", params.profile.toUtf8().constData(), 0);
+    }
+
+    int ret = avcodec_open2(encoder, codec, &options);
+    av_dict_free(&options);
+    if (ret < 0)
+    {
+        return fail(QString::fromLocal8Bit("无法打开视频编码器"), ret);
+    }
+
+    ret = avcodec_parameters_from_context(session.videoOut->codecpar, encoder);
+    if (ret < 0)
+    {
+        return fail(QString::fromLocal8Bit("复制视频编码参数失败"), ret);
+    }
+    session.videoOut->time_base = encoder->time_base;
+    session.videoOut->avg_frame_rate = encoder->framerate;
+    return true;
+}
+
+bool LibavEngine::openAudioEncoder(Session &session, const FFmpegUtils::TranscodeParams &params)
+{
+    if (session.audioIn < 0)
+    {
+        return true;
+    }
+
+    AVStream *inStream = session.input->streams[session.audioIn];
+    session.audioOut = avformat_new_stream(session.output, nullptr);
+    if (!session.audioOut)
+    {
+        return fail(QString::fromLocal8Bit("无法创建音频流"));
+    }
+
+    if (params.copyAudio)
+    {
+        int ret = avcodec_parameters_copy(session.audioOut->codecpar, inStream->codecpar);
+        if (ret < 0)
+        {
+            return fail(QString::fromLocal8Bit("复制音频参数失败"), ret);
+        }
+        session.audioOut->codecpar->codec_tag = 0;
+        session.audioOut->time_base = inStream->time_base;
+        return true;
+    }
+
+    QByteArray codecName = FFmpegUtils::audioCodecToString(params.audioCodec).toUtf8();
+    const AVCodec *codec = avcodec_find_encoder_by_name(codecName.constData());
+    if (!codec)
+    {
+        m_fallback = true;
+        return fail(QString::fromLocal8Bit("缺少编码器: %1").arg(QString::fromUtf8(codecName)));
+    }
+
+    AVCodecContext *decoder = session.audioDecoder;
+    AVCodecContext *encoder = avcodec_alloc_context3(codec);
+    session.audioEncoder = encoder;
+
+    // 保持源采样率和声道数；Opus只支持48kHz
+    encoder->sample_rate = (params.audioCodec == FFmpegUtils::OPUS) ? 48000 : decoder->sample_rate;
+    encoder->sample_fmt = preferredSampleFormat(encoder, codec);
+    if (decoder->ch_layout.order == AV_CHANNEL_ORDER_UNSPEC)
+    {
+        av_channel_layout_default(&encoder->ch_layout, decoder->ch_layout.nb_channels);
+    }
+    else
+    {
+        av_channel_layout_copy(&encoder->ch_layout, &decoder->ch_layout);
+    }
+    encoder->bit_rate = static_cast<int64_t>(params.audioBitrate) * 1000;
+    encoder->time_base = AVRational{1, encoder->sample_rate};
+    if (session.output->oformat->flags & AVFMT_GLOBALHEADER)
+    {
+        encoder->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+
+    int ret = avcodec_open2(encoder, codec, nullptr);
+    if (ret < 0)
+    {
+        return fail(QString::fromLocal8Bit("无法打开音频编码器"), ret);
+    }
+    ret = avcodec_parameters_from_context(session.audioOut->codecpar, encoder);
+    if (ret < 0)
+    {
+        return fail(QString::fromLocal8Bit("复制音频编码参数失败"), ret);
+    }
+    session.audioOut->time_base = encoder->time_base;
+
+    // 重采样器在多次转码之间复用，只重新设置参数
+    ret = swr_alloc_set_opts2(&m_swr,
+                              &encoder->ch_layout, encoder->sample_fmt, encoder->sample_rate,
+                              &decoder->ch_layout, decoder->sample_fmt, decoder->sample_rate,
+                              0, nullptr);
+    if (ret < 0 || (ret = swr_init(m_swr)) < 0)
+    {
+        return fail(QString::fromLocal8Bit("无法初始化音频重采样"), ret);
+    }
+
+    // 可变帧长的编码器按1024个采样一帧送入
+    int frameSize = encoder->frame_size > 0 ? encoder->frame_size : 1024;
+    session.audioFifo = av_audio_fifo_alloc(encoder->sample_fmt, encoder->ch_layout.nb_channels, frameSize);
+    session.audioFrame = av_frame_alloc();
+    session.audioFrame->format = encoder->sample_fmt;
+    session.audioFrame->sample_rate = encoder->sample_rate;
+    session.audioFrame->nb_samples = frameSize;
+    av_channel_layout_copy(&session.audioFrame->ch_layout, &encoder->ch_layout);
+    ret = av_frame_get_buffer(session.audioFrame, 0);
+    if (!session.audioFifo || ret < 0)
+    {
+        return fail(QString::fromLocal8Bit("无法分配音频缓冲"), ret);
+    }
+    return true;
+}
+
+bool LibavEngine::writeHeader(Session &session, const QString &targetPath, const FFmpegUtils::TranscodeParams &params)
+{
+    if (!(session.output->oformat->flags & AVFMT_NOFILE))
+    {
+        int ret = avio_open(&session.output->pb, targetPath.toUtf8().constData(), AVIO_FLAG_WRITE);
+        if (ret < 0)
+        {
+            return fail(QString::fromLocal8Bit("无法创建输出文件"), ret);
+        }
+    }
+
+    // 非MP4容器不认识movflags，选项会被忽略
+    AVDictionary *options = nullptr;
+    if (params.fastStart)
+    {
+        av_dict_set(&options, "movflags", "faststart", 0);
+    }
+    int ret = avformat_write_header(session.output, &options);
+    av_dict_free(&options);
+    if (ret < 0)
+    {
+        return fail(QString::fromLocal8Bit("写入文件头失败"), ret);
+    }
+    return true;
+}
+
+bool LibavEngine::decodeVideo(Session &session, AVPacket *packet)
+{
+    int ret = avcodec_send_packet(session.videoDecoder, packet);
+    if (ret < 0 && ret != AVERROR_EOF)
+    {
+        return fail(QString::fromLocal8Bit("视频解码失败"), ret);
+    }
+
+    AVCodecContext *encoder = session.videoEncoder;
+    AVRational inputTimeBase = session.input->streams[session.videoIn]->time_base;
+
+    while ((ret = avcodec_receive_frame(session.videoDecoder, m_decoded)) >= 0)
+    {
+        int64_t ts = m_decoded->best_effort_timestamp;
+        if (ts == AV_NOPTS_VALUE)
+        {
+            ts = (session.lastInputTs == AV_NOPTS_VALUE) ? 0 : session.lastInputTs + 1;
+        }
+        if (session.originTs == AV_NOPTS_VALUE)
+        {
+            session.originTs = ts;
+        }
+        session.lastInputTs = ts;
+
+        // 恒定帧率下落后的帧直接丢弃，不做缩放
+        int64_t target = av_rescale_q_rnd(ts - session.originTs, inputTimeBase, encoder->time_base,
+                                          static_cast<AVRounding>(AV_ROUND_NEAR_INF | AV_ROUND_PASS_MINMAX));
+        if (session.constantFrameRate && target < session.nextVideoPts)
+        {
+            av_frame_unref(m_decoded);
+            continue;
+        }
+
+        // 源尺寸在流中途变化时按新尺寸重新计算，仍输出相同的编码帧尺寸
+        QRect sourceRect = session.geometry.sourceRect;
+        QRect targetRect = session.geometry.targetRect;
+        QSize frameSize(m_decoded->width, m_decoded->height);
+        if (frameSize != session.sourceSize)
+        {
+            // fit的编码帧尺寸已固定，新尺寸按pad放入
+            FFmpegUtils::ScaleMode mode = session.params->scaleMode == FFmpegUtils::SCALE_FIT ? FFmpegUtils::SCALE_PAD : session.params->scaleMode;
+            FFmpegUtils::ScaleGeometry geometry = FFmpegUtils::scaleGeometry(frameSize, QSize(encoder->width, encoder->height), mode);
+            sourceRect = geometry.sourceRect;
+            targetRect = geometry.targetRect;
+        }
+
+        // fill：裁掉源画面两侧（或上下）超出目标比例的部分
+        m_decoded->crop_left = sourceRect.x();
+        m_decoded->crop_top = sourceRect.y();
+        m_decoded->crop_right = m_decoded->width - sourceRect.x() - sourceRect.width();
+        m_decoded->crop_bottom = m_decoded->height - sourceRect.y() - sourceRect.height();
+        ret = av_frame_apply_cropping(m_decoded, AV_FRAME_CROP_UNALIGNED);
+        if (ret < 0)
+        {
+            av_frame_unref(m_decoded);
+            return fail(QString::fromLocal8Bit("裁剪失败"), ret);
+        }
+
+        // 缩放上下文在源尺寸、目标区域和格式不变时直接复用
+        m_sws = sws_getCachedContext(m_sws,
+                                     m_decoded->width, m_decoded->height, static_cast<AVPixelFormat>(m_decoded->format),
+                                     targetRect.width(), targetRect.height(), encoder->pix_fmt,
+                                     session.swsFlags, nullptr, nullptr, nullptr);
+        if (!m_sws)
+        {
+            av_frame_unref(m_decoded);
+            return fail(QString::fromLocal8Bit("无法初始化缩放"));
+        }
+
+        // 编码器可能仍引用上一帧的缓冲，写入前确保可写
+        ret = ensureVideoBuffer(m_scaled, encoder->width, encoder->height, encoder->pix_fmt);
+        if (ret < 0)
+        {
+            av_frame_unref(m_decoded);
+            return fail(QString::fromLocal8Bit("无法分配视频缓冲"), ret);
+        }
+
+        // pad：先整帧填黑，再把缩放结果写到中间
+        uint8_t *planes[4];
+        if (targetRect.size() != QSize(encoder->width, encoder->height))
+        {
+            ptrdiff_t linesizes[4];
+            for (int i = 0; i < 4; ++i)
+            {
+                linesizes[i] = m_scaled->linesize[i];
+            }
+            av_image_fill_black(m_scaled->data, linesizes, encoder->pix_fmt, AVCOL_RANGE_MPEG, encoder->width, encoder->height);
+        }
+        offsetPlanes(m_scaled, targetRect.x(), targetRect.y(), planes);
+        sws_scale(m_sws, m_decoded->data, m_decoded->linesize, 0, m_decoded->height, planes, m_scaled->linesize);
+        m_scaled->sample_aspect_ratio = encoder->sample_aspect_ratio;
+        av_frame_unref(m_decoded);
+
+        if (session.constantFrameRate)
+        {
+            // 时间戳跳跃处重复当前帧补齐
+            while (session.nextVideoPts <= target)
+            {
+                m_scaled->pts = session.nextVideoPts++;
+                if (!encodeVideoFrame(session, m_scaled))
+                {
+                    return false;
+                }
+            }
+        }
+        else
+        {
+            m_scaled->pts = (session.lastVideoPts != AV_NOPTS_VALUE && target <= session.lastVideoPts) ? session.lastVideoPts + 1 : target;
+            if (!encodeVideoFrame(session, m_scaled))
+            {
+                return false;
+            }
+        }
+        session.lastVideoPts = m_scaled->pts;
+    }
+
+    if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+    {
+        return fail(QString::fromLocal8Bit("视频解码失败"), ret);
+    }
+    return true;
+}
+
+bool LibavEngine::decodeAudio(Session &session, AVPacket *packet)
+{
+    int ret = avcodec_send_packet(session.audioDecoder, packet);
+    if (ret < 0 && ret != AVERROR_EOF)
+    {
+        return fail(QString::fromLocal8Bit("音频解码失败"), ret);
+    }
+
+    auto convert = [this, &session](AVFrame *input) -> bool
+    {
+        AVCodecContext *encoder = session.audioEncoder;
+        av_frame_unref(m_resampled);
+        m_resampled->format = encoder->sample_fmt;
+        m_resampled->sample_rate = encoder->sample_rate;
+        av_channel_layout_copy(&m_resampled->ch_layout, &encoder->ch_layout);
+
+        int ret = swr_convert_frame(m_swr, m_resampled, input);
+        if (ret < 0)
+        {
+            return fail(QString::fromLocal8Bit("音频重采样失败"), ret);
+        }
+        if (m_resampled->nb_samples > 0 &&
+            av_audio_fifo_write(session.audioFifo, reinterpret_cast<void **>(m_resampled->extended_data), m_resampled->nb_samples) < m_resampled->nb_samples)
+        {
+            return fail(QString::fromLocal8Bit("音频缓冲写入失败"));
+        }
+        return drainAudioFifo(session, false);
+    };
+
+    while ((ret = avcodec_receive_frame(session.audioDecoder, m_decoded)) >= 0)
+    {
+        bool converted = convert(m_decoded);
+        av_frame_unref(m_decoded);
+        if (!converted)
+        {
+            return false;
+        }
+    }
+
+    if (ret == AVERROR_EOF)
+    {
+        // 解码器已冲刷完，再取出重采样器中缓存的采样
+        return convert(nullptr);
+    }
+    if (ret != AVERROR(EAGAIN))
+    {
+        return fail(QString::fromLocal8Bit("音频解码失败"), ret);
+    }
+    return true;
+}
+
+bool LibavEngine::encodeVideoFrame(Session &session, AVFrame *frame)
+{
+    int ret = avcodec_send_frame(session.videoEncoder, frame);
+    if (ret < 0)
+    {
+        return fail(QString::fromLocal8Bit("视频编码失败"), ret);
+    }
+    return writePackets(session, true);
+}
+
+bool LibavEngine::encodeAudioFrame(Session &session, AVFrame *frame)
+{
+    int ret = avcodec_send_frame(session.audioEncoder, frame);
+    if (ret < 0)
+    {
+        return fail(QString::fromLocal8Bit("音频编码失败"), ret);
+    }
+    return writePackets(session, false);
+}
+
+bool LibavEngine::drainAudioFifo(Session &session, bool flush)
+{
+    AVFrame *frame = session.audioFrame;
+    int frameSize = session.audioEncoder->frame_size > 0 ? session.audioEncoder->frame_size : 1024;
+
+    while (av_audio_fifo_size(session.audioFifo) >= frameSize ||
+           (flush && av_audio_fifo_size(session.audioFifo) > 0))
+    {
+        int ret = av_frame_make_writable(frame);
+        if (ret < 0)
+        {
+            return fail(QString::fromLocal8Bit("无法分配音频缓冲"), ret);
+        }
+
+        // 最后不足一帧的采样按实际数量送入编码器
+        frame->nb_samples = qMin(frameSize, av_audio_fifo_size(session.audioFifo));
+        if (av_audio_fifo_read(session.audioFifo, reinterpret_cast<void **>(frame->data), frame->nb_samples) < frame->nb_samples)
+        {
+            return fail(QString::fromLocal8Bit("音频缓冲读取失败"));
+        }
+        frame->pts = session.audioPts;
+        session.audioPts += frame->nb_samples;
+
+        if (!encodeAudioFrame(session, frame))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LibavEngine::writePackets(Session &session, bool video)
+{
+    AVCodecContext *encoder = video ? session.videoEncoder : session.audioEncoder;
+    AVStream *stream = video ? session.videoOut : session.audioOut;
+
+    int ret;
+    while ((ret = avcodec_receive_packet(encoder, m_encoded)) >= 0)
+    {
+        av_packet_rescale_ts(m_encoded, encoder->time_base, stream->time_base);
+        m_encoded->stream_index = stream->index;
+
+        if (video)
+        {
+            m_frames++;
+            if (m_encoded->pts != AV_NOPTS_VALUE)
+            {
+                reportProgress(session, av_rescale_q(m_encoded->pts, stream->time_base, AV_TIME_BASE_Q));
+            }
+        }
+
+        ret = av_interleaved_write_frame(session.output, m_encoded);
+        if (ret < 0)
+        {
+            return fail(QString::fromLocal8Bit("写入输出失败"), ret);
+        }
+    }
+
+    if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+    {
+        return fail(QString::fromLocal8Bit("编码失败"), ret);
+    }
+    return true;
+}
+
+bool LibavEngine::copyPacket(Session &session, AVPacket *packet)
+{
+    bool video = packet->stream_index == session.videoIn;
+    AVStream *inStream = session.input->streams[packet->stream_index];
+    AVStream *outStream = video ? session.videoOut : session.audioOut;
+
+    av_packet_rescale_ts(packet, inStream->time_base, outStream->time_base);
+    packet->stream_index = outStream->index;
+    packet->pos = -1;
+
+    if (video)
+    {
+        m_frames++;
+        if (packet->pts != AV_NOPTS_VALUE)
+        {
+            reportProgress(session, av_rescale_q(packet->pts, outStream->time_base, AV_TIME_BASE_Q));
+        }
+    }
+
+    int ret = av_interleaved_write_frame(session.output, packet);
+    return ret >= 0 || fail(QString::fromLocal8Bit("写入输出失败"), ret);
+}
+
+void LibavEngine::reportProgress(Session &session, qint64 outTimeUs)
+{
+    // B帧使输出时间戳乱序，取已输出的最大值
+    session.outTimeUs = qMax(session.outTimeUs, outTimeUs);
+    if (!*session.onProgress)
+    {
+        return;
+    }
+
+    double elapsedSec = session.timer.elapsed() / 1000.0;
+    FFmpegUtils::ProgressInfo info;
+    info.outTimeUs = session.outTimeUs;
+    info.frame = m_frames;
+    info.fps = elapsedSec > 0 ? m_frames / elapsedSec : 0.0;
+    info.speed = elapsedSec > 0 ? session.outTimeUs / 1000000.0 / elapsedSec : 0.0;
+    (*session.onProgress)(info);
+}
+
+bool LibavEngine::fail(const QString &what, int averror)
+{
+    m_error = what;
+    if (averror < 0)
+    {
+        char buffer[AV_ERROR_MAX_STRING_SIZE] = {0};
+        av_strerror(averror, buffer, sizeof(buffer));
+        m_error += QString(": %1").arg(QString::fromUtf8(buffer));
+    }
+    qDebug() << QString::fromLocal8Bit("进程内转码失败:") << m_error;
+    return false;
+}
+
+#else // TRANSCODER_WITH_LIBAV
+
+// 未链接libav*时只保留接口，调用方据 isAvailable() 改用ffmpeg进程
+
+struct LibavEngine::Session
+{
+};
+
+LibavEngine::LibavEngine()
+{
+}
+
+LibavEngine::~LibavEngine()
+{
+}
+
+bool LibavEngine::isAvailable()
+{
+    return false;
+}
+
+QString LibavEngine::version()
+{
+    return QString();
+}
+
+bool LibavEngine::transcode(const QString &srcPath,
+                            const QString &targetPath,
+                            const FFmpegUtils::TranscodeParams &params,
+                            const ProgressCallback &onProgress,
+                            const CancelCallback &isCancelled)
+{
+    Q_UNUSED(srcPath);
+    Q_UNUSED(targetPath);
+    Q_UNUSED(params);
+    Q_UNUSED(onProgress);
+    Q_UNUSED(isCancelled);
+
+    m_fallback = true;
+    m_error = QString::fromLocal8Bit("未编译进程内转码引擎（TRANSCODER_WITH_LIBAV）");
+    return false;
+}
+
+#endif // TRANSCODER_WITH_LIBAV
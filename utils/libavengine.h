@@ -0,0 +1,99 @@
+﻿#ifndef LIBAVENGINE_H
+#define LIBAVENGINE_H
+
+#include <QString>
+#include <functional>
+#include "ffmpegutils.h"
+
+struct SwsContext;
+struct SwrContext;
+struct AVFrame;
+struct AVPacket;
+
+/**
+ * 进程内转码引擎
+ * 直接链接 libavformat/libavcodec/libswscale/libswresample 完成解码、缩放和编码，
+ * 省去每个任务启动ffmpeg进程、初始化和重复探测格式的固定开销，适合大量短视频。
+ * 参数语义与 FFmpegUtils::buildTranscodeCommand 生成的命令一致。
+ *
+ * 一个实例同一时间只能执行一个转码；缩放/重采样上下文和帧缓冲在多次转码之间复用，
+ * 因此每个工作线程持有一个实例（见 TranscodeTask）。
+ * 未定义 TRANSCODER_WITH_LIBAV 编译时 isAvailable() 返回false，transcode() 直接失败。
+ */
+class LibavEngine
+{
+public:
+    // 进度回调，在转码线程中调用，每写出一个视频包调用一次
+    using ProgressCallback = std::function<void(const FFmpegUtils::ProgressInfo &info)>;
+    // 取消检查，返回true时中止转码并删除未完成的输出
+    using CancelCallback = std::function<bool()>;
+
+public:
+    LibavEngine();
+    ~LibavEngine();
+
+    LibavEngine(const LibavEngine &) = delete;
+    LibavEngine &operator=(const LibavEngine &) = delete;
+
+    // 是否编译了进程内引擎
+    static bool isAvailable();
+
+    // 链接的libavcodec版本，不可用时返回空字符串
+    static QString version();
+
+    /**
+     * 转码一个文件
+     * @param srcPath 源文件路径
+     * @param targetPath 目标文件路径，容器格式由扩展名决定
+     * @param params 转码参数（忽略 progressOutput）
+     * @param onProgress 进度回调，可为空
+     * @param isCancelled 取消检查，可为空
+     * @return true 如果成功，失败时 errorString() 给出原因
+     */
+    bool transcode(const QString &srcPath,
+                   const QString &targetPath,
+                   const FFmpegUtils::TranscodeParams &params,
+                   const ProgressCallback &onProgress = ProgressCallback(),
+                   const CancelCallback &isCancelled = CancelCallback());
+
+    QString errorString() const { return m_error; }
+
+    // 最近一次转码写出的视频帧数
+    qint64 framesEncoded() const { return m_frames; }
+
+    // 最近一次失败是因为源文件需要引擎未实现的处理（如旋转）或缺少编码器，调用方应改用ffmpeg进程
+    bool needsFallback() const { return m_fallback; }
+
+private:
+    struct Session;
+
+    // 跨转码复用的上下文，参数不变时 sws_getCachedContext 直接返回原对象
+    SwsContext *m_sws = nullptr;
+    SwrContext *m_swr = nullptr;
+    AVFrame *m_decoded = nullptr;
+    AVFrame *m_scaled = nullptr;
+    AVFrame *m_resampled = nullptr;
+    AVPacket *m_packet = nullptr;  // 读取的输入包
+    AVPacket *m_encoded = nullptr; // 编码器输出的包
+
+    QString m_error;
+    qint64 m_frames = 0;
+    bool m_fallback = false;
+
+    bool openInput(Session &session, const QString &srcPath);
+    bool openVideoEncoder(Session &session, const FFmpegUtils::TranscodeParams &params);
+    bool openAudioEncoder(Session &session, const FFmpegUtils::TranscodeParams &params);
+    bool openOutput(Session &session, const QString &targetPath);
+    bool writeHeader(Session &session, const QString &targetPath, const FFmpegUtils::TranscodeParams &params);
+    bool decodeVideo(Session &session, AVPacket *packet);
+    bool decodeAudio(Session &session, AVPacket *packet);
+    bool encodeVideoFrame(Session &session, AVFrame *frame);
+    bool encodeAudioFrame(Session &session, AVFrame *frame);
+    bool drainAudioFifo(Session &session, bool flush);
+    bool writePackets(Session &session, bool video);
+    bool copyPacket(Session &session, AVPacket *packet);
+    void reportProgress(Session &session, qint64 outTimeUs);
+    bool fail(const QString &what, int averror = 0);
+};
+
+#endif // LIBAVENGINE_H
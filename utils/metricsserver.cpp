@@ -0,0 +1,103 @@
+﻿#include "metricsserver.h"
+#include <QDebug>
+#include <QHostAddress>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+MetricsServer::MetricsServer(std::function<QByteArray()> provider, QObject *parent)
+    : QObject(parent), m_server(new QTcpServer(this)), m_provider(std::move(provider))
+{
+    connect(m_server, &QTcpServer::newConnection, this, &MetricsServer::onNewConnection);
+}
+
+MetricsServer::~MetricsServer()
+{
+    m_server->close();
+}
+
+bool MetricsServer::listen(quint16 port)
+{
+    // 只对本机开放，需要远程抓取时由反向代理或node_exporter转发
+    return m_server->listen(QHostAddress::LocalHost, port);
+}
+
+QString MetricsServer::errorString() const
+{
+    return m_server->errorString();
+}
+
+void MetricsServer::onNewConnection()
+{
+    while (QTcpSocket *socket = m_server->nextPendingConnection())
+    {
+        m_requests.insert(socket, QByteArray());
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { onReadyRead(socket); });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]()
+                {
+                    m_requests.remove(socket);
+                    socket->deleteLater();
+                });
+
+        // 不发送完整请求的连接超时后断开
+        QTimer::singleShot(RequestTimeoutMs, socket, [socket]() { socket->abort(); });
+    }
+}
+
+void MetricsServer::onReadyRead(QTcpSocket *socket)
+{
+    auto it = m_requests.find(socket);
+    if (it == m_requests.end())
+    {
+        return;
+    }
+
+    it.value() += socket->readAll();
+    if (it.value().size() > MaxRequestBytes)
+    {
+        socket->abort();
+        return;
+    }
+
+    // 只需要请求行，等到请求头结束再应答
+    int headerEnd = it.value().indexOf("\r\n\r\n");
+    if (headerEnd == -1)
+    {
+        return;
+    }
+
+    QList<QByteArray> requestLine = it.value().left(it.value().indexOf("\r\n")).split(' ');
+    m_requests.erase(it);
+
+    QByteArray method = requestLine.value(0);
+    QByteArray path = requestLine.value(1);
+    int query = path.indexOf('?');
+    if (query != -1)
+    {
+        path.truncate(query);
+    }
+
+    if (method != "GET")
+    {
+        respond(socket, "405 Method Not Allowed", "text/plain", "method not allowed\n");
+    }
+    else if (path == "/metrics")
+    {
+        QByteArray body = m_provider ? m_provider() : QByteArray();
+        respond(socket, "200 OK", "text/plain; version=0.0.4; charset=utf-8", body);
+    }
+    else
+    {
+        respond(socket, "404 Not Found", "text/plain", "see /metrics\n");
+    }
+}
+
+void MetricsServer::respond(QTcpSocket *socket, const QByteArray &status, const QByteArray &contentType, const QByteArray &body)
+{
+    QByteArray response = "HTTP/1.1 " + status + "\r\n" +
+                          "Content-Type: " + contentType + "\r\n" +
+                          "Content-Length: " + QByteArray::number(body.size()) + "\r\n" +
+                          "Connection: close\r\n\r\n" + body;
+    socket->write(response);
+    socket->disconnectFromHost(); // 写缓冲发送完后关闭
+}
@@ -0,0 +1,49 @@
+﻿#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <functional>
+
+class QTcpServer;
+class QTcpSocket;
+
+/**
+ * 最小化的指标HTTP服务
+ * 只监听127.0.0.1，对 GET /metrics 返回 provider 生成的Prometheus文本，
+ * 每个请求应答后即关闭连接；其他路径返回404
+ *
+ *  Usage:
+ *
+ *  MetricsServer *server = new MetricsServer([this]() { return m_metrics.render(); }, this);
+ *  server->listen(9464);
+ */
+class MetricsServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MetricsServer(std::function<QByteArray()> provider, QObject *parent = nullptr);
+    ~MetricsServer();
+
+    // 在本机回环地址上监听，失败时返回false
+    bool listen(quint16 port);
+    QString errorString() const;
+
+private slots:
+    void onNewConnection();
+
+private:
+    QTcpServer *m_server;
+    std::function<QByteArray()> m_provider;
+    QHash<QTcpSocket *, QByteArray> m_requests; // 尚未读完请求头的连接
+
+    static const int MaxRequestBytes = 8192; // 请求头上限，超过则直接断开
+    static const int RequestTimeoutMs = 5000;
+
+    void onReadyRead(QTcpSocket *socket);
+    void respond(QTcpSocket *socket, const QByteArray &status, const QByteArray &contentType, const QByteArray &body);
+};
+
+#endif // METRICSSERVER_H
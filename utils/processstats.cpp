@@ -0,0 +1,165 @@
+﻿#include "processstats.h"
+#include <QFile>
+#include <QString>
+#include <QStringList>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef Q_OS_WIN
+namespace
+{
+    ProcessStats::Usage sampleHandle(HANDLE process)
+    {
+        ProcessStats::Usage usage;
+
+        // FILETIME单位为100纳秒
+        FILETIME creationTime, exitTime, kernelTime, userTime;
+        if (GetProcessTimes(process, &creationTime, &exitTime, &kernelTime, &userTime))
+        {
+            auto toMs = [](const FILETIME &ft)
+            { return ((qint64(ft.dwHighDateTime) << 32) | ft.dwLowDateTime) / 10000; };
+            usage.userMs = toMs(userTime);
+            usage.systemMs = toMs(kernelTime);
+            usage.valid = true;
+        }
+
+        PROCESS_MEMORY_COUNTERS counters;
+        if (GetProcessMemoryInfo(process, &counters, sizeof(counters)))
+        {
+            usage.peakRssKb = static_cast<qint64>(counters.PeakWorkingSetSize / 1024);
+        }
+        return usage;
+    }
+}
+#endif
+
+ProcessStats::Usage ProcessStats::sample(qint64 pid)
+{
+    Usage usage;
+    if (pid <= 0)
+    {
+        return usage;
+    }
+
+#ifdef Q_OS_WIN
+    HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, static_cast<DWORD>(pid));
+    if (!process)
+    {
+        return usage;
+    }
+    usage = sampleHandle(process);
+    CloseHandle(process);
+#else
+    // /proc/<pid>/stat：进程名可能包含空格，从最后一个')'之后开始解析
+    QFile statFile(QString("/proc/%1/stat").arg(pid));
+    if (!statFile.open(QIODevice::ReadOnly))
+    {
+        return usage;
+    }
+    QByteArray stat = statFile.readAll();
+    int nameEnd = stat.lastIndexOf(')');
+    if (nameEnd == -1)
+    {
+        return usage;
+    }
+
+    // ')'之后依次为 state(3) ... utime(14) stime(15)
+    QList<QByteArray> fields = stat.mid(nameEnd + 2).split(' ');
+    if (fields.size() < 13)
+    {
+        return usage;
+    }
+
+    long ticksPerSecond = sysconf(_SC_CLK_TCK);
+    if (ticksPerSecond <= 0)
+    {
+        ticksPerSecond = 100;
+    }
+    usage.userMs = fields[11].toLongLong() * 1000 / ticksPerSecond;
+    usage.systemMs = fields[12].toLongLong() * 1000 / ticksPerSecond;
+    usage.valid = true;
+
+    // VmHWM为进程生命周期内的峰值常驻内存
+    QFile statusFile(QString("/proc/%1/status").arg(pid));
+    if (statusFile.open(QIODevice::ReadOnly))
+    {
+        while (!statusFile.atEnd())
+        {
+            QByteArray line = statusFile.readLine();
+            if (line.startsWith("VmHWM:"))
+            {
+                usage.peakRssKb = line.mid(6).simplified().split(' ').value(0).toLongLong();
+                break;
+            }
+        }
+    }
+#endif
+
+    return usage;
+}
+
+ProcessStats::Usage ProcessStats::merge(const Usage &previous, const Usage &current)
+{
+    if (!current.valid)
+    {
+        return previous;
+    }
+
+    Usage result;
+    result.userMs = qMax(previous.userMs, current.userMs);
+    result.systemMs = qMax(previous.systemMs, current.systemMs);
+    result.peakRssKb = qMax(previous.peakRssKb, current.peakRssKb);
+    result.valid = true;
+    return result;
+}
+
+ProcessStats::Tracker::Tracker(qint64 pid)
+    : m_pid(pid)
+{
+#ifdef Q_OS_WIN
+    // 持有句柄后进程对象在退出后不会被释放，finish 时可读取最终的CPU时间和峰值内存
+    if (pid > 0)
+    {
+        m_handle = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, static_cast<DWORD>(pid));
+    }
+#endif
+}
+
+ProcessStats::Tracker::~Tracker()
+{
+#ifdef Q_OS_WIN
+    if (m_handle)
+    {
+        CloseHandle(static_cast<HANDLE>(m_handle));
+    }
+#endif
+}
+
+void ProcessStats::Tracker::poll()
+{
+#ifdef Q_OS_WIN
+    if (m_handle)
+    {
+        m_usage = merge(m_usage, sampleHandle(static_cast<HANDLE>(m_handle)));
+        return;
+    }
+#endif
+    m_usage = merge(m_usage, sample(m_pid));
+}
+
+ProcessStats::Usage ProcessStats::Tracker::finish()
+{
+#ifdef Q_OS_WIN
+    if (m_handle)
+    {
+        m_usage = merge(m_usage, sampleHandle(static_cast<HANDLE>(m_handle)));
+    }
+#endif
+    // 其他平台进程退出后 /proc 条目已被回收，保留运行期间最后一次采样
+    return m_usage;
+}
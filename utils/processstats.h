@@ -0,0 +1,65 @@
+﻿#ifndef PROCESSSTATS_H
+#define PROCESSSTATS_H
+
+#include <QtGlobal>
+
+/**
+ * 子进程资源占用采样
+ * QProcess会自行回收子进程，无法通过wait4取得rusage。
+ * Windows上在进程启动后即打开并持有进程句柄，退出后仍可用GetProcessTimes读取完整的累计占用；
+ * 其他平台只能在进程运行期间读取 /proc/<pid>，取最后一次采样作为累计占用，
+ * 不含最后一次采样之后（写文件尾、释放资源）的开销，因此是下限
+ */
+class ProcessStats
+{
+public:
+    /**
+     * 资源占用
+     */
+    struct Usage
+    {
+        qint64 userMs = 0;    // 用户态CPU时间
+        qint64 systemMs = 0;  // 内核态CPU时间
+        qint64 peakRssKb = 0; // 峰值常驻内存
+        bool valid = false;
+    };
+
+public:
+    ProcessStats() = delete; // 工具类，禁止实例化
+
+    /**
+     * 读取进程当前的累计CPU时间和峰值内存
+     * @param pid 进程ID（QProcess::processId()）
+     * @return 资源占用，进程不存在或平台不支持时 valid 为 false
+     */
+    static Usage sample(qint64 pid);
+
+    // 合并两次采样：取较大的CPU时间和峰值内存（进程退出前最后一次采样最完整）
+    static Usage merge(const Usage &previous, const Usage &current);
+
+    /**
+     * 跟踪一个子进程从启动到退出的资源占用
+     * 在 waitForStarted 之后构造，运行期间调用 poll，进程退出后调用 finish
+     */
+    class Tracker
+    {
+    public:
+        explicit Tracker(qint64 pid);
+        ~Tracker();
+
+        // 运行期间采样；ffmpeg输出 progress=end 后也应立即采样一次，此时编码已全部完成
+        void poll();
+
+        // 进程退出后调用，返回累计占用（Windows上为完整值，其他平台为最后一次采样）
+        Usage finish();
+
+    private:
+        qint64 m_pid;
+        void *m_handle = nullptr; // Windows进程句柄，保证进程退出后仍可读取
+        Usage m_usage;
+
+        Q_DISABLE_COPY(Tracker)
+    };
+};
+
+#endif // PROCESSSTATS_H
@@ -0,0 +1,113 @@
+﻿#include "scratchstaging.h"
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+ScratchStaging::ScratchStaging(const QString &directory)
+    : m_directory(directory)
+{
+}
+
+ScratchStaging::~ScratchStaging()
+{
+    for (const QString &file : m_files)
+    {
+        if (QFile::exists(file) && !QFile::remove(file))
+        {
+            qDebug() << QString::fromLocal8Bit("删除暂存文件失败:") << file;
+        }
+    }
+}
+
+QString ScratchStaging::resolveDirectory(const QString &configured)
+{
+    QString directory = configured.isEmpty() ? QDir::temp().absoluteFilePath("transcoder-scratch")
+                                             : QDir(configured).absolutePath();
+    if (!QDir().mkpath(directory))
+    {
+        qDebug() << QString::fromLocal8Bit("无法创建暂存目录:") << directory;
+        return QString();
+    }
+    return directory;
+}
+
+QString ScratchStaging::localPathFor(const QString &directory, const QString &path)
+{
+    QFileInfo fileInfo(path);
+    QByteArray hash = QCryptographicHash::hash(fileInfo.absoluteFilePath().toUtf8(), QCryptographicHash::Md5).toHex().left(8);
+    return QDir(directory).absoluteFilePath(QString::fromLatin1(hash) + "_" + fileInfo.fileName());
+}
+
+bool ScratchStaging::copyFile(const QString &from, const QString &to, const CancelCallback &isCancelled)
+{
+    QFile source(from);
+    if (!source.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    QFile target(to);
+    if (!target.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        return false;
+    }
+
+    QByteArray buffer(static_cast<int>(CopyBlockSize), Qt::Uninitialized);
+    bool ok = true;
+    while (ok)
+    {
+        if (isCancelled && isCancelled())
+        {
+            ok = false;
+            break;
+        }
+
+        qint64 read = source.read(buffer.data(), buffer.size());
+        if (read <= 0)
+        {
+            ok = read == 0;
+            break;
+        }
+        ok = target.write(buffer.constData(), read) == read;
+    }
+
+    ok = target.flush() && ok;
+    target.close();
+    if (!ok)
+    {
+        QFile::remove(to);
+    }
+    return ok;
+}
+
+bool ScratchStaging::stageInput(const QString &inputPath, const CancelCallback &isCancelled)
+{
+    QString localPath = localPathFor(m_directory, inputPath);
+    m_files << localPath;
+    if (!copyFile(inputPath, localPath, isCancelled))
+    {
+        m_error = QString::fromLocal8Bit("复制源文件到暂存目录失败: %1").arg(localPath);
+        return false;
+    }
+    m_localInput = localPath;
+    return true;
+}
+
+QString ScratchStaging::localOutput(const QString &outputPath)
+{
+    QString localPath = localPathFor(m_directory, outputPath);
+    m_files << localPath;
+    return localPath;
+}
+
+bool ScratchStaging::publish(const QString &localPath, const QString &targetPath, const CancelCallback &isCancelled)
+{
+    bool ok = copyFile(localPath, targetPath, isCancelled);
+    if (!ok)
+    {
+        m_error = QString::fromLocal8Bit("复制输出到目标目录失败: %1").arg(targetPath);
+    }
+    QFile::remove(localPath);
+    return ok;
+}
@@ -0,0 +1,70 @@
+﻿#ifndef SCRATCHSTAGING_H
+#define SCRATCHSTAGING_H
+
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+/**
+ * 本地暂存
+ * 源目录和输出目录在NFS/SMB上时，ffmpeg的随机读取和faststart对整个输出文件的重读重写都要经过网络。
+ * 暂存模式下源文件先顺序复制到本地暂存目录，编码输出也写在本地，
+ * 完成后一次顺序复制回目标目录的 _temp 文件，再由管理器照常重命名为最终文件。
+ * 暂存目录可以指向tmpfs（如 /dev/shm），此时需要留出能放下源文件和输出的内存。
+ *
+ * 对象析构时删除本次创建的本地文件。
+ */
+class ScratchStaging
+{
+public:
+    // 取消检查，返回true时中止复制
+    using CancelCallback = std::function<bool()>;
+
+public:
+    // directory为空表示不启用暂存，isEnabled() 返回false
+    explicit ScratchStaging(const QString &directory);
+    ~ScratchStaging();
+
+    ScratchStaging(const ScratchStaging &) = delete;
+    ScratchStaging &operator=(const ScratchStaging &) = delete;
+
+    bool isEnabled() const { return !m_directory.isEmpty(); }
+
+    /**
+     * 解析并创建暂存目录
+     * @param configured 配置的目录，为空时使用系统临时目录下的 transcoder-scratch
+     * @return 绝对路径，无法创建时返回空字符串
+     */
+    static QString resolveDirectory(const QString &configured);
+
+    // 远程文件在暂存目录中对应的本地路径，文件名前加原路径的哈希，不同目录的同名文件不冲突
+    static QString localPathFor(const QString &directory, const QString &path);
+
+    /**
+     * 顺序复制文件（大块读写，避免网络文件系统上的小块往返）
+     * 失败或取消时删除不完整的目标文件
+     */
+    static bool copyFile(const QString &from, const QString &to, const CancelCallback &isCancelled = CancelCallback());
+
+    // 把源文件复制到暂存目录，成功后 localInput() 为本地副本
+    bool stageInput(const QString &inputPath, const CancelCallback &isCancelled = CancelCallback());
+    QString localInput() const { return m_localInput; }
+
+    // 输出文件在暂存目录中的路径，登记后析构时删除
+    QString localOutput(const QString &outputPath);
+
+    // 把本地输出复制到目标路径，复制完成后删除本地文件
+    bool publish(const QString &localPath, const QString &targetPath, const CancelCallback &isCancelled = CancelCallback());
+
+    QString errorString() const { return m_error; }
+
+private:
+    QString m_directory;
+    QString m_localInput;
+    QStringList m_files; // 本次创建的本地文件
+    QString m_error;
+
+    static const qint64 CopyBlockSize = 8 * 1024 * 1024; // 顺序复制的块大小
+};
+
+#endif // SCRATCHSTAGING_H
@@ -1,4 +1,6 @@
 ﻿#include "videoinfodialog.h"
+#include "probecache.h"
+#include "utils/ffmpegutils.h"
 #include <QApplication>
 #include <QFileInfo>
 #include <QTextStream>
@@ -95,33 +97,37 @@ void VideoInfoDialog::analyzeVideo(const QString &videoPath)
     // 清空之前的信息
     clearInfoDisplay();
 
-    // 开始分析
-    setAnalyzing(true);
-
-    // 创建ffprobe进程
+    // 结束上一次尚未完成的分析
     if (m_ffprobeProcess)
     {
+        m_ffprobeProcess->disconnect(this);
         m_ffprobeProcess->kill();
         m_ffprobeProcess->deleteLater();
+        m_ffprobeProcess = nullptr;
     }
 
+    // 文件未变化时直接使用缓存的探测结果
+    QByteArray cached;
+    if (ProbeCache::instance()->lookup(videoPath, &cached))
+    {
+        parseAndDisplayVideoInfo(QString::fromUtf8(cached));
+        m_fileLabel->setText(QString::fromLocal8Bit("文件: %1").arg(fileInfo.fileName()));
+        return;
+    }
+
+    // 开始分析
+    setAnalyzing(true);
+
+    // 创建ffprobe进程
+
     m_ffprobeProcess = new QProcess(this);
     connect(m_ffprobeProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
             this, &VideoInfoDialog::onProcessFinished);
     connect(m_ffprobeProcess, &QProcess::errorOccurred,
             this, &VideoInfoDialog::onProcessError);
 
-    // 构建ffprobe命令
-    QStringList arguments;
-    arguments << "-v" << "quiet"
-              << "-print_format" << "json"
-              << "-show_format"
-              << "-show_streams"
-              << "-show_chapters"
-              << videoPath;
-
-    // 启动ffprobe
-    m_ffprobeProcess->start("ffprobe", arguments);
+    // 与探测缓存使用相同的参数，结果可以互相复用
+    m_ffprobeProcess->start("ffprobe", FFmpegUtils::probeArguments(videoPath));
 }
 
 void VideoInfoDialog::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
@@ -136,8 +142,9 @@ void VideoInfoDialog::onProcessFinished(int exitCode, QProcess::ExitStatus exitS
         return;
     }
 
-    QString output = m_ffprobeProcess->readAllStandardOutput();
-    parseAndDisplayVideoInfo(output);
+    QByteArray output = m_ffprobeProcess->readAllStandardOutput();
+    ProbeCache::instance()->insert(m_currentVideoPath, output);
+    parseAndDisplayVideoInfo(QString::fromUtf8(output));
 
     QFileInfo fileInfo(m_currentVideoPath);
     m_fileLabel->setText(QString::fromLocal8Bit("文件: %1").arg(fileInfo.fileName()));
@@ -0,0 +1,144 @@
+﻿#include "watchfolderservice.h"
+#include "transcodetaskmanager.h"
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+
+WatchFolderService::WatchFolderService(QObject *parent)
+    : QObject(parent)
+{
+    m_stabilityTimer.setInterval(StabilityCheckMs);
+
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, &WatchFolderService::onDirectoryChanged);
+    connect(&m_stabilityTimer, &QTimer::timeout, this, &WatchFolderService::checkCandidates);
+}
+
+bool WatchFolderService::addDirectory(const QString &path)
+{
+    QString dirPath = QDir(path).absolutePath();
+    if (!QFileInfo(dirPath).isDir() || !m_watcher.addPath(dirPath))
+    {
+        qDebug() << QString::fromLocal8Bit("无法监视目录:") << dirPath;
+        return false;
+    }
+
+    m_roots.insert(dirPath);
+    scanDirectory(dirPath, true);
+    return true;
+}
+
+void WatchFolderService::onDirectoryChanged(const QString &path)
+{
+    // 只重新列出发生变化的目录，不扫描整棵目录树
+    if (!QFileInfo(path).isDir())
+    {
+        m_watcher.removePath(path);
+        return;
+    }
+    scanDirectory(path);
+}
+
+void WatchFolderService::scanDirectory(const QString &path, bool backlog)
+{
+    QDir dir(path);
+    QStringList extensions = TranscodeTaskManager::supportedExtensions();
+
+    // 投放目录下的子目录按剧集组织，新建时加入监视
+    if (m_roots.contains(path))
+    {
+        QStringList watched = m_watcher.directories();
+        for (const QFileInfo &subDir : dir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks))
+        {
+            QString subPath = subDir.absoluteFilePath();
+            if (!watched.contains(subPath) && m_watcher.addPath(subPath))
+            {
+                qDebug() << QString::fromLocal8Bit("开始监视子目录:") << subPath;
+                scanDirectory(subPath, backlog);
+            }
+        }
+    }
+
+    QSet<QString> present;
+    for (const QFileInfo &entry : dir.entryInfoList(QDir::Files | QDir::NoSymLinks | QDir::Readable))
+    {
+        if (!extensions.contains(entry.suffix().toLower()))
+        {
+            continue;
+        }
+
+        QString filePath = entry.absoluteFilePath();
+        present.insert(filePath);
+        if (!m_known.contains(filePath) && !m_candidates.contains(filePath))
+        {
+            Candidate candidate;
+            candidate.backlog = backlog;
+            m_candidates.insert(filePath, candidate);
+        }
+    }
+
+    // 被删除的文件重新出现时需要再次报告
+    for (auto it = m_known.begin(); it != m_known.end();)
+    {
+        if (QFileInfo(*it).absolutePath() == dir.absolutePath() && !present.contains(*it))
+        {
+            it = m_known.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    if (!m_candidates.isEmpty() && !m_stabilityTimer.isActive())
+    {
+        m_stabilityTimer.start();
+    }
+}
+
+void WatchFolderService::checkCandidates()
+{
+    QDateTime now = QDateTime::currentDateTime();
+
+    for (auto it = m_candidates.begin(); it != m_candidates.end();)
+    {
+        QFileInfo info(it.key());
+        if (!info.exists())
+        {
+            it = m_candidates.erase(it);
+            continue;
+        }
+
+        Candidate &candidate = it.value();
+        qint64 size = info.size();
+        QDateTime modified = info.lastModified();
+
+        // 大小和修改时间都没变，且已静默一段时间，才算写入完成
+        if (size > 0 && size == candidate.size && modified == candidate.modified &&
+            modified.msecsTo(now) >= MinQuietMs)
+        {
+            candidate.stableChecks++;
+        }
+        else
+        {
+            candidate.size = size;
+            candidate.modified = modified;
+            candidate.stableChecks = 0;
+        }
+
+        if (candidate.stableChecks < StableChecks)
+        {
+            ++it;
+            continue;
+        }
+
+        qDebug() << QString::fromLocal8Bit("文件写入完成:") << it.key();
+        m_known.insert(it.key());
+        emit fileReady(info.absolutePath(), info.fileName(), candidate.backlog);
+        it = m_candidates.erase(it);
+    }
+
+    if (m_candidates.isEmpty())
+    {
+        m_stabilityTimer.stop();
+    }
+}
@@ -0,0 +1,60 @@
+﻿#ifndef WATCHFOLDERSERVICE_H
+#define WATCHFOLDERSERVICE_H
+
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QDateTime>
+#include <QStringList>
+#include <QMap>
+#include <QSet>
+
+/**
+ * 监视文件夹服务
+ * 监视投放目录及其下一级子目录，目录变化时只重新列出发生变化的那个目录；
+ * 新文件的大小和修改时间稳定后（上传/拷贝完成）才报告，避免转码写了一半的文件
+ */
+class WatchFolderService : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit WatchFolderService(QObject *parent = nullptr);
+
+    // 开始监视目录，目录中已有的视频文件同样会在稳定后报告
+    bool addDirectory(const QString &path);
+
+    QStringList directories() const { return m_watcher.directories(); }
+
+signals:
+    // 文件已写入完成，可以转码；backlog表示开始监视时目录中已有的文件
+    void fileReady(const QString &sourceDir, const QString &fileName, bool backlog);
+
+private slots:
+    void onDirectoryChanged(const QString &path);
+    void checkCandidates();
+
+private:
+    // 等待写入完成的文件
+    struct Candidate
+    {
+        qint64 size = -1;
+        QDateTime modified;
+        int stableChecks = 0; // 连续未变化的检查次数
+        bool backlog = false; // 开始监视时已存在
+    };
+
+    QFileSystemWatcher m_watcher;
+    QTimer m_stabilityTimer;
+    QSet<QString> m_roots;                 // 通过addDirectory添加的目录
+    QSet<QString> m_known;                 // 已报告过的文件
+    QMap<QString, Candidate> m_candidates; // 绝对路径 -> 稳定性状态
+
+    static const int StabilityCheckMs = 1000; // 稳定性检查间隔
+    static const int StableChecks = 2;        // 连续多少次未变化视为写入完成
+    static const int MinQuietMs = 2000;       // 最后一次修改后至少静默的时间
+
+    void scanDirectory(const QString &path, bool backlog = false);
+};
+
+#endif // WATCHFOLDERSERVICE_H